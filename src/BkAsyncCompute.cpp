@@ -0,0 +1,144 @@
+#include "BkAsyncCompute.h"
+#include <stdexcept>
+
+BkAsyncCompute::BkAsyncCompute(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+	: device(device), queue(queue), queueFamilyIndex(queueFamilyIndex), framesInFlight(framesInFlight)
+{
+	// the command buffers are re-recorded every frame
+	VkCommandPoolCreateInfo commandPoolCreateInfo{};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateCommandPool' failed to create the compute command pool!");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.commandPool = commandPool;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = framesInFlight;
+	commandBuffers.resize(framesInFlight);
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateCommandBuffers' failed to allocate compute command buffers!");
+	}
+	commandBuffersValues.resize(framesInFlight, 0);
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+	semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo{};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+	if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateSemaphore' failed to create the compute timeline semaphore!");
+	}
+}
+
+BkAsyncCompute::~BkAsyncCompute()
+{
+	// wait for the last submission before its command buffer is freed
+	VkSemaphoreWaitInfo semaphoreWaitInfo{};
+	semaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	semaphoreWaitInfo.semaphoreCount = 1;
+	semaphoreWaitInfo.pSemaphores = &timelineSemaphore;
+	semaphoreWaitInfo.pValues = &submittedValue;
+	vkWaitSemaphores(device, &semaphoreWaitInfo, UINT64_MAX);
+
+	vkDestroySemaphore(device, timelineSemaphore, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+VkCommandBuffer BkAsyncCompute::begin(uint32_t frame)
+{
+	VkSemaphoreWaitInfo semaphoreWaitInfo{};
+	semaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	semaphoreWaitInfo.semaphoreCount = 1;
+	semaphoreWaitInfo.pSemaphores = &timelineSemaphore;
+	semaphoreWaitInfo.pValues = &commandBuffersValues[frame];
+	vkWaitSemaphores(device, &semaphoreWaitInfo, UINT64_MAX);
+
+	VkCommandBuffer commandBuffer = commandBuffers[frame];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo{};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkBeginCommandBuffer' failed to begin a compute command buffer!");
+	}
+	return commandBuffer;
+}
+
+void BkAsyncCompute::waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags waitStageMask)
+{
+	waitSemaphores.push_back(semaphore);
+	waitValues.push_back(value);
+	waitStageMasks.push_back(waitStageMask);
+}
+
+uint64_t BkAsyncCompute::submit(uint32_t frame)
+{
+	VkCommandBuffer commandBuffer = commandBuffers[frame];
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkEndCommandBuffer' failed to end a compute command buffer!");
+	}
+
+	uint64_t signalValue = submittedValue + 1;
+	VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{};
+	timelineSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSemaphoreSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineSemaphoreSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineSemaphoreSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSemaphoreSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSemaphoreSubmitInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStageMasks.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timelineSemaphore;
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkQueueSubmit' failed to submit compute work!");
+	}
+
+	waitSemaphores.clear();
+	waitValues.clear();
+	waitStageMasks.clear();
+
+	submittedValue = signalValue;
+	commandBuffersValues[frame] = signalValue;
+	return signalValue;
+}
+
+bool BkAsyncCompute::isShared(VkQueue graphicsQueue) const
+{
+	return queue == graphicsQueue;
+}
+
+VkSemaphore BkAsyncCompute::getTimelineSemaphore() const
+{
+	return timelineSemaphore;
+}
+
+uint64_t BkAsyncCompute::getSubmittedValue() const
+{
+	return submittedValue;
+}
+
+uint32_t BkAsyncCompute::getQueueFamilyIndex() const
+{
+	return queueFamilyIndex;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// records and submits compute work to a (preferably dedicated) compute queue
+// so it overlaps with rendering on the graphics queue; every submission
+// signals the next value of a timeline semaphore that the graphics queue
+// waits on before consuming the results (requires timeline semaphores); it
+// is separate from the renderer's frame timeline since the two queues signal
+// out of order with respect to each other
+//
+// with a dedicated compute family, buffers and images written here and read
+// by graphics need VK_SHARING_MODE_CONCURRENT or a queue family ownership
+// transfer
+class BkAsyncCompute
+{
+private:
+	VkDevice device;
+	VkQueue queue;
+	uint32_t queueFamilyIndex;
+	uint32_t framesInFlight;
+
+	VkCommandPool commandPool;
+	std::vector<VkCommandBuffer> commandBuffers;
+
+	VkSemaphore timelineSemaphore;
+	uint64_t submittedValue = 0;
+
+	// timeline value each frame's command buffer was last submitted with
+	std::vector<uint64_t> commandBuffersValues;
+
+	// semaphores the next submission waits on
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	std::vector<VkPipelineStageFlags> waitStageMasks;
+
+public:
+	BkAsyncCompute(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+	~BkAsyncCompute();
+
+	BkAsyncCompute(const BkAsyncCompute&) = delete;
+	BkAsyncCompute& operator=(const BkAsyncCompute&) = delete;
+
+	// wait until the frame's compute command buffer is free and start
+	// recording it
+	VkCommandBuffer begin(uint32_t frame);
+
+	// make the next submission wait for 'semaphore' (a timeline semaphore
+	// reaching 'value', or a binary semaphore with a value of 0), e.g. for
+	// results of the previous frame's graphics work
+	void waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags waitStageMask);
+
+	// end and submit the frame's command buffer; returns the timeline value
+	// the graphics queue has to wait for to see its results
+	uint64_t submit(uint32_t frame);
+
+	// true if the compute queue is the graphics queue (no dedicated family)
+	bool isShared(VkQueue graphicsQueue) const;
+
+	VkSemaphore getTimelineSemaphore() const;
+
+	// value of the newest submission, 0 before the first one
+	uint64_t getSubmittedValue() const;
+
+	uint32_t getQueueFamilyIndex() const;
+};
@@ -0,0 +1,279 @@
+#include "BkBench.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+static std::string escapeJson(const std::string& value)
+{
+	std::string escaped;
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+
+// the number after '"key":' at or after 'position', NAN if it is null or missing
+static double findJsonNumber(const std::string& json, const std::string& key, size_t position, size_t end)
+{
+	size_t keyPosition = json.find("\"" + key + "\"", position);
+	if (keyPosition == std::string::npos || keyPosition >= end)
+	{
+		return NAN;
+	}
+	size_t valuePosition = json.find(':', keyPosition) + 1;
+	const char* value = json.c_str() + valuePosition;
+	char* valueEnd;
+	double number = std::strtod(value, &valueEnd);
+	return valueEnd == value ? NAN : number;
+}
+
+BkBenchSummary BkBenchResult::getSummary() const
+{
+	BkBenchSummary summary{};
+	summary.cpuP50 = getPercentile(cpuFrameTimes, 50.0);
+	summary.cpuP99 = getPercentile(cpuFrameTimes, 99.0);
+	summary.bGpuTimes = !gpuFrameTimes.empty();
+	summary.gpuP50 = getPercentile(gpuFrameTimes, 50.0);
+	summary.gpuP99 = getPercentile(gpuFrameTimes, 99.0);
+	return summary;
+}
+
+double getPercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+	{
+		return 0.0;
+	}
+
+	size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+	size_t index = std::min(std::max(rank, static_cast<size_t>(1)), values.size()) - 1;
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+void writeBenchJson(std::ostream& stream, const std::string& deviceName, const std::vector<BkBenchResult>& results)
+{
+	stream << std::fixed << std::setprecision(4);
+	stream << "{\n";
+	stream << "  \"device\": \"" << escapeJson(deviceName) << "\",\n";
+	stream << "  \"scenes\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		BkBenchSummary summary = results[i].getSummary();
+		stream << "    { \"scene\": \"" << escapeJson(results[i].scene) << "\", \"frames\": " << results[i].cpuFrameTimes.size();
+		stream << ", \"cpu_ms\": { \"p50\": " << summary.cpuP50 << ", \"p99\": " << summary.cpuP99 << " }";
+		if (summary.bGpuTimes)
+		{
+			stream << ", \"gpu_ms\": { \"p50\": " << summary.gpuP50 << ", \"p99\": " << summary.gpuP99 << " } }";
+		}
+		else
+		{
+			stream << ", \"gpu_ms\": null }";
+		}
+		stream << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	stream << "  ]\n";
+	stream << "}\n";
+}
+
+std::map<std::string, BkBenchSummary> readBenchJson(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: failed to open '" + path + "'!");
+	}
+	std::stringstream stringStream;
+	stringStream << file.rdbuf();
+	std::string json = stringStream.str();
+
+	// only reads the layout writeBenchJson writes, one object per scene
+	std::map<std::string, BkBenchSummary> summaries;
+	size_t position = 0;
+	while ((position = json.find("\"scene\"", position)) != std::string::npos)
+	{
+		size_t nameBegin = json.find('"', json.find(':', position)) + 1;
+		size_t nameEnd = json.find('"', nameBegin);
+		std::string scene = json.substr(nameBegin, nameEnd - nameBegin);
+		size_t sceneEnd = std::min(json.find("\"scene\"", nameEnd), json.size());
+
+		BkBenchSummary summary{};
+		size_t cpuPosition = json.find("\"cpu_ms\"", nameEnd);
+		summary.cpuP50 = findJsonNumber(json, "p50", cpuPosition, sceneEnd);
+		summary.cpuP99 = findJsonNumber(json, "p99", cpuPosition, sceneEnd);
+		size_t gpuPosition = json.find("\"gpu_ms\"", nameEnd);
+		if (gpuPosition < sceneEnd)
+		{
+			summary.gpuP50 = findJsonNumber(json, "p50", gpuPosition, sceneEnd);
+			summary.gpuP99 = findJsonNumber(json, "p99", gpuPosition, sceneEnd);
+			summary.bGpuTimes = !std::isnan(summary.gpuP50) && !std::isnan(summary.gpuP99);
+		}
+		if (std::isnan(summary.cpuP50) || std::isnan(summary.cpuP99))
+		{
+			throw std::runtime_error("ERROR: '" + path + "' has no CPU times for scene '" + scene + "'!");
+		}
+		summaries[scene] = summary;
+		position = nameEnd;
+	}
+	return summaries;
+}
+
+bool compareBenchResults(const std::vector<BkBenchResult>& results, const std::map<std::string, BkBenchSummary>& baseline, double threshold)
+{
+	bool bPassed = true;
+	auto compare = [&](const std::string& scene, const char* name, double baselineValue, double value)
+	{
+		double change = baselineValue > 0.0 ? value / baselineValue - 1.0 : 0.0;
+		bool bRegressed = change > threshold;
+		bPassed &= !bRegressed;
+		std::cerr << std::fixed << std::setprecision(3) << "  " << std::left << std::setw(16) << scene << std::setw(8) << name
+			<< std::right << std::setw(10) << baselineValue << " ms -> " << std::setw(10) << value << " ms  "
+			<< std::showpos << std::setprecision(1) << change * 100.0 << "%" << std::noshowpos
+			<< (bRegressed ? "  REGRESSION" : "") << std::endl;
+	};
+
+	for (const BkBenchResult& result : results)
+	{
+		auto baselineSummary = baseline.find(result.scene);
+		if (baselineSummary == baseline.end())
+		{
+			std::cerr << "  " << result.scene << " isn't in the baseline" << std::endl;
+			continue;
+		}
+
+		BkBenchSummary summary = result.getSummary();
+		compare(result.scene, "cpu p50", baselineSummary->second.cpuP50, summary.cpuP50);
+		compare(result.scene, "cpu p99", baselineSummary->second.cpuP99, summary.cpuP99);
+		if (summary.bGpuTimes && baselineSummary->second.bGpuTimes)
+		{
+			compare(result.scene, "gpu p50", baselineSummary->second.gpuP50, summary.gpuP50);
+			compare(result.scene, "gpu p99", baselineSummary->second.gpuP99, summary.gpuP99);
+		}
+	}
+	return bPassed;
+}
+
+BkBench::BkBench(const std::string& deviceOverride)
+{
+	// the swapchain needs a window, it is never shown
+	glfwInit();
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	window = glfwCreateWindow(BENCH_WIDTH, BENCH_HEIGHT, "Bulkan Bench", nullptr, nullptr);
+	if (window == nullptr)
+	{
+		glfwTerminate();
+		throw std::runtime_error("ERROR: 'glfwCreateWindow' failed to create the bench window!");
+	}
+
+	try
+	{
+		context = std::make_unique<BkContext>(window, deviceOverride);
+		renderer = std::make_unique<BkRenderer>(*context, false);
+	}
+	catch (...)
+	{
+		renderer.reset();
+		context.reset();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		throw;
+	}
+
+	VkPhysicalDeviceProperties physicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &physicalDeviceProperties);
+	deviceName = physicalDeviceProperties.deviceName;
+}
+
+BkBench::~BkBench()
+{
+	// the renderer waits for the device before the context is destroyed
+	renderer.reset();
+	context.reset();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+}
+
+const std::string& BkBench::getDeviceName() const
+{
+	return deviceName;
+}
+
+BkBenchResult BkBench::run(const BkBenchScene& scene, uint32_t frameCount, uint32_t warmupFrameCount)
+{
+	BkBenchResult result{};
+	result.scene = scene.name;
+
+	// the renderer numbers the frames across the scenes
+	uint64_t firstTimedFrame = 0;
+	uint64_t lastTimedFrame = 0;
+	uint64_t lastGpuFrame = 0;
+	uint32_t skippedFrameCount = 0;
+	uint32_t totalFrameCount = warmupFrameCount + frameCount;
+	uint32_t frameIndex = 0;
+	while (frameIndex < totalFrameCount + BENCH_DRAIN_FRAME_COUNT)
+	{
+		glfwPollEvents();
+
+		float t = std::min(static_cast<float>(frameIndex) / totalFrameCount, 1.0f);
+		float distance = scene.startDistance + (scene.endDistance - scene.startDistance) * t;
+		glm::vec3 eye = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)) * distance;
+		renderer->setView(glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+		renderer->setModel(glm::rotate(glm::mat4(1.0f), glm::radians(scene.degreesPerFrame * frameIndex), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+		// the frame is rendered again once the swapchain is recreated
+		if (!renderer->beginFrame())
+		{
+			if (++skippedFrameCount > BENCH_MAX_SKIPPED_FRAME_COUNT)
+			{
+				throw std::runtime_error("ERROR: the swapchain of the bench window can't be recreated!");
+			}
+			continue;
+		}
+		skippedFrameCount = 0;
+		renderer->submit();
+		renderer->endFrame();
+
+		const BkFrameTimings& frameTimings = renderer->getFrameTimings();
+		if (frameIndex == warmupFrameCount)
+		{
+			firstTimedFrame = frameTimings.frame;
+		}
+		if (frameIndex >= warmupFrameCount && frameIndex < totalFrameCount)
+		{
+			lastTimedFrame = frameTimings.frame;
+			result.cpuFrameTimes.push_back(frameTimings.cpuTime);
+		}
+
+		// every frame's GPU time is read once, a few frames after it
+		if (frameTimings.bGpuTime && frameTimings.gpuFrame != lastGpuFrame && frameTimings.gpuFrame >= firstTimedFrame && frameTimings.gpuFrame <= lastTimedFrame)
+		{
+			result.gpuFrameTimes.push_back(frameTimings.gpuTime);
+		}
+		lastGpuFrame = frameTimings.gpuFrame;
+		frameIndex++;
+
+		// the drain frames are only rendered for the missing GPU times
+		if (frameIndex >= totalFrameCount && (!frameTimings.bGpuTime || lastGpuFrame >= lastTimedFrame))
+		{
+			break;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+#include "BkContext.h"
+#include "BkRenderer.h"
+
+// every scene renders BENCH_WARMUP_FRAME_COUNT untimed frames (pipeline
+// compilation, texture streaming, the dynamic resolution settling) before
+// the timed ones
+const uint32_t BENCH_FRAME_COUNT = 600;
+const uint32_t BENCH_WARMUP_FRAME_COUNT = 60;
+
+// the GPU time of a frame is read once its frame in flight slot is reused,
+// up to this many frames after the timed ones bring in the last times
+const uint32_t BENCH_DRAIN_FRAME_COUNT = 4;
+
+// frames in a row beginFrame() may skip recreating the swapchain
+const uint32_t BENCH_MAX_SKIPPED_FRAME_COUNT = 100;
+
+const int BENCH_WIDTH = 1280;
+const int BENCH_HEIGHT = 720;
+
+// a percentile this much slower than the baseline counts as a regression
+const double BENCH_REGRESSION_THRESHOLD = 0.05;
+
+// a camera path around the renderer's model: the camera looks at the
+// origin from the direction of the application's camera (1, 1, 1), moving
+// from 'startDistance' to 'endDistance' over the frames, while the model
+// turns 'degreesPerFrame' about z. The distances pick the levels of detail
+// and how much of the model the meshlet and occlusion culling reject
+struct BkBenchScene {
+	std::string name;
+	float startDistance;
+	float endDistance;
+	float degreesPerFrame;
+};
+
+// the renderer's far plane is at 10
+const std::vector<BkBenchScene> BENCH_SCENES = {
+	{ "orbit", 3.5f, 3.5f, 1.5f },
+	{ "close_up", 1.2f, 1.2f, 1.5f },
+	{ "zoom_out", 1.5f, 7.5f, 0.5f },
+	{ "distant", 7.5f, 7.5f, 1.5f },
+};
+
+struct BkBenchSummary {
+	double cpuP50 = 0.0;
+	double cpuP99 = 0.0;
+	double gpuP50 = 0.0;
+	double gpuP99 = 0.0;
+	bool bGpuTimes = false;
+};
+
+struct BkBenchResult {
+	std::string scene;
+
+	// milliseconds per timed frame; the GPU times are empty if the graphics
+	// queue doesn't support timestamps
+	std::vector<double> cpuFrameTimes;
+	std::vector<double> gpuFrameTimes;
+
+	BkBenchSummary getSummary() const;
+};
+
+// nearest rank percentile (0-100) of 'values', 0 if there are none
+double getPercentile(std::vector<double> values, double percentile);
+
+void writeBenchJson(std::ostream& stream, const std::string& deviceName, const std::vector<BkBenchResult>& results);
+
+// the scene summaries of a file written by writeBenchJson
+std::map<std::string, BkBenchSummary> readBenchJson(const std::string& path);
+
+// print every scene's percentiles next to the baseline's; false if any of
+// them is more than 'threshold' (a fraction) slower
+bool compareBenchResults(const std::vector<BkBenchResult>& results, const std::map<std::string, BkBenchSummary>& baseline, double threshold);
+
+// renders the scenes with BkRenderer into a hidden window, with every
+// feature the renderer enables (levels of detail, meshlet and Hi-Z
+// occlusion culling, MSAA, dynamic resolution, the frame arena and bindless
+// descriptors) and without vsync; the CPU and GPU times are the renderer's
+// frame timings. The camera path only depends on the frame index, so runs
+// on the same device are comparable
+class BkBench
+{
+private:
+	GLFWwindow* window = nullptr;
+	std::unique_ptr<BkContext> context;
+	std::unique_ptr<BkRenderer> renderer;
+	std::string deviceName;
+
+public:
+	BkBench(const std::string& deviceOverride);
+	~BkBench();
+
+	BkBench(const BkBench&) = delete;
+	BkBench& operator=(const BkBench&) = delete;
+
+	const std::string& getDeviceName() const;
+
+	BkBenchResult run(const BkBenchScene& scene, uint32_t frameCount = BENCH_FRAME_COUNT, uint32_t warmupFrameCount = BENCH_WARMUP_FRAME_COUNT);
+};
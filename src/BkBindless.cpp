@@ -0,0 +1,282 @@
+#include "BkBindless.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <cstring>
+
+static const uint32_t MATERIALS_BINDING = 0;
+static const uint32_t TEXTURES_BINDING = 1;
+
+BkBindlessTable::BkBindlessTable(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, uint32_t maxTextures, uint32_t maxMaterials)
+	: device(device), physicalDevice(physicalDevice), framesInFlight(framesInFlight), maxMaterials(maxMaterials)
+{
+	// the whole array counts against the update after bind limits of the set
+	// and of the fragment stage
+	VkPhysicalDeviceVulkan12Properties physicalDeviceVulkan12Properties{};
+	physicalDeviceVulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+	VkPhysicalDeviceProperties2 physicalDeviceProperties2{};
+	physicalDeviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	physicalDeviceProperties2.pNext = &physicalDeviceVulkan12Properties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &physicalDeviceProperties2);
+	this->maxTextures = std::min({ maxTextures,
+		physicalDeviceVulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+		physicalDeviceVulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		physicalDeviceVulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+	// the texture array is the last binding so its size can vary per set;
+	// unused slots are never written (partially bound)
+	std::array<VkDescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings{};
+	descriptorSetLayoutBindings[0].binding = MATERIALS_BINDING;
+	descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorSetLayoutBindings[0].descriptorCount = 1;
+	descriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	descriptorSetLayoutBindings[1].binding = TEXTURES_BINDING;
+	descriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorSetLayoutBindings[1].descriptorCount = this->maxTextures;
+	descriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorBindingFlags, 2> descriptorBindingFlags = {
+		0,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+	};
+	VkDescriptorSetLayoutBindingFlagsCreateInfo descriptorSetLayoutBindingFlagsCreateInfo{};
+	descriptorSetLayoutBindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	descriptorSetLayoutBindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(descriptorBindingFlags.size());
+	descriptorSetLayoutBindingFlagsCreateInfo.pBindingFlags = descriptorBindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.pNext = &descriptorSetLayoutBindingFlagsCreateInfo;
+	descriptorSetLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(descriptorSetLayoutBindings.size());
+	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorSetLayout' failed to create the bindless descriptor set layout!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes{};
+	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorPoolSizes[0].descriptorCount = framesInFlight;
+	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorPoolSizes[1].descriptorCount = this->maxTextures * framesInFlight;
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+	descriptorPoolCreateInfo.maxSets = framesInFlight;
+	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorPool' failed to create the bindless descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(framesInFlight, descriptorSetLayout);
+	std::vector<uint32_t> descriptorCounts(framesInFlight, this->maxTextures);
+	VkDescriptorSetVariableDescriptorCountAllocateInfo descriptorSetVariableDescriptorCountAllocateInfo{};
+	descriptorSetVariableDescriptorCountAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	descriptorSetVariableDescriptorCountAllocateInfo.descriptorSetCount = framesInFlight;
+	descriptorSetVariableDescriptorCountAllocateInfo.pDescriptorCounts = descriptorCounts.data();
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.pNext = &descriptorSetVariableDescriptorCountAllocateInfo;
+	descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+	descriptorSetAllocateInfo.descriptorSetCount = framesInFlight;
+	descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
+	descriptorSets.resize(framesInFlight);
+	if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateDescriptorSets' failed to allocate the bindless descriptor sets!");
+	}
+
+	// a host visible material buffer per frame, rewritten when materials change
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+	VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VkDeviceSize materialBufferSize = sizeof(BkMaterial) * maxMaterials;
+
+	materialBuffers.resize(framesInFlight);
+	materialBuffersDeviceMemory.resize(framesInFlight);
+	materialBuffersMapped.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = materialBufferSize;
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &materialBuffers[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkCreateBuffer' failed to create the material buffer!");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(device, materialBuffers[i], &memoryRequirements);
+
+		uint32_t memoryTypeIndex;
+		bool bFoundMemoryType = false;
+		for (uint32_t j = 0; j < physicalDeviceMemoryProperties.memoryTypeCount; j++)
+		{
+			if ((memoryRequirements.memoryTypeBits & (1 << j)) && (physicalDeviceMemoryProperties.memoryTypes[j].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+			{
+				memoryTypeIndex = j;
+				bFoundMemoryType = true;
+				break;
+			}
+		}
+		if (!bFoundMemoryType)
+		{
+			throw std::runtime_error("ERROR: failed to find suitable memory type for material buffer!");
+		}
+
+		VkMemoryAllocateInfo memoryAllocateInfo{};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+		if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &materialBuffersDeviceMemory[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to create device memory for material buffer!");
+		}
+		vkBindBufferMemory(device, materialBuffers[i], materialBuffersDeviceMemory[i], 0);
+		vkMapMemory(device, materialBuffersDeviceMemory[i], 0, materialBufferSize, 0, &materialBuffersMapped[i]);
+
+		VkDescriptorBufferInfo descriptorBufferInfo{};
+		descriptorBufferInfo.buffer = materialBuffers[i];
+		descriptorBufferInfo.offset = 0;
+		descriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet writeDescriptorSet{};
+		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSet.dstSet = descriptorSets[i];
+		writeDescriptorSet.dstBinding = MATERIALS_BINDING;
+		writeDescriptorSet.dstArrayElement = 0;
+		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writeDescriptorSet.descriptorCount = 1;
+		writeDescriptorSet.pBufferInfo = &descriptorBufferInfo;
+		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+	}
+
+	framesDirtyTextures.resize(framesInFlight);
+	framesDirtyMaterials.resize(framesInFlight, false);
+}
+
+BkBindlessTable::~BkBindlessTable()
+{
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		vkDestroyBuffer(device, materialBuffers[i], nullptr);
+		vkFreeMemory(device, materialBuffersDeviceMemory[i], nullptr);
+	}
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+bool BkBindlessTable::isSupported(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+	physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	physicalDeviceFeatures2.pNext = &physicalDeviceVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
+
+	return physicalDeviceVulkan12Features.runtimeDescriptorArray
+		&& physicalDeviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing
+		&& physicalDeviceVulkan12Features.descriptorBindingPartiallyBound
+		&& physicalDeviceVulkan12Features.descriptorBindingVariableDescriptorCount
+		&& physicalDeviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+}
+
+VkDescriptorSetLayout BkBindlessTable::getDescriptorSetLayout() const
+{
+	return descriptorSetLayout;
+}
+
+VkDescriptorSet BkBindlessTable::getDescriptorSet(uint32_t frame) const
+{
+	return descriptorSets[frame];
+}
+
+uint32_t BkBindlessTable::getMaxTextureCount() const
+{
+	return maxTextures;
+}
+
+void BkBindlessTable::setTexture(uint32_t slot, VkImageView imageView, VkSampler sampler)
+{
+	if (slot >= maxTextures)
+	{
+		throw std::runtime_error("ERROR: bindless texture slot is out of range!");
+	}
+	if (slot >= textureViews.size())
+	{
+		textureViews.resize(slot + 1, VK_NULL_HANDLE);
+		textureSamplers.resize(slot + 1, VK_NULL_HANDLE);
+	}
+	if (textureViews[slot] == imageView && textureSamplers[slot] == sampler)
+	{
+		return;
+	}
+
+	// a frame that still has the slot pending picks up the latest view
+	for (std::vector<uint32_t>& dirtyTextures : framesDirtyTextures)
+	{
+		if (std::find(dirtyTextures.begin(), dirtyTextures.end(), slot) == dirtyTextures.end())
+		{
+			dirtyTextures.push_back(slot);
+		}
+	}
+	textureViews[slot] = imageView;
+	textureSamplers[slot] = sampler;
+}
+
+uint32_t BkBindlessTable::addMaterial(const BkMaterial& material)
+{
+	if (materials.size() >= maxMaterials)
+	{
+		throw std::runtime_error("ERROR: bindless material buffer is full!");
+	}
+	materials.push_back(material);
+	std::fill(framesDirtyMaterials.begin(), framesDirtyMaterials.end(), true);
+	return static_cast<uint32_t>(materials.size() - 1);
+}
+
+void BkBindlessTable::setMaterial(uint32_t index, const BkMaterial& material)
+{
+	materials[index] = material;
+	std::fill(framesDirtyMaterials.begin(), framesDirtyMaterials.end(), true);
+}
+
+void BkBindlessTable::flush(uint32_t frame)
+{
+	std::vector<uint32_t>& dirtyTextures = framesDirtyTextures[frame];
+	if (!dirtyTextures.empty())
+	{
+		std::vector<VkDescriptorImageInfo> descriptorImageInfos(dirtyTextures.size());
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets(dirtyTextures.size());
+		for (size_t i = 0; i < dirtyTextures.size(); i++)
+		{
+			descriptorImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			descriptorImageInfos[i].imageView = textureViews[dirtyTextures[i]];
+			descriptorImageInfos[i].sampler = textureSamplers[dirtyTextures[i]];
+
+			writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[i].dstSet = descriptorSets[frame];
+			writeDescriptorSets[i].dstBinding = TEXTURES_BINDING;
+			writeDescriptorSets[i].dstArrayElement = dirtyTextures[i];
+			writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeDescriptorSets[i].descriptorCount = 1;
+			writeDescriptorSets[i].pImageInfo = &descriptorImageInfos[i];
+		}
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		dirtyTextures.clear();
+	}
+
+	if (framesDirtyMaterials[frame])
+	{
+		memcpy(materialBuffersMapped[frame], materials.data(), sizeof(BkMaterial) * materials.size());
+		framesDirtyMaterials[frame] = false;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// upper bounds of the bindless arrays, the texture count is clamped to the
+// device's update after bind limits
+const uint32_t BINDLESS_MAX_TEXTURES = 16384;
+const uint32_t BINDLESS_MAX_MATERIALS = 4096;
+
+// std430 layout of a material in the material storage buffer; the shaders
+// index it with gl_InstanceIndex, so a draw selects its material through
+// firstInstance
+struct BkMaterial {
+	uint32_t baseColorTexture = 0;
+	uint32_t padding[3] = { 0, 0, 0 };
+	glm::vec4 baseColorFactor = glm::vec4(1.0f);
+};
+
+// descriptor set with every texture in one partially bound sampler array and
+// every material in one storage buffer (descriptor indexing, Vulkan 1.2); one
+// set per frame in flight so a frame's set is only written once its fence
+// has been waited on
+class BkBindlessTable
+{
+private:
+	VkDevice device;
+	VkPhysicalDevice physicalDevice;
+	uint32_t framesInFlight;
+	uint32_t maxTextures;
+	uint32_t maxMaterials;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets;
+
+	std::vector<VkBuffer> materialBuffers;
+	std::vector<VkDeviceMemory> materialBuffersDeviceMemory;
+	std::vector<void*> materialBuffersMapped;
+
+	// the latest state and the slots every frame's set still has to catch up on
+	std::vector<VkImageView> textureViews;
+	std::vector<VkSampler> textureSamplers;
+	std::vector<BkMaterial> materials;
+	std::vector<std::vector<uint32_t>> framesDirtyTextures;
+	std::vector<bool> framesDirtyMaterials;
+
+public:
+	BkBindlessTable(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, uint32_t maxTextures = BINDLESS_MAX_TEXTURES, uint32_t maxMaterials = BINDLESS_MAX_MATERIALS);
+	~BkBindlessTable();
+
+	// true if the device supports the descriptor indexing features the table
+	// needs (they also have to be enabled on the device)
+	static bool isSupported(VkPhysicalDevice physicalDevice);
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const;
+
+	VkDescriptorSet getDescriptorSet(uint32_t frame) const;
+
+	uint32_t getMaxTextureCount() const;
+
+	// point a slot of the texture array at an image view and sampler, unchanged
+	// slots are ignored so this can be called every frame
+	void setTexture(uint32_t slot, VkImageView imageView, VkSampler sampler);
+
+	uint32_t addMaterial(const BkMaterial& material);
+
+	void setMaterial(uint32_t index, const BkMaterial& material);
+
+	// write the textures and materials changed since the frame's set was last
+	// flushed; call after waiting for the frame's fence
+	void flush(uint32_t frame);
+};
@@ -0,0 +1,656 @@
+#include "BkBvh.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include "BkJobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BK_BVH_SSE
+#include <emmintrin.h>
+#endif
+
+void BkAabb::grow(const glm::vec3& point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+void BkAabb::grow(const BkAabb& aabb)
+{
+	min = glm::min(min, aabb.min);
+	max = glm::max(max, aabb.max);
+}
+
+glm::vec3 BkAabb::getCenter() const
+{
+	return (min + max) * 0.5f;
+}
+
+float BkAabb::getHalfArea() const
+{
+	glm::vec3 extent = max - min;
+	if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+	{
+		return 0.0f;
+	}
+	return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+// the ray with the reciprocal direction the slab tests divide by
+struct BvhRay {
+	glm::vec3 origin;
+	glm::vec3 inverseDirection;
+};
+
+static bool isAabbInFrustum(const BkFrustum& frustum, const BkAabb& aabb)
+{
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		// the corner furthest along the plane normal
+		glm::vec3 corner(plane.x >= 0.0f ? aabb.max.x : aabb.min.x, plane.y >= 0.0f ? aabb.max.y : aabb.min.y, plane.z >= 0.0f ? aabb.max.z : aabb.min.z);
+		if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void BkBvh::setWideBounds(WideNode& wideNode, uint32_t lane, const BkAabb& bounds)
+{
+	wideNode.minX[lane] = bounds.min.x;
+	wideNode.minY[lane] = bounds.min.y;
+	wideNode.minZ[lane] = bounds.min.z;
+	wideNode.maxX[lane] = bounds.max.x;
+	wideNode.maxY[lane] = bounds.max.y;
+	wideNode.maxZ[lane] = bounds.max.z;
+}
+
+// slab test of the ray against the node's children, returns the mask of the
+// children hit closer than 'distance' and their entry distances
+static uint32_t intersectChildren(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, uint32_t childCount, const BvhRay& ray, float distance, float* entryDistances)
+{
+	uint32_t childMask = (1u << childCount) - 1;
+#ifdef BK_BVH_SSE
+	__m128 originX = _mm_set1_ps(ray.origin.x);
+	__m128 originY = _mm_set1_ps(ray.origin.y);
+	__m128 originZ = _mm_set1_ps(ray.origin.z);
+	__m128 inverseX = _mm_set1_ps(ray.inverseDirection.x);
+	__m128 inverseY = _mm_set1_ps(ray.inverseDirection.y);
+	__m128 inverseZ = _mm_set1_ps(ray.inverseDirection.z);
+
+	__m128 t0X = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(minX), originX), inverseX);
+	__m128 t1X = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxX), originX), inverseX);
+	__m128 t0Y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(minY), originY), inverseY);
+	__m128 t1Y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxY), originY), inverseY);
+	__m128 t0Z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(minZ), originZ), inverseZ);
+	__m128 t1Z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxZ), originZ), inverseZ);
+
+	__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0X, t1X), _mm_min_ps(t0Y, t1Y)), _mm_max_ps(_mm_min_ps(t0Z, t1Z), _mm_setzero_ps()));
+	__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0X, t1X), _mm_max_ps(t0Y, t1Y)), _mm_min_ps(_mm_max_ps(t0Z, t1Z), _mm_set1_ps(distance)));
+	_mm_storeu_ps(entryDistances, entry);
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(entry, exit))) & childMask;
+#else
+	uint32_t hitMask = 0;
+	for (uint32_t i = 0; i < childCount; i++)
+	{
+		float t0X = (minX[i] - ray.origin.x) * ray.inverseDirection.x;
+		float t1X = (maxX[i] - ray.origin.x) * ray.inverseDirection.x;
+		float t0Y = (minY[i] - ray.origin.y) * ray.inverseDirection.y;
+		float t1Y = (maxY[i] - ray.origin.y) * ray.inverseDirection.y;
+		float t0Z = (minZ[i] - ray.origin.z) * ray.inverseDirection.z;
+		float t1Z = (maxZ[i] - ray.origin.z) * ray.inverseDirection.z;
+		float entry = std::max(std::max(std::min(t0X, t1X), std::min(t0Y, t1Y)), std::max(std::min(t0Z, t1Z), 0.0f));
+		float exit = std::min(std::min(std::max(t0X, t1X), std::max(t0Y, t1Y)), std::min(std::max(t0Z, t1Z), distance));
+		entryDistances[i] = entry;
+		if (entry <= exit)
+		{
+			hitMask |= 1u << i;
+		}
+	}
+	return hitMask & childMask;
+#endif
+}
+
+// frustum test of the node's children, returns the mask of the children at
+// least partly inside and sets 'insideMask' to the ones entirely inside
+static uint32_t cullChildren(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, uint32_t childCount, const BkFrustum& frustum, uint32_t& insideMask)
+{
+	uint32_t childMask = (1u << childCount) - 1;
+	uint32_t outsideMask = 0;
+	uint32_t crossingMask = 0;
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		// the plane normal's signs pick which bounds hold the corner furthest
+		// along it and the one furthest against it, for all children at once
+		const float* farX = plane.x >= 0.0f ? maxX : minX;
+		const float* farY = plane.y >= 0.0f ? maxY : minY;
+		const float* farZ = plane.z >= 0.0f ? maxZ : minZ;
+		const float* nearX = plane.x >= 0.0f ? minX : maxX;
+		const float* nearY = plane.y >= 0.0f ? minY : maxY;
+		const float* nearZ = plane.z >= 0.0f ? minZ : maxZ;
+#ifdef BK_BVH_SSE
+		__m128 normalX = _mm_set1_ps(plane.x);
+		__m128 normalY = _mm_set1_ps(plane.y);
+		__m128 normalZ = _mm_set1_ps(plane.z);
+		__m128 planeDistance = _mm_set1_ps(plane.w);
+		__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_load_ps(farX)), _mm_mul_ps(normalY, _mm_load_ps(farY))), _mm_add_ps(_mm_mul_ps(normalZ, _mm_load_ps(farZ)), planeDistance));
+		__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_load_ps(nearX)), _mm_mul_ps(normalY, _mm_load_ps(nearY))), _mm_add_ps(_mm_mul_ps(normalZ, _mm_load_ps(nearZ)), planeDistance));
+		outsideMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(farDistance, _mm_setzero_ps())));
+		crossingMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(nearDistance, _mm_setzero_ps())));
+#else
+		for (uint32_t i = 0; i < childCount; i++)
+		{
+			if (plane.x * farX[i] + plane.y * farY[i] + plane.z * farZ[i] + plane.w < 0.0f)
+			{
+				outsideMask |= 1u << i;
+			}
+			if (plane.x * nearX[i] + plane.y * nearY[i] + plane.z * nearZ[i] + plane.w < 0.0f)
+			{
+				crossingMask |= 1u << i;
+			}
+		}
+#endif
+	}
+
+	uint32_t visibleMask = ~outsideMask & childMask;
+	insideMask = visibleMask & ~crossingMask;
+	return visibleMask;
+}
+
+void BkBvh::build(const std::vector<BkAabb>& bounds, BkJobSystem* jobSystem)
+{
+	buildNodes.clear();
+	wideNodes.clear();
+	primitiveBounds = bounds;
+	uint32_t primitiveCount = static_cast<uint32_t>(bounds.size());
+	primitiveIndices.resize(primitiveCount);
+	if (primitiveCount == 0)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; i++)
+	{
+		primitiveIndices[i] = i;
+		centroids[i] = bounds[i].getCenter();
+	}
+
+	// a binary tree over n primitives has at most 2n - 1 nodes, allocated
+	// up front so the jobs building the subtrees only bump the node count
+	buildNodes.resize(2 * primitiveCount - 1);
+	std::atomic<uint32_t> nodeCount{ 1 };
+	if (jobSystem != nullptr && primitiveCount >= BVH_PARALLEL_BUILD_THRESHOLD)
+	{
+		BkJobCounter jobCounter;
+		try
+		{
+			buildNode(0, 0, primitiveCount, centroids, nodeCount, jobSystem, &jobCounter);
+		}
+		catch (...)
+		{
+			// the jobs reference the centroids and the node count
+			jobSystem->wait(jobCounter);
+			throw;
+		}
+		jobSystem->wait(jobCounter);
+	}
+	else
+	{
+		buildNode(0, 0, primitiveCount, centroids, nodeCount, nullptr, nullptr);
+	}
+	buildNodes.resize(nodeCount.load());
+
+	// the wide root of a tree that is a single leaf holds only that leaf
+	if (buildNodes[0].primitiveCount > 0)
+	{
+		WideNode wideNode{};
+		wideNode.children[0] = buildNodes[0].first;
+		wideNode.primitiveCounts[0] = buildNodes[0].primitiveCount;
+		wideNode.buildNodes[0] = 0;
+		wideNode.childCount = 1;
+		setWideBounds(wideNode, 0, buildNodes[0].bounds);
+		wideNodes.push_back(wideNode);
+	}
+	else
+	{
+		collapseNode(0);
+	}
+}
+
+void BkBvh::buildNode(uint32_t node, uint32_t begin, uint32_t end, const std::vector<glm::vec3>& centroids, std::atomic<uint32_t>& nodeCount, BkJobSystem* jobSystem, BkJobCounter* jobCounter)
+{
+	BkAabb bounds;
+	BkAabb centroidBounds;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		bounds.grow(primitiveBounds[primitiveIndices[i]]);
+		centroidBounds.grow(centroids[primitiveIndices[i]]);
+	}
+	buildNodes[node].bounds = bounds;
+
+	uint32_t primitiveCount = end - begin;
+	if (primitiveCount <= 1)
+	{
+		buildNodes[node].first = begin;
+		buildNodes[node].primitiveCount = primitiveCount;
+		return;
+	}
+
+	// bin the centroids along every axis and find the split between two bins
+	// with the lowest SAH cost, areas * primitive counts of both sides
+	struct Bin {
+		BkAabb bounds;
+		uint32_t primitiveCount = 0;
+	};
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	glm::vec3 centroidExtent = centroidBounds.max - centroidBounds.min;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (centroidExtent[axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		Bin bins[BVH_BIN_COUNT];
+		float binScale = BVH_BIN_COUNT / centroidExtent[axis];
+		for (uint32_t i = begin; i < end; i++)
+		{
+			uint32_t primitive = primitiveIndices[i];
+			uint32_t bin = std::min(static_cast<uint32_t>((centroids[primitive][axis] - centroidBounds.min[axis]) * binScale), BVH_BIN_COUNT - 1);
+			bins[bin].bounds.grow(primitiveBounds[primitive]);
+			bins[bin].primitiveCount++;
+		}
+
+		// sweep from the right for the side right of every split, then from the
+		// left to evaluate them
+		float rightCosts[BVH_BIN_COUNT - 1];
+		uint32_t rightCounts[BVH_BIN_COUNT - 1];
+		BkAabb rightBounds;
+		uint32_t rightCount = 0;
+		for (uint32_t split = BVH_BIN_COUNT - 1; split > 0; split--)
+		{
+			rightBounds.grow(bins[split].bounds);
+			rightCount += bins[split].primitiveCount;
+			rightCosts[split - 1] = rightBounds.getHalfArea() * rightCount;
+			rightCounts[split - 1] = rightCount;
+		}
+
+		BkAabb leftBounds;
+		uint32_t leftCount = 0;
+		for (uint32_t split = 0; split < BVH_BIN_COUNT - 1; split++)
+		{
+			leftBounds.grow(bins[split].bounds);
+			leftCount += bins[split].primitiveCount;
+			if (leftCount == 0 || rightCounts[split] == 0)
+			{
+				continue;
+			}
+
+			float cost = leftBounds.getHalfArea() * leftCount + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// a small node stays a leaf if testing all its primitives is cheaper than
+	// splitting it
+	float boundsArea = bounds.getHalfArea();
+	float splitCost = bestAxis >= 0 && boundsArea > 0.0f ? BVH_TRAVERSAL_COST + bestCost / boundsArea : FLT_MAX;
+	if (primitiveCount <= BVH_MAX_LEAF_SIZE && (bestAxis < 0 || splitCost >= static_cast<float>(primitiveCount)))
+	{
+		buildNodes[node].first = begin;
+		buildNodes[node].primitiveCount = primitiveCount;
+		return;
+	}
+
+	uint32_t middle = begin + primitiveCount / 2;
+	if (bestAxis >= 0)
+	{
+		float binScale = BVH_BIN_COUNT / centroidExtent[bestAxis];
+		auto split = std::partition(primitiveIndices.begin() + begin, primitiveIndices.begin() + end, [&](uint32_t primitive)
+		{
+			uint32_t bin = std::min(static_cast<uint32_t>((centroids[primitive][bestAxis] - centroidBounds.min[bestAxis]) * binScale), BVH_BIN_COUNT - 1);
+			return bin <= bestSplit;
+		});
+		middle = static_cast<uint32_t>(split - primitiveIndices.begin());
+	}
+	// every centroid is at the same point, split by count instead
+	if (middle == begin || middle == end)
+	{
+		middle = begin + primitiveCount / 2;
+	}
+
+	uint32_t firstChild = nodeCount.fetch_add(2);
+	buildNodes[node].first = firstChild;
+	buildNodes[node].primitiveCount = 0;
+
+	if (jobSystem != nullptr && middle - begin >= BVH_PARALLEL_BUILD_THRESHOLD)
+	{
+		jobSystem->run(*jobCounter, [this, firstChild, begin, middle, &centroids, &nodeCount, jobSystem, jobCounter]()
+		{
+			buildNode(firstChild, begin, middle, centroids, nodeCount, jobSystem, jobCounter);
+		});
+	}
+	else
+	{
+		buildNode(firstChild, begin, middle, centroids, nodeCount, jobSystem, jobCounter);
+	}
+	buildNode(firstChild + 1, middle, end, centroids, nodeCount, jobSystem, jobCounter);
+}
+
+uint32_t BkBvh::collapseNode(uint32_t node)
+{
+	// pull up the grandchildren of the largest inner children until there are
+	// four children
+	uint32_t children[4] = { buildNodes[node].first, buildNodes[node].first + 1 };
+	uint32_t childCount = 2;
+	while (childCount < 4)
+	{
+		int largestChild = -1;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; i++)
+		{
+			const BuildNode& child = buildNodes[children[i]];
+			if (child.primitiveCount == 0 && child.bounds.getHalfArea() > largestArea)
+			{
+				largestChild = static_cast<int>(i);
+				largestArea = child.bounds.getHalfArea();
+			}
+		}
+		if (largestChild < 0)
+		{
+			break;
+		}
+
+		uint32_t firstGrandchild = buildNodes[children[largestChild]].first;
+		children[largestChild] = firstGrandchild;
+		children[childCount++] = firstGrandchild + 1;
+	}
+
+	// allocated before its children, so parents come first
+	uint32_t wideNode = static_cast<uint32_t>(wideNodes.size());
+	wideNodes.emplace_back();
+	wideNodes[wideNode].childCount = childCount;
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		setWideBounds(wideNodes[wideNode], lane, lane < childCount ? buildNodes[children[lane]].bounds : BkAabb());
+		wideNodes[wideNode].children[lane] = 0;
+		wideNodes[wideNode].primitiveCounts[lane] = 0;
+		wideNodes[wideNode].buildNodes[lane] = 0;
+	}
+
+	for (uint32_t lane = 0; lane < childCount; lane++)
+	{
+		const BuildNode& child = buildNodes[children[lane]];
+		wideNodes[wideNode].buildNodes[lane] = children[lane];
+		if (child.primitiveCount > 0)
+		{
+			wideNodes[wideNode].children[lane] = child.first;
+			wideNodes[wideNode].primitiveCounts[lane] = child.primitiveCount;
+		}
+		else
+		{
+			// may reallocate the wide nodes
+			uint32_t wideChild = collapseNode(children[lane]);
+			wideNodes[wideNode].children[lane] = wideChild;
+		}
+	}
+	return wideNode;
+}
+
+void BkBvh::refit(const std::vector<BkAabb>& bounds)
+{
+	if (bounds.size() != primitiveBounds.size())
+	{
+		throw std::runtime_error("ERROR: a BVH can only be refit to as many primitives as it was built with!");
+	}
+	primitiveBounds = bounds;
+
+	// children come after their parents
+	for (size_t i = buildNodes.size(); i-- > 0;)
+	{
+		BuildNode& node = buildNodes[i];
+		BkAabb nodeBounds;
+		if (node.primitiveCount > 0)
+		{
+			for (uint32_t j = node.first; j < node.first + node.primitiveCount; j++)
+			{
+				nodeBounds.grow(primitiveBounds[primitiveIndices[j]]);
+			}
+		}
+		else
+		{
+			nodeBounds = buildNodes[node.first].bounds;
+			nodeBounds.grow(buildNodes[node.first + 1].bounds);
+		}
+		node.bounds = nodeBounds;
+	}
+
+	for (WideNode& wideNode : wideNodes)
+	{
+		for (uint32_t lane = 0; lane < wideNode.childCount; lane++)
+		{
+			setWideBounds(wideNode, lane, buildNodes[wideNode.buildNodes[lane]].bounds);
+		}
+	}
+}
+
+bool BkBvh::isEmpty() const
+{
+	return wideNodes.empty();
+}
+
+uint32_t BkBvh::getNodeCount() const
+{
+	return static_cast<uint32_t>(wideNodes.size());
+}
+
+void BkBvh::appendSubtree(uint32_t wideNode, std::vector<uint32_t>& primitives) const
+{
+	const WideNode& node = wideNodes[wideNode];
+	for (uint32_t lane = 0; lane < node.childCount; lane++)
+	{
+		if (node.primitiveCounts[lane] > 0)
+		{
+			primitives.insert(primitives.end(), primitiveIndices.begin() + node.children[lane], primitiveIndices.begin() + node.children[lane] + node.primitiveCounts[lane]);
+		}
+		else
+		{
+			appendSubtree(node.children[lane], primitives);
+		}
+	}
+}
+
+void BkBvh::cullFrustum(const BkFrustum& frustum, std::vector<uint32_t>& visiblePrimitives) const
+{
+	if (wideNodes.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const WideNode& node = wideNodes[stack.back()];
+		stack.pop_back();
+
+		uint32_t insideMask = 0;
+		uint32_t visibleMask = cullChildren(node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, node.childCount, frustum, insideMask);
+		for (uint32_t lane = 0; lane < node.childCount; lane++)
+		{
+			if (!(visibleMask & (1u << lane)))
+			{
+				continue;
+			}
+
+			bool bInside = (insideMask & (1u << lane)) != 0;
+			if (node.primitiveCounts[lane] == 0)
+			{
+				if (bInside)
+				{
+					appendSubtree(node.children[lane], visiblePrimitives);
+				}
+				else
+				{
+					stack.push_back(node.children[lane]);
+				}
+				continue;
+			}
+
+			// the primitives of a leaf crossing a plane are tested on their own
+			for (uint32_t i = node.children[lane]; i < node.children[lane] + node.primitiveCounts[lane]; i++)
+			{
+				uint32_t primitive = primitiveIndices[i];
+				if (bInside || isAabbInFrustum(frustum, primitiveBounds[primitive]))
+				{
+					visiblePrimitives.push_back(primitive);
+				}
+			}
+		}
+	}
+}
+
+uint32_t BkBvh::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance, const std::function<bool(uint32_t, float&)>& intersect) const
+{
+	if (wideNodes.empty())
+	{
+		return BVH_NO_HIT;
+	}
+
+	BvhRay ray;
+	ray.origin = origin;
+	ray.inverseDirection = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// nodes still to visit with the distance the ray enters them, nearer
+	// nodes are on top
+	struct StackEntry {
+		uint32_t node;
+		float entryDistance;
+	};
+	std::vector<StackEntry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, 0.0f });
+
+	uint32_t hitPrimitive = BVH_NO_HIT;
+	while (!stack.empty())
+	{
+		StackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.entryDistance > distance)
+		{
+			continue;
+		}
+
+		const WideNode& node = wideNodes[entry.node];
+		alignas(16) float entryDistances[4];
+		uint32_t hitMask = intersectChildren(node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, node.childCount, ray, distance, entryDistances);
+		if (hitMask == 0)
+		{
+			continue;
+		}
+
+		// order the hit children front to back
+		uint32_t hitLanes[4];
+		uint32_t hitCount = 0;
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (hitMask & (1u << lane))
+			{
+				uint32_t i = hitCount++;
+				for (; i > 0 && entryDistances[hitLanes[i - 1]] > entryDistances[lane]; i--)
+				{
+					hitLanes[i] = hitLanes[i - 1];
+				}
+				hitLanes[i] = lane;
+			}
+		}
+
+		// leaves are tested right away, inner children pushed far to near
+		for (uint32_t i = 0; i < hitCount; i++)
+		{
+			uint32_t lane = hitLanes[i];
+			if (node.primitiveCounts[lane] == 0 || entryDistances[lane] > distance)
+			{
+				continue;
+			}
+			for (uint32_t j = node.children[lane]; j < node.children[lane] + node.primitiveCounts[lane]; j++)
+			{
+				if (intersect(primitiveIndices[j], distance))
+				{
+					hitPrimitive = primitiveIndices[j];
+				}
+			}
+		}
+		for (uint32_t i = hitCount; i-- > 0;)
+		{
+			uint32_t lane = hitLanes[i];
+			if (node.primitiveCounts[lane] == 0)
+			{
+				stack.push_back({ node.children[lane], entryDistances[lane] });
+			}
+		}
+	}
+	return hitPrimitive;
+}
+
+void computeTriangleBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, std::vector<BkAabb>& bounds)
+{
+	bounds.resize(indexCount / 3);
+	for (uint32_t i = 0; i < indexCount / 3; i++)
+	{
+		BkAabb triangleBounds;
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			triangleBounds.grow(vertices[indices[firstIndex + 3 * i + j]].pos);
+		}
+		bounds[i] = triangleBounds;
+	}
+}
+
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance)
+{
+	glm::vec3 edge1 = v1 - v0;
+	glm::vec3 edge2 = v2 - v0;
+	glm::vec3 p = glm::cross(direction, edge2);
+	float determinant = glm::dot(edge1, p);
+
+	// parallel to the triangle's plane
+	if (std::abs(determinant) < 1e-12f)
+	{
+		return false;
+	}
+
+	float inverseDeterminant = 1.0f / determinant;
+	glm::vec3 s = origin - v0;
+	float u = glm::dot(s, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	float t = glm::dot(edge2, q) * inverseDeterminant;
+	if (t < 0.0f || t >= distance)
+	{
+		return false;
+	}
+	distance = t;
+	return true;
+}
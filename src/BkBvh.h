@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "BkVertex.h"
+#include "BkMeshlet.h"
+
+class BkJobSystem;
+struct BkJobCounter;
+
+// primitives a leaf holds at most, and at most SAH splits per axis
+const uint32_t BVH_MAX_LEAF_SIZE = 4;
+const uint32_t BVH_BIN_COUNT = 16;
+
+// SAH cost of visiting a node relative to testing one primitive
+const float BVH_TRAVERSAL_COST = 1.0f;
+
+// nodes with fewer primitives are built by the job that split their parent
+const uint32_t BVH_PARALLEL_BUILD_THRESHOLD = 4096;
+
+// returned by intersectRay() if nothing was hit
+const uint32_t BVH_NO_HIT = UINT32_MAX;
+
+struct BkAabb {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	void grow(const glm::vec3& point);
+
+	void grow(const BkAabb& aabb);
+
+	glm::vec3 getCenter() const;
+
+	// half the surface area, enough to compare costs
+	float getHalfArea() const;
+};
+
+// bounding volume hierarchy over the bounds of arbitrary primitives (scene
+// instances, triangles, meshlets); built top down with the surface area
+// heuristic over binned centroids, then collapsed into 4 wide nodes whose
+// children are tested at once with SSE
+class BkBvh
+{
+private:
+	// binary build node, inner nodes have their two children next to each
+	// other and always after themselves
+	struct BuildNode {
+		BkAabb bounds;
+		// first child, or first primitive of a leaf
+		uint32_t first;
+		// 0 for inner nodes
+		uint32_t primitiveCount;
+	};
+
+	// 4 children of a collapsed node with their bounds as structure of arrays
+	struct alignas(16) WideNode {
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		// wide node of an inner child, first primitive of a leaf child
+		uint32_t children[4];
+		// 0 for inner children
+		uint32_t primitiveCounts[4];
+		// build node of every child, to refit the bounds
+		uint32_t buildNodes[4];
+		uint32_t childCount;
+	};
+
+	std::vector<BuildNode> buildNodes;
+	std::vector<WideNode> wideNodes;
+
+	// the primitives in leaf order, and every primitive's bounds in the
+	// original order
+	std::vector<uint32_t> primitiveIndices;
+	std::vector<BkAabb> primitiveBounds;
+
+	// split the node's primitives into two children, in parallel for large
+	// nodes if there is a job system
+	void buildNode(uint32_t node, uint32_t begin, uint32_t end, const std::vector<glm::vec3>& centroids, std::atomic<uint32_t>& nodeCount, BkJobSystem* jobSystem, BkJobCounter* jobCounter);
+
+	// create the wide node of a binary inner node, returns its index
+	uint32_t collapseNode(uint32_t node);
+
+	void setWideBounds(WideNode& wideNode, uint32_t lane, const BkAabb& bounds);
+
+	// append the primitives of the subtree without testing them
+	void appendSubtree(uint32_t wideNode, std::vector<uint32_t>& primitives) const;
+
+public:
+	BkBvh() = default;
+
+	// build over 'bounds', indexed by primitive; with a job system the
+	// subtrees are built in parallel
+	void build(const std::vector<BkAabb>& bounds, BkJobSystem* jobSystem = nullptr);
+
+	// update the node bounds to the primitives' new bounds without changing
+	// the tree, cheap for moving primitives but the tree quality degrades the
+	// further they move from where it was built
+	void refit(const std::vector<BkAabb>& bounds);
+
+	bool isEmpty() const;
+
+	uint32_t getNodeCount() const;
+
+	// append every primitive whose bounds are at least partly inside the
+	// frustum, which has to be in the space of the bounds
+	void cullFrustum(const BkFrustum& frustum, std::vector<uint32_t>& visiblePrimitives) const;
+
+	// nearest primitive hit by the ray, or BVH_NO_HIT; 'intersect(primitive,
+	// distance)' returns true and lowers 'distance' if the ray hits the
+	// primitive closer than 'distance', which is the closest hit on return
+	uint32_t intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance, const std::function<bool(uint32_t, float&)>& intersect) const;
+};
+
+// bounds of every triangle in [firstIndex, firstIndex + indexCount), indexed
+// by triangle
+void computeTriangleBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, std::vector<BkAabb>& bounds);
+
+// Moller-Trumbore, true and 'distance' lowered if the triangle is hit closer
+// than 'distance' (both sides count)
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance);
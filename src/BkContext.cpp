@@ -0,0 +1,366 @@
+#include "BkContext.h"
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <set>
+#include <optional>
+#include <stdexcept>
+
+#include "BkDeviceSelector.h"
+
+#ifdef NDEBUG
+const bool enableValidationLayers = false;
+#else
+const bool enableValidationLayers = true;
+#endif
+// validation layers for basic error checking
+const std::vector<const char*> validationLayers = {
+	"VK_LAYER_KHRONOS_validation"
+};
+// add swapchain compatability to required physical device extensions
+const std::vector<const char*> requiredPhysicalDeviceExtensions = {
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+};
+
+// callback function for debug utils messenger create info
+static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+{
+	std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+    return VK_FALSE;
+}
+// vkCreateDebugUtilsMessengerEXT is not automatically loaded because it's an
+// extension function so we look up its address using vkGetInstanceProcAddr
+static VkResult createDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
+    auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+    if (func != nullptr)
+        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+    else
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+}
+static void destroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
+    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+    if (func != nullptr) {
+        func(instance, debugMessenger, pAllocator);
+    }
+}
+// create a vulkan instance
+static VkResult createInstance(const VkApplicationInfo& appInfo, const VkDebugUtilsMessengerCreateInfoEXT& debugUtilsMsgrCreateInfo, VkInstance& instance)
+{
+	// ensure instance's layer properties contian validation layers
+	if (enableValidationLayers)
+	{
+		uint32_t layerCount;
+		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+		std::vector<VkLayerProperties> availableLayers(layerCount);
+		vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+		for (const char* layerName : validationLayers)
+		{
+			bool layerFound = false;
+			for (const auto& layerProperties : availableLayers)
+			{
+				if (strcmp(layerName, layerProperties.layerName) == 0)
+				{
+					layerFound = true;
+					break;
+				}
+			}
+			if (!layerFound)
+			{
+				throw std::runtime_error("ERROR: validation layer '" + static_cast<std::string>(layerName) + "' requested, but not available!");
+			}
+		}
+	}
+
+	VkInstanceCreateInfo instanceCreateInfo{};
+	instanceCreateInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceCreateInfo.pApplicationInfo = &appInfo;
+
+	// enable the GLFW extensions & debug extensions on the vk instance
+	uint32_t glfwExtensionCount = 0;
+	const char** glfwExtensions;
+	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> instanceExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	if (enableValidationLayers)
+	{
+		instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	}
+	instanceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>(instanceExtensions.size());
+	instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions.data();
+
+	// set validation layers & debug messenger to enable debuging on instance creation/deletion
+	if (enableValidationLayers)
+	{
+		instanceCreateInfo.enabledLayerCount   = static_cast<uint32_t>(validationLayers.size());
+		instanceCreateInfo.ppEnabledLayerNames = validationLayers.data();
+		instanceCreateInfo.pNext               = (VkDebugUtilsMessengerCreateInfoEXT*)&debugUtilsMsgrCreateInfo;
+	}
+	else
+	{
+		instanceCreateInfo.enabledLayerCount = 0;
+		instanceCreateInfo.pNext             = nullptr;
+	}
+
+	// create a vulkan instance
+	return vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+}
+static void getQueueFamiliesIndex(const VkPhysicalDevice& physicalDevice, const VkSurfaceKHR& surface, std::optional<uint32_t>& graphicsQueueFamilyIndex, std::optional<uint32_t>& presentQueueFamilyIndex, std::optional<uint32_t>& computeQueueFamilyIndex)
+{
+	// get queue families properties
+	uint32_t queueFamiliesCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamiliesProperties(queueFamiliesCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamiliesCount, queueFamiliesProperties.data());
+
+	int i = 0;
+	bool bFoundGraphicsPresentFamily = false;
+	for (const auto& queueFamilyProperties : queueFamiliesProperties)
+	{
+		// supports graphics queue
+		if ((queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !graphicsQueueFamilyIndex.has_value())
+		{
+			graphicsQueueFamilyIndex = i;
+		}
+
+		// look for a queue family that supports presenting to the window
+		VkBool32 bPresentSupport = false;
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &bPresentSupport);
+		if (bPresentSupport && !presentQueueFamilyIndex.has_value())
+		{
+			presentQueueFamilyIndex = i;
+		}
+
+		// prefer a single family for graphics and present
+		if ((queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT) && bPresentSupport && !bFoundGraphicsPresentFamily)
+		{
+			graphicsQueueFamilyIndex = i;
+			presentQueueFamilyIndex = i;
+			bFoundGraphicsPresentFamily = true;
+		}
+
+		// a compute family without graphics runs on the async compute engines
+		// of the GPU and can overlap with rendering
+		if ((queueFamilyProperties.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !computeQueueFamilyIndex.has_value())
+		{
+			computeQueueFamilyIndex = i;
+		}
+
+		i++;
+	}
+	if (!graphicsQueueFamilyIndex.has_value())
+	{
+		throw std::runtime_error("ERROR: failed to find a suitable GPU with a queue family that supports VK_QUEUE_GRAPHICS_BIT!");
+	}
+	if (!presentQueueFamilyIndex.has_value())
+	{
+		throw std::runtime_error("ERROR: failed to find a suitable GPU with a queue family that has surface support!");
+	}
+
+	// without a dedicated compute family the compute work is submitted to the
+	// graphics queue (graphics families always support compute)
+	if (!computeQueueFamilyIndex.has_value())
+	{
+		computeQueueFamilyIndex = graphicsQueueFamilyIndex;
+	}
+}
+// create vulkan device
+static VkResult createDevice(const std::optional<uint32_t>& graphicsQueueFamilyIndex, const std::optional<uint32_t>& presentQueueFamilyIndex, const std::optional<uint32_t>& computeQueueFamilyIndex, const VkPhysicalDevice& physicalDevice, VkDevice& device)
+{
+	// for each unique queue index, populate device queue create infos
+	std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfos;
+	std::set<uint32_t> uniqueQueueFamilyIndices = { graphicsQueueFamilyIndex.value(), presentQueueFamilyIndex.value(), computeQueueFamilyIndex.value() };
+	float queuePriority = 1.0f;
+	for (uint32_t queueFamilyIndex : uniqueQueueFamilyIndices)
+	{
+		VkDeviceQueueCreateInfo deviceQueueCreateInfo{};
+		deviceQueueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+		deviceQueueCreateInfo.queueCount       = 1;
+		deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+		deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
+	}
+
+	// specify device features we queried for using vkGetPhysicalDeviceFeatures
+	VkPhysicalDeviceFeatures supportedPhysicalDeviceFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedPhysicalDeviceFeatures);
+	VkPhysicalDeviceFeatures physicalDeviceFeatures{};
+	physicalDeviceFeatures.samplerAnisotropy = supportedPhysicalDeviceFeatures.samplerAnisotropy;
+
+	// draw all visible meshlets with a single indirect draw when supported
+	physicalDeviceFeatures.multiDrawIndirect = supportedPhysicalDeviceFeatures.multiDrawIndirect;
+
+	// enable the descriptor indexing features of the bindless renderer when
+	// supported (core in Vulkan 1.2)
+	VkPhysicalDeviceVulkan12Features supportedPhysicalDeviceVulkan12Features{};
+	supportedPhysicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedPhysicalDeviceFeatures2{};
+	supportedPhysicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedPhysicalDeviceFeatures2.pNext = &supportedPhysicalDeviceVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedPhysicalDeviceFeatures2);
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	physicalDeviceVulkan12Features.runtimeDescriptorArray = supportedPhysicalDeviceVulkan12Features.runtimeDescriptorArray;
+	physicalDeviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedPhysicalDeviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+	physicalDeviceVulkan12Features.descriptorBindingPartiallyBound = supportedPhysicalDeviceVulkan12Features.descriptorBindingPartiallyBound;
+	physicalDeviceVulkan12Features.descriptorBindingVariableDescriptorCount = supportedPhysicalDeviceVulkan12Features.descriptorBindingVariableDescriptorCount;
+	physicalDeviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = supportedPhysicalDeviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+
+	// track frame completion with a timeline semaphore when supported
+	physicalDeviceVulkan12Features.timelineSemaphore = supportedPhysicalDeviceVulkan12Features.timelineSemaphore;
+
+	// draw the meshlets the occlusion culling appended with a GPU side count
+	physicalDeviceVulkan12Features.drawIndirectCount = supportedPhysicalDeviceVulkan12Features.drawIndirectCount;
+
+	// populate device create info
+	VkDeviceCreateInfo deviceCreateInfo{};
+	deviceCreateInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext                = &physicalDeviceVulkan12Features;
+	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size());
+	deviceCreateInfo.pQueueCreateInfos    = deviceQueueCreateInfos.data();
+	deviceCreateInfo.pEnabledFeatures     = &physicalDeviceFeatures;
+
+	// specify extensions and validation layers for the device
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredPhysicalDeviceExtensions.size());
+	deviceCreateInfo.ppEnabledExtensionNames = requiredPhysicalDeviceExtensions.data();
+	if (enableValidationLayers)
+	{
+		deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		deviceCreateInfo.ppEnabledLayerNames = validationLayers.data();
+	}
+	else
+	{
+		deviceCreateInfo.enabledLayerCount = 0;
+	}
+
+	return vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+}
+
+BkContext::BkContext(GLFWwindow* window, const std::string& deviceOverride)
+	: window(window)
+{
+	const char* APPLICATION_NAME = "BULKAN";
+	const char* ENGINE_NAME = "BULKAN";
+	VkApplicationInfo appInfo{};
+	appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName   = APPLICATION_NAME;
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName        = ENGINE_NAME;
+	appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion         = VK_API_VERSION_1_3;
+
+	VkDebugUtilsMessengerCreateInfoEXT debugUtilsMsgrCreateInfo{};
+	debugUtilsMsgrCreateInfo.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	debugUtilsMsgrCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	debugUtilsMsgrCreateInfo.messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	debugUtilsMsgrCreateInfo.pfnUserCallback = debugCallback;
+
+	if (createInstance(appInfo, debugUtilsMsgrCreateInfo, instance) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateInstance()' failed to create an instance!");
+	}
+
+	if (enableValidationLayers)
+	{
+		if (createDebugUtilsMessengerEXT(instance, &debugUtilsMsgrCreateInfo, nullptr, &debugMessenger) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'CreateDebugUtilsMessengerEXT' failed to set up debug messenger!");
+		}
+	}
+
+	// create a SurfaceKHR using GLFW to maintain non-platform specific calls
+	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'glfwCreateWindowSurface' failed to create a VkSurfaceKHR!");
+	}
+
+	// pick the highest scoring device unless one is forced with --device or
+	// BULKAN_DEVICE
+	physicalDevice = selectPhysicalDevice(instance, surface, requiredPhysicalDeviceExtensions, deviceOverride);
+
+	// determine if GPU is suitable by seeing if queue family supports graphics
+	// & supports presenting to the window
+	std::optional<uint32_t> graphicsQueueFamily;
+	std::optional<uint32_t> presentQueueFamily;
+	std::optional<uint32_t> computeQueueFamily;
+	getQueueFamiliesIndex(physicalDevice, surface, graphicsQueueFamily, presentQueueFamily, computeQueueFamily);
+	graphicsQueueFamilyIndex = graphicsQueueFamily.value();
+	presentQueueFamilyIndex = presentQueueFamily.value();
+	computeQueueFamilyIndex = computeQueueFamily.value();
+
+	if (createDevice(graphicsQueueFamily, presentQueueFamily, computeQueueFamily, physicalDevice, device) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDevice' failed to create vulkan device!");
+	}
+
+	// create a handle to interface with the queues that were created with the
+	// logical device
+	vkGetDeviceQueue(device, graphicsQueueFamilyIndex, 0, &graphicsQueue);
+	vkGetDeviceQueue(device, presentQueueFamilyIndex, 0, &presentQueue);
+	vkGetDeviceQueue(device, computeQueueFamilyIndex, 0, &computeQueue);
+}
+
+BkContext::~BkContext()
+{
+	vkDestroyDevice(device, nullptr);
+	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (enableValidationLayers)
+	{
+		destroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+	}
+	vkDestroyInstance(instance, nullptr);
+}
+
+GLFWwindow* BkContext::getWindow() const
+{
+	return window;
+}
+
+VkInstance BkContext::getInstance() const
+{
+	return instance;
+}
+
+VkSurfaceKHR BkContext::getSurface() const
+{
+	return surface;
+}
+
+VkPhysicalDevice BkContext::getPhysicalDevice() const
+{
+	return physicalDevice;
+}
+
+VkDevice BkContext::getDevice() const
+{
+	return device;
+}
+
+uint32_t BkContext::getGraphicsQueueFamilyIndex() const
+{
+	return graphicsQueueFamilyIndex;
+}
+
+uint32_t BkContext::getPresentQueueFamilyIndex() const
+{
+	return presentQueueFamilyIndex;
+}
+
+uint32_t BkContext::getComputeQueueFamilyIndex() const
+{
+	return computeQueueFamilyIndex;
+}
+
+VkQueue BkContext::getGraphicsQueue() const
+{
+	return graphicsQueue;
+}
+
+VkQueue BkContext::getPresentQueue() const
+{
+	return presentQueue;
+}
+
+VkQueue BkContext::getComputeQueue() const
+{
+	return computeQueue;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <string>
+#include <cstdint>
+
+// the Vulkan instance, window surface, device and queues shared by
+// everything that renders to a window; the application creates the window
+// and the context, then hands the context to the renderer
+class BkContext
+{
+private:
+	GLFWwindow* window;
+	VkInstance instance;
+	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+	VkSurfaceKHR surface;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// the compute family is the graphics family if there is no dedicated one
+	uint32_t graphicsQueueFamilyIndex;
+	uint32_t presentQueueFamilyIndex;
+	uint32_t computeQueueFamilyIndex;
+	VkQueue graphicsQueue;
+	VkQueue presentQueue;
+	VkQueue computeQueue;
+
+public:
+	// 'deviceOverride' forces a physical device, see getDeviceOverride
+	BkContext(GLFWwindow* window, const std::string& deviceOverride = "");
+	~BkContext();
+
+	BkContext(const BkContext&) = delete;
+	BkContext& operator=(const BkContext&) = delete;
+
+	GLFWwindow* getWindow() const;
+	VkInstance getInstance() const;
+	VkSurfaceKHR getSurface() const;
+	VkPhysicalDevice getPhysicalDevice() const;
+	VkDevice getDevice() const;
+
+	uint32_t getGraphicsQueueFamilyIndex() const;
+	uint32_t getPresentQueueFamilyIndex() const;
+	uint32_t getComputeQueueFamilyIndex() const;
+	VkQueue getGraphicsQueue() const;
+	VkQueue getPresentQueue() const;
+	VkQueue getComputeQueue() const;
+};
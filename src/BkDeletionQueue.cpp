@@ -0,0 +1,43 @@
+#include "BkDeletionQueue.h"
+#include <algorithm>
+
+BkDeletionQueue::~BkDeletionQueue()
+{
+	flush();
+}
+
+void BkDeletionQueue::push(uint64_t lastUseValue, std::function<void()> deleter)
+{
+	auto it = deletions.end();
+	if (!deletions.empty() && deletions.back().lastUseValue > lastUseValue)
+	{
+		it = std::upper_bound(deletions.begin(), deletions.end(), lastUseValue, [](uint64_t value, const Deletion& deletion) { return value < deletion.lastUseValue; });
+	}
+	deletions.insert(it, { lastUseValue, std::move(deleter) });
+}
+
+void BkDeletionQueue::collect(uint64_t completedValue)
+{
+	while (!deletions.empty() && deletions.front().lastUseValue <= completedValue)
+	{
+		// pop before running so a deleter may push new deletions
+		std::function<void()> deleter = std::move(deletions.front().deleter);
+		deletions.pop_front();
+		deleter();
+	}
+}
+
+void BkDeletionQueue::flush()
+{
+	while (!deletions.empty())
+	{
+		std::function<void()> deleter = std::move(deletions.back().deleter);
+		deletions.pop_back();
+		deleter();
+	}
+}
+
+size_t BkDeletionQueue::size() const
+{
+	return deletions.size();
+}
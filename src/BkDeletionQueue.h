@@ -0,0 +1,35 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+// defers the destruction of GPU objects until the GPU is done with them;
+// every deleter is tagged with the value (frame number or timeline semaphore
+// value) of the last submission that may use the object and runs once that
+// value has completed, so objects can be replaced without idling the device
+class BkDeletionQueue
+{
+private:
+	struct Deletion {
+		uint64_t lastUseValue;
+		std::function<void()> deleter;
+	};
+
+	// ordered by lastUseValue
+	std::deque<Deletion> deletions;
+
+public:
+	~BkDeletionQueue();
+
+	// values pushed out of order are kept sorted, the common case of a
+	// non-decreasing value is an append
+	void push(uint64_t lastUseValue, std::function<void()> deleter);
+
+	// run the deleters of everything last used at or before 'completedValue'
+	void collect(uint64_t completedValue);
+
+	// run every remaining deleter, newest first; the device has to be idle
+	void flush();
+
+	size_t size() const;
+};
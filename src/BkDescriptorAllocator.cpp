@@ -0,0 +1,189 @@
+#include "BkDescriptorAllocator.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+BkDescriptorAllocator::BkDescriptorAllocator(VkDevice device, const std::vector<BkDescriptorPoolRatio>& poolRatios, uint32_t initialSetsPerPool)
+	: device(device), poolRatios(poolRatios), setsPerPool(initialSetsPerPool)
+{
+}
+
+BkDescriptorAllocator::~BkDescriptorAllocator()
+{
+	if (currentPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, currentPool, nullptr);
+	}
+	for (VkDescriptorPool descriptorPool : usedPools)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	}
+	for (VkDescriptorPool descriptorPool : freePools)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	}
+}
+
+VkDescriptorPool BkDescriptorAllocator::createPool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
+	for (const BkDescriptorPoolRatio& poolRatio : poolRatios)
+	{
+		VkDescriptorPoolSize descriptorPoolSize{};
+		descriptorPoolSize.type = poolRatio.descriptorType;
+		descriptorPoolSize.descriptorCount = std::max(1u, static_cast<uint32_t>(poolRatio.ratio * setCount));
+		descriptorPoolSizes.push_back(descriptorPoolSize);
+	}
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+	descriptorPoolCreateInfo.maxSets = setCount;
+
+	VkDescriptorPool descriptorPool;
+	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorPool' failed to create a descriptor pool!");
+	}
+	return descriptorPool;
+}
+
+VkDescriptorPool BkDescriptorAllocator::grabPool()
+{
+	// reuse a reset pool before creating a new one; the pools of a chain only
+	// grow, so a free pool is never smaller than needed
+	if (!freePools.empty())
+	{
+		VkDescriptorPool descriptorPool = freePools.back();
+		freePools.pop_back();
+		return descriptorPool;
+	}
+
+	VkDescriptorPool descriptorPool = createPool(setsPerPool);
+	setsPerPool = std::min(setsPerPool * 2, DESCRIPTOR_POOL_MAX_SETS);
+	return descriptorPool;
+}
+
+VkDescriptorSet BkDescriptorAllocator::allocate(VkDescriptorSetLayout descriptorSetLayout)
+{
+	if (currentPool == VK_NULL_HANDLE)
+	{
+		currentPool = grabPool();
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.descriptorPool = currentPool;
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+	descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		// the full pool is only revisited after the next reset
+		usedPools.push_back(currentPool);
+		currentPool = grabPool();
+		descriptorSetAllocateInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+	}
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateDescriptorSets' failed to allocate a descriptor set!");
+	}
+	return descriptorSet;
+}
+
+void BkDescriptorAllocator::reset()
+{
+	if (currentPool != VK_NULL_HANDLE)
+	{
+		usedPools.push_back(currentPool);
+		currentPool = VK_NULL_HANDLE;
+	}
+	for (VkDescriptorPool descriptorPool : usedPools)
+	{
+		vkResetDescriptorPool(device, descriptorPool, 0);
+		freePools.push_back(descriptorPool);
+	}
+	usedPools.clear();
+}
+
+uint32_t BkDescriptorAllocator::getPoolCount() const
+{
+	return static_cast<uint32_t>(usedPools.size() + freePools.size()) + (currentPool != VK_NULL_HANDLE ? 1 : 0);
+}
+
+bool BkDescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+{
+	if (flags != other.flags || bindings.size() != other.bindings.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const VkDescriptorSetLayoutBinding& a = bindings[i];
+		const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t BkDescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+{
+	size_t hash = std::hash<uint32_t>()(key.flags);
+	for (const VkDescriptorSetLayoutBinding& binding : key.bindings)
+	{
+		// pack the binding into 64 bits and combine it like boost::hash_combine
+		uint64_t packed = static_cast<uint64_t>(binding.binding)
+			| static_cast<uint64_t>(binding.descriptorType) << 8
+			| static_cast<uint64_t>(binding.descriptorCount) << 16
+			| static_cast<uint64_t>(binding.stageFlags) << 40;
+		hash ^= std::hash<uint64_t>()(packed) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+BkDescriptorLayoutCache::BkDescriptorLayoutCache(VkDevice device)
+	: device(device)
+{
+}
+
+BkDescriptorLayoutCache::~BkDescriptorLayoutCache()
+{
+	for (auto& layout : layouts)
+	{
+		vkDestroyDescriptorSetLayout(device, layout.second, nullptr);
+	}
+}
+
+VkDescriptorSetLayout BkDescriptorLayoutCache::getLayout(const VkDescriptorSetLayoutCreateInfo& descriptorSetLayoutCreateInfo)
+{
+	if (descriptorSetLayoutCreateInfo.pNext != nullptr)
+	{
+		throw std::invalid_argument("ERROR: descriptor set layouts with a pNext chain can't be cached!");
+	}
+
+	LayoutKey key;
+	key.flags = descriptorSetLayoutCreateInfo.flags;
+	key.bindings.assign(descriptorSetLayoutCreateInfo.pBindings, descriptorSetLayoutCreateInfo.pBindings + descriptorSetLayoutCreateInfo.bindingCount);
+	std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	auto it = layouts.find(key);
+	if (it != layouts.end())
+	{
+		return it->second;
+	}
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorSetLayout' failed to create descriptor set layout!");
+	}
+	layouts.emplace(std::move(key), descriptorSetLayout);
+	return descriptorSetLayout;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// sets the first pool of an allocator is sized for, every further pool holds
+// twice as many up to DESCRIPTOR_POOL_MAX_SETS
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+
+// descriptors of a type a pool reserves per set
+struct BkDescriptorPoolRatio {
+	VkDescriptorType descriptorType;
+	float ratio;
+};
+
+// allocates descriptor sets from a chain of pools; when the current pool runs
+// out a free or new, larger pool takes its place so allocation never has to
+// search the chain, and reset() returns every pool to the free list at once
+class BkDescriptorAllocator
+{
+private:
+	VkDevice device;
+	std::vector<BkDescriptorPoolRatio> poolRatios;
+	uint32_t setsPerPool;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> usedPools;
+	std::vector<VkDescriptorPool> freePools;
+
+	VkDescriptorPool createPool(uint32_t setCount);
+
+	VkDescriptorPool grabPool();
+
+public:
+	BkDescriptorAllocator(VkDevice device, const std::vector<BkDescriptorPoolRatio>& poolRatios, uint32_t initialSetsPerPool = DESCRIPTOR_POOL_INITIAL_SETS);
+	~BkDescriptorAllocator();
+
+	BkDescriptorAllocator(const BkDescriptorAllocator&) = delete;
+	BkDescriptorAllocator& operator=(const BkDescriptorAllocator&) = delete;
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout descriptorSetLayout);
+
+	// free every set allocated since the last reset; none of them may still be
+	// in use by the GPU
+	void reset();
+
+	uint32_t getPoolCount() const;
+};
+
+// creates every distinct descriptor set layout once; layouts are compared by
+// their flags and bindings, the binding order doesn't matter
+class BkDescriptorLayoutCache
+{
+private:
+	struct LayoutKey {
+		VkDescriptorSetLayoutCreateFlags flags;
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+		bool operator==(const LayoutKey& other) const;
+	};
+
+	struct LayoutKeyHash {
+		size_t operator()(const LayoutKey& key) const;
+	};
+
+	VkDevice device;
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+
+public:
+	BkDescriptorLayoutCache(VkDevice device);
+	~BkDescriptorLayoutCache();
+
+	BkDescriptorLayoutCache(const BkDescriptorLayoutCache&) = delete;
+	BkDescriptorLayoutCache& operator=(const BkDescriptorLayoutCache&) = delete;
+
+	// the returned layout is owned by the cache; create infos with a pNext
+	// chain aren't supported
+	VkDescriptorSetLayout getLayout(const VkDescriptorSetLayoutCreateInfo& descriptorSetLayoutCreateInfo);
+};
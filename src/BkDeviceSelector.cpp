@@ -0,0 +1,251 @@
+#include "BkDeviceSelector.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static std::string toLower(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return text;
+}
+
+BkDeviceScore scorePhysicalDevice(VkPhysicalDevice physicalDevice, uint32_t index, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions)
+{
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+	BkDeviceScore deviceScore{};
+	deviceScore.physicalDevice = physicalDevice;
+	deviceScore.index = index;
+	deviceScore.name = physicalDeviceProperties.deviceName;
+	deviceScore.score = -1;
+
+	// the instance asks for Vulkan 1.3
+	if (physicalDeviceProperties.apiVersion < VK_API_VERSION_1_3)
+	{
+		deviceScore.reason = "doesn't support Vulkan 1.3";
+		return deviceScore;
+	}
+
+	// every required extension has to be available
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensionProperties(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data());
+	for (const char* requiredExtension : requiredExtensions)
+	{
+		bool bFoundExtension = false;
+		for (const VkExtensionProperties& extension : extensionProperties)
+		{
+			if (strcmp(requiredExtension, extension.extensionName) == 0)
+			{
+				bFoundExtension = true;
+				break;
+			}
+		}
+		if (!bFoundExtension)
+		{
+			deviceScore.reason = "lacks the extension " + std::string(requiredExtension);
+			return deviceScore;
+		}
+	}
+
+	// a graphics and a present queue are required, dedicated compute and
+	// transfer families are a bonus
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamiliesProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamiliesProperties.data());
+	bool bGraphicsQueue = false;
+	bool bPresentQueue = false;
+	bool bComputeQueue = false;
+	bool bTransferQueue = false;
+	for (uint32_t i = 0; i < queueFamilyCount; i++)
+	{
+		VkQueueFlags queueFlags = queueFamiliesProperties[i].queueFlags;
+		bGraphicsQueue |= (queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		bComputeQueue |= (queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFlags & VK_QUEUE_GRAPHICS_BIT);
+		bTransferQueue |= (queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+
+		// headless use has no surface to present to
+		VkBool32 bPresentSupport = surface == VK_NULL_HANDLE ? VK_TRUE : VK_FALSE;
+		if (surface != VK_NULL_HANDLE)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &bPresentSupport);
+		}
+		bPresentQueue |= bPresentSupport == VK_TRUE;
+	}
+	if (!bGraphicsQueue)
+	{
+		deviceScore.reason = "has no graphics queue";
+		return deviceScore;
+	}
+	if (!bPresentQueue)
+	{
+		deviceScore.reason = "can't present to the window surface";
+		return deviceScore;
+	}
+
+	int64_t score = 0;
+
+	// prefer real GPUs, but keep software rasterizers as a last resort
+	switch (physicalDeviceProperties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		score += 100000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		score += 50000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		score += 20000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		score += 1;
+		break;
+	default:
+		score += 1000;
+		break;
+	}
+
+	// one point per 64MB of device local memory, so the larger of two GPUs of
+	// the same type wins
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+	VkDeviceSize deviceLocalMemory = 0;
+	for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryHeapCount; i++)
+	{
+		if (physicalDeviceMemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			deviceLocalMemory += physicalDeviceMemoryProperties.memoryHeaps[i].size;
+		}
+	}
+	if (physicalDeviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU)
+	{
+		score += static_cast<int64_t>(deviceLocalMemory / (64 * 1024 * 1024));
+	}
+
+	if (bComputeQueue)
+	{
+		score += 500;
+	}
+	if (bTransferQueue)
+	{
+		score += 200;
+	}
+
+	// optional features the renderer makes use of
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+	physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	physicalDeviceFeatures2.pNext = &physicalDeviceVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
+	const VkPhysicalDeviceFeatures& physicalDeviceFeatures = physicalDeviceFeatures2.features;
+	if (physicalDeviceFeatures.samplerAnisotropy)
+	{
+		score += 100;
+	}
+	if (physicalDeviceFeatures.multiDrawIndirect)
+	{
+		score += 100;
+	}
+	if (physicalDeviceVulkan12Features.timelineSemaphore)
+	{
+		score += 100;
+	}
+	if (physicalDeviceVulkan12Features.runtimeDescriptorArray && physicalDeviceVulkan12Features.descriptorBindingPartiallyBound)
+	{
+		score += 100;
+	}
+
+	deviceScore.score = score;
+	return deviceScore;
+}
+
+std::string getDeviceOverride(int argc, char* argv[])
+{
+	std::string option = DEVICE_OVERRIDE_OPTION;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == option && i + 1 < argc)
+		{
+			return argv[i + 1];
+		}
+		if (argument.compare(0, option.size() + 1, option + "=") == 0)
+		{
+			return argument.substr(option.size() + 1);
+		}
+	}
+
+	const char* environmentOverride = std::getenv(DEVICE_OVERRIDE_ENV);
+	return environmentOverride != nullptr ? environmentOverride : "";
+}
+
+VkPhysicalDevice selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions, const std::string& deviceOverride)
+{
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	if (deviceCount == 0)
+	{
+		throw std::runtime_error("ERROR: 'vkEnumeratePhysicalDevices()' failed to find a device with Vulkan support!");
+	}
+	std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data());
+
+	std::vector<BkDeviceScore> deviceScores;
+	for (uint32_t i = 0; i < deviceCount; i++)
+	{
+		deviceScores.push_back(scorePhysicalDevice(physicalDevices[i], i, surface, requiredExtensions));
+	}
+
+	const BkDeviceScore* selectedDevice = nullptr;
+	if (!deviceOverride.empty())
+	{
+		// an all digit override is an index, anything else part of a name
+		bool bIndex = std::all_of(deviceOverride.begin(), deviceOverride.end(), [](unsigned char c) { return std::isdigit(c); });
+		for (const BkDeviceScore& deviceScore : deviceScores)
+		{
+			bool bMatch = bIndex ? deviceScore.index == static_cast<uint32_t>(std::stoul(deviceOverride)) : toLower(deviceScore.name).find(toLower(deviceOverride)) != std::string::npos;
+			if (bMatch)
+			{
+				selectedDevice = &deviceScore;
+				break;
+			}
+		}
+		if (selectedDevice == nullptr)
+		{
+			throw std::runtime_error("ERROR: no device matches the device override '" + deviceOverride + "'!");
+		}
+		if (selectedDevice->score < 0)
+		{
+			throw std::runtime_error("ERROR: the overridden device '" + selectedDevice->name + "' " + selectedDevice->reason + "!");
+		}
+	}
+	else
+	{
+		for (const BkDeviceScore& deviceScore : deviceScores)
+		{
+			if (deviceScore.score >= 0 && (selectedDevice == nullptr || deviceScore.score > selectedDevice->score))
+			{
+				selectedDevice = &deviceScore;
+			}
+		}
+		if (selectedDevice == nullptr)
+		{
+			std::string reasons;
+			for (const BkDeviceScore& deviceScore : deviceScores)
+			{
+				reasons += " '" + deviceScore.name + "' " + deviceScore.reason + ".";
+			}
+			throw std::runtime_error("ERROR: failed to find a suitable device!" + reasons);
+		}
+	}
+
+	std::cout << "device: " << selectedDevice->name << " (index " << selectedDevice->index << ", score " << selectedDevice->score << ")" << std::endl;
+	return selectedDevice->physicalDevice;
+}
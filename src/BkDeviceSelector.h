@@ -0,0 +1,38 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// environment variable and command line option that force a physical device,
+// either by its index in the enumeration order or by a case insensitive
+// substring of its name (e.g. BULKAN_DEVICE=llvmpipe or --device=1)
+const char* const DEVICE_OVERRIDE_ENV = "BULKAN_DEVICE";
+const char* const DEVICE_OVERRIDE_OPTION = "--device";
+
+struct BkDeviceScore {
+	VkPhysicalDevice physicalDevice;
+	uint32_t index;
+	std::string name;
+
+	// negative if the device can't run the renderer, 'reason' says why
+	int64_t score;
+	std::string reason;
+};
+
+// score a device by its type, device local memory, queue families and
+// optional features; devices without the required extensions, a graphics
+// queue, a queue that presents to 'surface' or Vulkan 1.3 are unsuitable
+// ('surface' is VK_NULL_HANDLE when rendering headless). software
+// rasterizers (lavapipe) are suitable but rank below any GPU
+BkDeviceScore scorePhysicalDevice(VkPhysicalDevice physicalDevice, uint32_t index, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions);
+
+// the override from the command line, or from the environment if it isn't
+// given there; empty if there is none
+std::string getDeviceOverride(int argc, char* argv[]);
+
+// pick the suitable device with the highest score, or the one named by
+// 'deviceOverride'; throws if there is no suitable device or the override
+// doesn't name one
+VkPhysicalDevice selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions, const std::string& deviceOverride);
@@ -0,0 +1,37 @@
+#include "BkDynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+BkDynamicResolution::BkDynamicResolution(float minScale, float maxScale, float targetFrameTime)
+	: minScale(minScale), maxScale(std::max(minScale, maxScale)), targetFrameTime(targetFrameTime), scale(this->maxScale)
+{
+}
+
+float BkDynamicResolution::update(float frameTime)
+{
+	if (frameTime <= 0.0f)
+	{
+		return scale;
+	}
+	smoothedFrameTime = smoothedFrameTime > 0.0f ? smoothedFrameTime + (frameTime - smoothedFrameTime) * SMOOTHING : frameTime;
+
+	float aimedFrameTime = targetFrameTime * TARGET_HEADROOM;
+	if (std::abs(smoothedFrameTime - aimedFrameTime) <= aimedFrameTime * DEAD_BAND)
+	{
+		return scale;
+	}
+
+	float wantedScale = std::clamp(scale * std::sqrt(aimedFrameTime / smoothedFrameTime), minScale, maxScale);
+	scale += (wantedScale - scale) * STEP;
+	return scale;
+}
+
+float BkDynamicResolution::getScale() const
+{
+	return scale;
+}
+
+uint32_t BkDynamicResolution::scaleExtent(uint32_t extent) const
+{
+	return std::max(static_cast<uint32_t>(std::lround(extent * scale)), 1u);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+// picks the scale of the internal render resolution from the measured GPU
+// frame time: the smoothed time is held a little below the target by moving
+// the scale part of the way towards the one whose pixel count would meet it
+// (the GPU time is taken to grow with the pixel count, the square of the
+// scale). The time is measured frames in flight late, the partial steps and
+// the dead band keep the scale from oscillating
+class BkDynamicResolution
+{
+private:
+	// fraction of the target aimed for, the slack absorbs spikes
+	const float TARGET_HEADROOM = 0.9f;
+
+	// frame times within this fraction of the aimed for time keep the scale
+	const float DEAD_BAND = 0.05f;
+
+	// weight of a new frame time in the smoothed time
+	const float SMOOTHING = 0.1f;
+
+	// part of the way to the wanted scale taken per frame
+	const float STEP = 0.25f;
+
+	float minScale;
+	float maxScale;
+	float targetFrameTime;
+	float scale;
+	float smoothedFrameTime = 0.0f;
+
+public:
+	// 'targetFrameTime' in milliseconds, starts at 'maxScale'
+	BkDynamicResolution(float minScale, float maxScale, float targetFrameTime);
+
+	// feed the GPU time of a completed frame in milliseconds, returns the
+	// scale for the next frame
+	float update(float frameTime);
+
+	float getScale() const;
+
+	// 'extent' scaled by the current scale, at least one pixel
+	uint32_t scaleExtent(uint32_t extent) const;
+};
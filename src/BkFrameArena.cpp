@@ -0,0 +1,96 @@
+#include "BkFrameArena.h"
+#include <algorithm>
+#include <stdexcept>
+
+BkFrameArena::BkFrameArena(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize regionSize)
+	: device(device), framesInFlight(framesInFlight)
+{
+	// dynamic offsets have to be multiples of the offset alignments, keep the
+	// regions aligned as well so every allocation is
+	VkPhysicalDeviceProperties physicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	alignment = std::max(physicalDeviceProperties.limits.minUniformBufferOffsetAlignment, physicalDeviceProperties.limits.minStorageBufferOffsetAlignment);
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+	this->regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+	VkBufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = this->regionSize * framesInFlight;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateBuffer' failed to create the frame arena buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+
+	VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	uint32_t memoryTypeIndex;
+	bool bFoundMemoryType = false;
+	for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+	{
+		if ((memoryRequirements.memoryTypeBits & (1 << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+		{
+			memoryTypeIndex = i;
+			bFoundMemoryType = true;
+			break;
+		}
+	}
+	if (!bFoundMemoryType)
+	{
+		throw std::runtime_error("ERROR: failed to find suitable memory type for frame arena buffer!");
+	}
+
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &bufferDeviceMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to create device memory for frame arena buffer!");
+	}
+	vkBindBufferMemory(device, buffer, bufferDeviceMemory, 0);
+
+	void* mapped;
+	vkMapMemory(device, bufferDeviceMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	bufferMapped = static_cast<unsigned char*>(mapped);
+}
+
+BkFrameArena::~BkFrameArena()
+{
+	vkDestroyBuffer(device, buffer, nullptr);
+	vkFreeMemory(device, bufferDeviceMemory, nullptr);
+}
+
+void BkFrameArena::beginFrame(uint32_t frame)
+{
+	regionBegin = regionSize * (frame % framesInFlight);
+	head = regionBegin;
+}
+
+void* BkFrameArena::allocate(VkDeviceSize size, uint32_t& dynamicOffset)
+{
+	if (head + size > regionBegin + regionSize)
+	{
+		throw std::runtime_error("ERROR: frame arena is out of memory!");
+	}
+
+	dynamicOffset = static_cast<uint32_t>(head);
+	head += (size + alignment - 1) / alignment * alignment;
+	return bufferMapped + dynamicOffset;
+}
+
+VkBuffer BkFrameArena::getBuffer() const
+{
+	return buffer;
+}
+
+VkDeviceSize BkFrameArena::getUsedSize() const
+{
+	return head - regionBegin;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// bytes of transient data every frame in flight can allocate
+const VkDeviceSize FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+
+// linear allocator over one persistently mapped buffer split into a region
+// per frame in flight; allocations are a pointer bump and are bound through
+// dynamic uniform/storage buffer offsets, so per-draw data needs neither its
+// own buffer nor a Vulkan call
+class BkFrameArena
+{
+private:
+	VkDevice device;
+	uint32_t framesInFlight;
+
+	VkBuffer buffer;
+	VkDeviceMemory bufferDeviceMemory;
+	unsigned char* bufferMapped;
+
+	VkDeviceSize regionSize;
+	VkDeviceSize alignment;
+	VkDeviceSize regionBegin = 0;
+	VkDeviceSize head = 0;
+
+public:
+	BkFrameArena(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize regionSize = FRAME_ARENA_SIZE);
+	~BkFrameArena();
+
+	BkFrameArena(const BkFrameArena&) = delete;
+	BkFrameArena& operator=(const BkFrameArena&) = delete;
+
+	// start allocating from the frame's region; call after waiting for the
+	// frame's fence since everything allocated in it before is discarded
+	void beginFrame(uint32_t frame);
+
+	// reserve 'size' bytes and return where to write them; 'dynamicOffset' is
+	// the offset to bind them with and is aligned for uniform and storage
+	// buffers
+	void* allocate(VkDeviceSize size, uint32_t& dynamicOffset);
+
+	template<typename T>
+	T* allocate(uint32_t& dynamicOffset)
+	{
+		return static_cast<T*>(allocate(sizeof(T), dynamicOffset));
+	}
+
+	// the buffer to write into VK_DESCRIPTOR_TYPE_*_BUFFER_DYNAMIC descriptors
+	// with offset 0
+	VkBuffer getBuffer() const;
+
+	// bytes allocated in the current frame's region
+	VkDeviceSize getUsedSize() const;
+};
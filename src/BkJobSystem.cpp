@@ -0,0 +1,322 @@
+#include "BkJobSystem.h"
+#include <algorithm>
+
+// the job system and deque the calling thread works on, a thread that isn't
+// a worker has no deque
+static thread_local BkJobSystem* currentJobSystem = nullptr;
+static thread_local uint32_t currentWorkerIndex = 0;
+
+bool BkJobCounter::isDone() const
+{
+	return value.load(std::memory_order_acquire) == 0;
+}
+
+BkJobSystem::JobDeque::JobDeque()
+	: buffer(new std::atomic<Job*>[JOB_DEQUE_CAPACITY])
+{
+	for (uint32_t i = 0; i < JOB_DEQUE_CAPACITY; i++)
+	{
+		buffer[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+bool BkJobSystem::JobDeque::push(Job* job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= static_cast<int64_t>(JOB_DEQUE_CAPACITY))
+	{
+		return false;
+	}
+
+	// the release publishes the job to the thieves that read the bottom
+	buffer[b & (JOB_DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+BkJobSystem::Job* BkJobSystem::JobDeque::pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = buffer[b & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// the last job, race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+BkJobSystem::Job* BkJobSystem::JobDeque::steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+	{
+		return nullptr;
+	}
+
+	Job* job = buffer[t & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		// lost the race to the owner or another thief
+		return nullptr;
+	}
+	return job;
+}
+
+BkJobSystem::BkJobSystem(uint32_t workerThreadCount)
+{
+	if (workerThreadCount == 0)
+	{
+		workerThreadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	// the deques exist before any worker can steal from them
+	for (uint32_t i = 0; i < workerThreadCount + 1; i++)
+	{
+		deques.push_back(std::make_unique<JobDeque>());
+	}
+
+	currentJobSystem = this;
+	currentWorkerIndex = 0;
+
+	workers.reserve(workerThreadCount);
+	for (uint32_t i = 1; i <= workerThreadCount; i++)
+	{
+		workers.emplace_back(&BkJobSystem::workerLoop, this, i);
+	}
+}
+
+BkJobSystem::~BkJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		bStopping = true;
+	}
+	sleepCondition.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	if (currentJobSystem == this)
+	{
+		currentJobSystem = nullptr;
+	}
+}
+
+uint32_t BkJobSystem::getWorkerCount() const
+{
+	return static_cast<uint32_t>(deques.size());
+}
+
+void BkJobSystem::run(BkJobCounter& counter, std::function<void()> job)
+{
+	// counted before it is queued, a waiter can't see the counter at 0 while
+	// the job is still pending
+	counter.value.fetch_add(1, std::memory_order_relaxed);
+	push(new Job{ std::move(job), &counter });
+}
+
+void BkJobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& function)
+{
+	batchSize = std::max(batchSize, 1u);
+	if (count <= batchSize)
+	{
+		if (count > 0)
+		{
+			function(0, count);
+		}
+		return;
+	}
+
+	// the last batch runs on the calling thread
+	BkJobCounter counter;
+	uint32_t begin = 0;
+	for (; begin + batchSize < count; begin += batchSize)
+	{
+		uint32_t end = begin + batchSize;
+		run(counter, [&function, begin, end]() { function(begin, end); });
+	}
+
+	try
+	{
+		function(begin, count);
+	}
+	catch (...)
+	{
+		// the batches reference 'function', they finish before it goes away
+		wait(counter);
+		throw;
+	}
+	wait(counter);
+}
+
+void BkJobSystem::wait(BkJobCounter& counter)
+{
+	while (!counter.isDone())
+	{
+		Job* job = findJob();
+		if (job != nullptr)
+		{
+			execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr jobException;
+	{
+		std::lock_guard<std::mutex> lock(exceptionMutex);
+		jobException = exception;
+		exception = nullptr;
+	}
+	if (jobException)
+	{
+		std::rethrow_exception(jobException);
+	}
+}
+
+void BkJobSystem::push(Job* job)
+{
+	queuedJobCount.fetch_add(1);
+
+	if (currentJobSystem == this)
+	{
+		if (!deques[currentWorkerIndex]->push(job))
+		{
+			queuedJobCount.fetch_sub(1);
+			execute(job);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(injectedJobsMutex);
+		injectedJobs.push_back(job);
+		injectedJobCount.fetch_add(1, std::memory_order_release);
+	}
+
+	// a worker that is about to sleep either sees the queued job or is
+	// already waiting when the lock is released
+	if (sleepingWorkerCount.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		sleepCondition.notify_one();
+	}
+}
+
+BkJobSystem::Job* BkJobSystem::findJob()
+{
+	bool bWorker = currentJobSystem == this;
+	Job* job = nullptr;
+	if (bWorker)
+	{
+		job = deques[currentWorkerIndex]->pop();
+	}
+
+	if (job == nullptr && injectedJobCount.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(injectedJobsMutex);
+		if (!injectedJobs.empty())
+		{
+			job = injectedJobs.front();
+			injectedJobs.pop_front();
+			injectedJobCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	// start with the next worker so the thieves spread over the deques
+	uint32_t dequeCount = static_cast<uint32_t>(deques.size());
+	uint32_t firstVictim = bWorker ? currentWorkerIndex + 1 : 0;
+	for (uint32_t i = 0; job == nullptr && i < dequeCount; i++)
+	{
+		uint32_t victim = (firstVictim + i) % dequeCount;
+		if (!bWorker || victim != currentWorkerIndex)
+		{
+			job = deques[victim]->steal();
+		}
+	}
+
+	if (job != nullptr)
+	{
+		queuedJobCount.fetch_sub(1);
+	}
+	return job;
+}
+
+void BkJobSystem::execute(Job* job)
+{
+	try
+	{
+		job->function();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(exceptionMutex);
+		if (!exception)
+		{
+			exception = std::current_exception();
+		}
+	}
+
+	// the waiter may destroy the counter as soon as it reaches 0
+	BkJobCounter* counter = job->counter;
+	delete job;
+	counter->value.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void BkJobSystem::workerLoop(uint32_t workerIndex)
+{
+	currentJobSystem = this;
+	currentWorkerIndex = workerIndex;
+
+	uint32_t idleCount = 0;
+	while (!bStopping)
+	{
+		Job* job = findJob();
+		if (job != nullptr)
+		{
+			execute(job);
+			idleCount = 0;
+			continue;
+		}
+
+		if (++idleCount < JOB_IDLE_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// sleep until a job is queued, announced before the queued jobs are
+		// checked so push() can't miss the sleeper
+		sleepingWorkerCount.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepCondition.wait(lock, [this] { return bStopping || queuedJobCount.load() > 0; });
+		}
+		sleepingWorkerCount.fetch_sub(1);
+		idleCount = 0;
+	}
+}
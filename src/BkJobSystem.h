@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <cstdint>
+
+// jobs a worker's deque holds (a power of two), a job pushed onto a full
+// deque runs immediately instead
+const uint32_t JOB_DEQUE_CAPACITY = 4096;
+
+// times an idle worker looks for a job to steal before it goes to sleep
+const uint32_t JOB_IDLE_SPIN_COUNT = 64;
+
+// the number of unfinished jobs started with it; a job that depends on
+// other jobs waits on their counter, which runs other jobs in the meantime
+struct BkJobCounter {
+	std::atomic<uint32_t> value{ 0 };
+
+	bool isDone() const;
+};
+
+// work-stealing scheduler: every worker pushes the jobs it spawns onto its
+// own lock-free deque and pops them in LIFO order, idle workers steal the
+// oldest jobs from the other deques; the thread that creates the system is
+// worker 0, jobs started from any other thread go through a shared queue
+class BkJobSystem
+{
+private:
+	struct Job {
+		std::function<void()> function;
+		BkJobCounter* counter;
+	};
+
+	// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for
+	// Weak Memory Models"), only the owner pushes and pops at the bottom
+	class JobDeque
+	{
+	private:
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		std::unique_ptr<std::atomic<Job*>[]> buffer;
+
+	public:
+		JobDeque();
+
+		// false if the deque is full
+		bool push(Job* job);
+
+		Job* pop();
+
+		Job* steal();
+	};
+
+	std::vector<std::unique_ptr<JobDeque>> deques;
+	std::vector<std::thread> workers;
+
+	// jobs started from threads that aren't workers
+	std::mutex injectedJobsMutex;
+	std::deque<Job*> injectedJobs;
+	std::atomic<uint32_t> injectedJobCount{ 0 };
+
+	// queued jobs, at least as many as the deques and the shared queue hold;
+	// idle workers sleep while it is 0
+	std::atomic<int32_t> queuedJobCount{ 0 };
+	std::atomic<uint32_t> sleepingWorkerCount{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<bool> bStopping{ false };
+
+	// the first exception thrown by a job since the last wait
+	std::mutex exceptionMutex;
+	std::exception_ptr exception;
+
+	void workerLoop(uint32_t workerIndex);
+
+	void push(Job* job);
+
+	// pop from the calling worker's deque, then take from the shared queue,
+	// then steal from the other workers; nullptr if there is no job
+	Job* findJob();
+
+	void execute(Job* job);
+
+public:
+	// a worker thread count of 0 uses one thread per hardware thread except
+	// the calling one, which works as well while it waits
+	BkJobSystem(uint32_t workerThreadCount = 0);
+
+	// every counter has to be waited on before the system is destroyed
+	~BkJobSystem();
+
+	BkJobSystem(const BkJobSystem&) = delete;
+	BkJobSystem& operator=(const BkJobSystem&) = delete;
+
+	// the worker threads and the creating thread
+	uint32_t getWorkerCount() const;
+
+	void run(BkJobCounter& counter, std::function<void()> job);
+
+	// call 'function(begin, end)' for [0, count) split into batches of
+	// 'batchSize' and wait for all of them
+	void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& function);
+
+	// run jobs on the calling thread until the counter reaches 0, rethrows the
+	// first exception a job threw since the last wait
+	void wait(BkJobCounter& counter);
+};
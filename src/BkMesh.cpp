@@ -0,0 +1,99 @@
+#include "BkMesh.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+VkIndexType selectIndexType(size_t vertexCount)
+{
+	// 16 bit indices halve the index memory and bandwidth; meshes with 65536
+	// or more vertices are kept at 32 bit so 0xFFFF stays free for primitive
+	// restart
+	if (vertexCount <= 0xFFFF)
+	{
+		return VK_INDEX_TYPE_UINT16;
+	}
+	return VK_INDEX_TYPE_UINT32;
+}
+
+VkDeviceSize getIndexTypeSize(VkIndexType indexType)
+{
+	switch (indexType)
+	{
+	case VK_INDEX_TYPE_UINT16:
+		return sizeof(uint16_t);
+	case VK_INDEX_TYPE_UINT32:
+		return sizeof(uint32_t);
+	default:
+		throw std::invalid_argument("ERROR: unsupported index type!");
+	}
+}
+
+void packIndices(const std::vector<uint32_t>& indices, size_t vertexCount, BkPackedIndices& packedIndices)
+{
+	packedIndices.indexType = selectIndexType(vertexCount);
+	packedIndices.indexCount = static_cast<uint32_t>(indices.size());
+	packedIndices.data.resize(indices.size() * getIndexTypeSize(packedIndices.indexType));
+
+	if (packedIndices.indexType == VK_INDEX_TYPE_UINT16)
+	{
+		uint16_t* packedData = reinterpret_cast<uint16_t*>(packedIndices.data.data());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			packedData[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else
+	{
+		memcpy(packedIndices.data.data(), indices.data(), packedIndices.data.size());
+	}
+}
+
+BkBoundingSphere computeBoundingSphere(const std::vector<Vertex>& vertices)
+{
+	BkBoundingSphere sphere{};
+	if (vertices.empty())
+	{
+		return sphere;
+	}
+
+	// center the sphere on the bounding box which is good enough for LOD
+	// selection and culling, the radius still contains every vertex
+	glm::vec3 minPos = vertices[0].pos;
+	glm::vec3 maxPos = vertices[0].pos;
+	for (const Vertex& vertex : vertices)
+	{
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+	sphere.center = (minPos + maxPos) * 0.5f;
+	for (const Vertex& vertex : vertices)
+	{
+		sphere.radius = std::max(sphere.radius, glm::length(vertex.pos - sphere.center));
+	}
+	return sphere;
+}
+
+uint32_t selectMeshLod(const std::vector<BkMeshLod>& lods, float distance, float projectionScale, float viewportHeight, float maxScreenError)
+{
+	// number of pixels one object space unit covers at 'distance'; objects
+	// that intersect the near plane always get the full detail mesh
+	const float MIN_LOD_DISTANCE = 1e-4f;
+	if (distance < MIN_LOD_DISTANCE)
+	{
+		return 0;
+	}
+	float pixelsPerUnit = std::fabs(projectionScale) * 0.5f * viewportHeight / distance;
+
+	// the errors grow with every level, so stop at the first one that is too coarse
+	uint32_t selectedLod = 0;
+	for (uint32_t i = 1; i < lods.size(); i++)
+	{
+		if (lods[i].error * pixelsPerUnit > maxScreenError)
+		{
+			break;
+		}
+		selectedLod = i;
+	}
+	return selectedLod;
+}
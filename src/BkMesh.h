@@ -0,0 +1,42 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "BkVertex.h"
+
+// index data stored with the smallest index type that can address every
+// vertex of the mesh; this is what gets uploaded to the GPU (and written to
+// disk by binary mesh formats) so the index type has to travel with the data
+struct BkPackedIndices {
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t indexCount = 0;
+	std::vector<uint8_t> data;
+};
+
+VkIndexType selectIndexType(size_t vertexCount);
+
+VkDeviceSize getIndexTypeSize(VkIndexType indexType);
+
+void packIndices(const std::vector<uint32_t>& indices, size_t vertexCount, BkPackedIndices& packedIndices);
+
+struct BkBoundingSphere {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+BkBoundingSphere computeBoundingSphere(const std::vector<Vertex>& vertices);
+
+// a level of detail of a mesh; all levels index the same vertex buffer and
+// are stored back to back in one index buffer; error is the object space
+// distance the level deviates from the full detail mesh
+struct BkMeshLod {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;
+};
+
+// select the coarsest level of detail whose error projects to at most
+// 'maxScreenError' pixels; 'projectionScale' is proj[1][1] times the scale
+// of the object and 'distance' the view space distance to the object
+uint32_t selectMeshLod(const std::vector<BkMeshLod>& lods, float distance, float projectionScale, float viewportHeight, float maxScreenError);
@@ -0,0 +1,356 @@
+#include "BkMeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// tuning constants from Forsyth's linear-speed vertex cache optimization; the
+// simulated LRU cache is larger than the real one on purpose so the scoring
+// keeps looking ahead
+static const uint32_t VERTEX_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// clusters smaller than this are never split off by a soft boundary
+static const size_t MIN_OVERDRAW_CLUSTER_SIZE = 32;
+
+static const uint32_t INVALID_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+static float computeVertexScore(int cachePosition, uint32_t liveTriangleCount)
+{
+	// vertices that are not referenced by any remaining triangle are ignored
+	if (liveTriangleCount == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the vertices of the last emitted triangle get a fixed score so the
+		// next triangle doesn't simply reuse the same edge
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scaler = 1.0f / static_cast<float>(VERTEX_CACHE_SIZE - 3);
+			score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	// boost vertices with few remaining triangles to get rid of them quickly
+	score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTriangleCount), -VALENCE_BOOST_POWER);
+	return score;
+}
+
+BkVertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	BkVertexCacheStats stats{};
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	// a vertex is in the FIFO cache if it was inserted less than 'cacheSize'
+	// insertions ago, which avoids having to shift an actual queue
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> bReferenced(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t uniqueVertexCount = 0;
+	for (uint32_t index : indices)
+	{
+		if (timestamp - cacheTimestamps[index] > cacheSize)
+		{
+			cacheTimestamps[index] = timestamp++;
+			stats.vertexTransforms++;
+		}
+		if (!bReferenced[index])
+		{
+			bReferenced[index] = true;
+			uniqueVertexCount++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.vertexTransforms) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(stats.vertexTransforms) / static_cast<float>(uniqueVertexCount);
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// build the vertex to triangle adjacency; the first 'liveTriangleCounts[v]'
+	// entries of a vertex' range are the triangles that are not emitted yet
+	std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+	for (uint32_t index : indices)
+	{
+		liveTriangleCounts[index]++;
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangleCounts[i];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[adjacencyFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// initial scores with an empty cache
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexScores[i] = computeVertexScore(-1, liveTriangleCounts[i]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3 + 0]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+	}
+	std::vector<bool> bTriangleEmitted(triangleCount, false);
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(VERTEX_CACHE_SIZE + 3);
+	newCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+	std::vector<uint32_t> optimizedIndices;
+	optimizedIndices.reserve(indices.size());
+
+	uint32_t bestTriangle = INVALID_TRIANGLE;
+	size_t inputCursor = 0;
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// when no triangle touches the cache continue with the next triangle
+		// in input order instead of searching the whole mesh
+		if (bestTriangle == INVALID_TRIANGLE)
+		{
+			while (bTriangleEmitted[inputCursor])
+			{
+				inputCursor++;
+			}
+			bestTriangle = static_cast<uint32_t>(inputCursor);
+		}
+
+		const uint32_t triangle[3] = { indices[bestTriangle * 3 + 0], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		optimizedIndices.insert(optimizedIndices.end(), triangle, triangle + 3);
+		bTriangleEmitted[bestTriangle] = true;
+
+		// remove the emitted triangle from the live part of the adjacency
+		for (uint32_t vertex : triangle)
+		{
+			uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+			uint32_t* end = begin + liveTriangleCounts[vertex];
+			uint32_t* it = std::find(begin, end, bestTriangle);
+			if (it != end)
+			{
+				std::swap(*it, *(end - 1));
+				liveTriangleCounts[vertex]--;
+			}
+		}
+
+		// move the triangle's vertices to the front of the LRU cache
+		newCache.clear();
+		for (uint32_t vertex : triangle)
+		{
+			if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+			{
+				newCache.push_back(vertex);
+			}
+		}
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		// rescore every vertex that moved in or fell out of the cache
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			uint32_t vertex = newCache[i];
+			cachePositions[vertex] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+			vertexScores[vertex] = computeVertexScore(cachePositions[vertex], liveTriangleCounts[vertex]);
+		}
+
+		// rescore the live triangles touching those vertices and pick the best
+		// one as the next triangle to emit
+		bestTriangle = INVALID_TRIANGLE;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : newCache)
+		{
+			uint32_t begin = adjacencyOffsets[vertex];
+			uint32_t end = begin + liveTriangleCounts[vertex];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t t = adjacency[i];
+				float score = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cache.assign(newCache.begin(), newCache.begin() + std::min<size_t>(newCache.size(), VERTEX_CACHE_SIZE));
+	}
+
+	indices.swap(optimizedIndices);
+}
+
+// split a cache optimized index buffer into clusters of triangles; a triangle
+// that misses the cache on all of its vertices starts a new strip so splitting
+// there is free (hard boundary), any other triangle with a cache miss splits
+// off a cluster once it reached 'minSoftClusterSize' triangles (soft boundary)
+static std::vector<size_t> buildOverdrawClusters(const std::vector<uint32_t>& indices, size_t vertexCount, size_t minSoftClusterSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	std::vector<size_t> clusterOffsets = { 0 };
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = VERTEX_CACHE_ANALYSIS_SIZE + 1;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		uint32_t triangleMisses = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t index = indices[t * 3 + k];
+			if (timestamp - cacheTimestamps[index] > VERTEX_CACHE_ANALYSIS_SIZE)
+			{
+				cacheTimestamps[index] = timestamp++;
+				triangleMisses++;
+			}
+		}
+
+		size_t clusterSize = t - clusterOffsets.back();
+		if (clusterSize > 0 && (triangleMisses == 3 || (triangleMisses > 0 && clusterSize >= minSoftClusterSize)))
+		{
+			clusterOffsets.push_back(t);
+		}
+	}
+	clusterOffsets.push_back(triangleCount);
+	return clusterOffsets;
+}
+
+// reorder the clusters so the ones facing away from the center of the mesh,
+// which are likely to occlude the rest of the mesh, are drawn first
+static void sortOverdrawClusters(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusterOffsets, std::vector<uint32_t>& sortedIndices)
+{
+	size_t clusterCount = clusterOffsets.size() - 1;
+
+	// compute the area weighted centroid and normal of every cluster and of
+	// the whole mesh
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+		for (size_t t = clusterOffsets[c]; t < clusterOffsets[c + 1]; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+			clusterNormals[c] += normal;
+			clusterCentroids[c] += centroid * area;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+		{
+			clusterCentroids[c] /= clusterArea;
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float normalLength = glm::length(clusterNormals[c]);
+		if (normalLength > 0.0f)
+		{
+			sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+		}
+	}
+	std::vector<size_t> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		clusterOrder[c] = c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	sortedIndices.clear();
+	sortedIndices.reserve(indices.size());
+	for (size_t c : clusterOrder)
+	{
+		sortedIndices.insert(sortedIndices.end(), indices.begin() + clusterOffsets[c] * 3, indices.begin() + clusterOffsets[c + 1] * 3);
+	}
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// every soft boundary starts a cluster with a cold cache, so start with
+	// small clusters and make them bigger until the ACMR of the sorted index
+	// buffer is within 'threshold' of the cache optimized one; with only hard
+	// boundaries left the ACMR is unchanged and the loop always terminates
+	float maxAcmr = analyzeVertexCache(indices, vertices.size()).acmr * threshold;
+	std::vector<uint32_t> sortedIndices;
+	for (size_t minSoftClusterSize = MIN_OVERDRAW_CLUSTER_SIZE; ; minSoftClusterSize *= 2)
+	{
+		bool bHardBoundariesOnly = minSoftClusterSize > triangleCount;
+		std::vector<size_t> clusterOffsets = buildOverdrawClusters(indices, vertices.size(), bHardBoundariesOnly ? std::numeric_limits<size_t>::max() : minSoftClusterSize);
+		sortOverdrawClusters(indices, vertices, clusterOffsets, sortedIndices);
+		if (bHardBoundariesOnly || analyzeVertexCache(sortedIndices, vertices.size()).acmr <= maxAcmr)
+		{
+			break;
+		}
+	}
+	indices.swap(sortedIndices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// assign new vertex indices in order of first use by the index buffer
+	const uint32_t UNUSED_VERTEX = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertices.size(), UNUSED_VERTEX);
+	std::vector<Vertex> fetchOrderedVertices;
+	fetchOrderedVertices.reserve(vertices.size());
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UNUSED_VERTEX)
+		{
+			remap[index] = static_cast<uint32_t>(fetchOrderedVertices.size());
+			fetchOrderedVertices.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(fetchOrderedVertices);
+}
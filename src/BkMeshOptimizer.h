@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "BkVertex.h"
+
+// post-transform vertex cache statistics of an index buffer simulated with a
+// FIFO cache; acmr is the average cache miss ratio (misses per triangle, 0.5
+// is the best case on a regular grid, 3.0 the worst) and atvr is the average
+// transformed vertex ratio (misses per unique vertex, 1.0 is optimal)
+struct BkVertexCacheStats {
+	uint32_t vertexTransforms = 0;
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+// size of the FIFO cache used to measure the index buffer; 16 entries is a
+// conservative approximation of the post-transform cache on modern GPUs
+const uint32_t VERTEX_CACHE_ANALYSIS_SIZE = 16;
+
+BkVertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_ANALYSIS_SIZE);
+
+// reorder the triangles to maximize post-transform vertex cache hits
+// (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// reorder clusters of an already cache optimized index buffer so outward
+// facing clusters are drawn first to reduce overdraw (Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw"); threshold
+// controls how much the ACMR is allowed to degrade (1.05 = 5% worse)
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+// reorder the vertices in the order they are first referenced by the index
+// buffer for vertex fetch locality and drop unreferenced vertices
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
@@ -0,0 +1,322 @@
+#include "BkMeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+#include "BkMeshOptimizer.h"
+
+// stop generating levels once a level removes less than this fraction of the
+// previous level's triangles (the rest of the mesh is locked)
+static const float MIN_LOD_REDUCTION = 0.1f;
+
+// symmetric 4x4 error quadric of the planes around a vertex, weighted by
+// triangle area; evaluating it gives the mean squared distance to the planes
+struct Quadric {
+	double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+	double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	double c = 0.0;
+	double weight = 0.0;
+
+	void addPlane(const glm::vec3& normal, float distance, double planeWeight)
+	{
+		double x = normal.x, y = normal.y, z = normal.z, d = distance;
+		a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z;
+		a11 += planeWeight * y * y; a12 += planeWeight * y * z; a22 += planeWeight * z * z;
+		b0 += planeWeight * x * d; b1 += planeWeight * y * d; b2 += planeWeight * z * d;
+		c += planeWeight * d * d;
+		weight += planeWeight;
+	}
+
+	void add(const Quadric& other)
+	{
+		a00 += other.a00; a01 += other.a01; a02 += other.a02;
+		a11 += other.a11; a12 += other.a12; a22 += other.a22;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	double evaluate(const glm::vec3& p) const
+	{
+		if (weight <= 0.0)
+		{
+			return 0.0;
+		}
+		double x = p.x, y = p.y, z = p.z;
+		double error = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z
+			+ a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return std::max(error / weight, 0.0);
+	}
+};
+
+// collapse of the edge 'from' -> 'to'; 'from' is removed and its triangles
+// are moved onto 'to', the versions detect stale entries in the queue
+struct EdgeCollapse {
+	double cost;
+	uint32_t from;
+	uint32_t to;
+	uint32_t fromVersion;
+	uint32_t toVersion;
+
+	bool operator>(const EdgeCollapse& other) const
+	{
+		return cost > other.cost;
+	}
+};
+
+void generateMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<BkMeshLod>& lods, uint32_t maxLodCount, float lodReduction)
+{
+	lods.clear();
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	size_t vertexCount = vertices.size();
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || maxLodCount <= 1)
+	{
+		return;
+	}
+
+	// work on a copy of the full detail triangles; collapses rewrite it in
+	// place so the triangles keep their (vertex cache optimized) order
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+	std::vector<bool> bTriangleRemoved(triangleCount, false);
+	std::vector<bool> bVertexRemoved(vertexCount, false);
+	std::vector<uint32_t> vertexVersions(vertexCount, 0);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			vertexTriangles[triangles[t * 3 + k]].push_back(static_cast<uint32_t>(t));
+		}
+	}
+
+	// vertices that share a position but differ in other attributes are UV
+	// seams; use the position to find borders of the surface itself
+	std::unordered_map<glm::vec3, uint32_t> positionIds;
+	std::vector<uint32_t> vertexPositionIds(vertexCount);
+	std::vector<uint32_t> positionWedgeCounts;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		auto inserted = positionIds.emplace(vertices[i].pos, static_cast<uint32_t>(positionWedgeCounts.size()));
+		if (inserted.second)
+		{
+			positionWedgeCounts.push_back(0);
+		}
+		vertexPositionIds[i] = inserted.first->second;
+		positionWedgeCounts[inserted.first->second]++;
+	}
+
+	// count the triangles of every undirected edge; edges with one triangle
+	// are on a border
+	std::unordered_map<uint64_t, uint32_t> edgeTriangleCounts;
+	auto edgeKey = [](uint32_t a, uint32_t b) {
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	};
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t a = vertexPositionIds[triangles[t * 3 + k]];
+			uint32_t b = vertexPositionIds[triangles[t * 3 + (k + 1) % 3]];
+			edgeTriangleCounts[edgeKey(a, b)]++;
+		}
+	}
+	std::vector<bool> bPositionOnBorder(positionWedgeCounts.size(), false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t a = vertexPositionIds[triangles[t * 3 + k]];
+			uint32_t b = vertexPositionIds[triangles[t * 3 + (k + 1) % 3]];
+			if (edgeTriangleCounts[edgeKey(a, b)] == 1)
+			{
+				bPositionOnBorder[a] = true;
+				bPositionOnBorder[b] = true;
+			}
+		}
+	}
+
+	// border and seam vertices stay where they are so the silhouette and the
+	// texture mapping don't tear apart
+	std::vector<bool> bVertexLocked(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		uint32_t positionId = vertexPositionIds[i];
+		bVertexLocked[i] = bPositionOnBorder[positionId] || positionWedgeCounts[positionId] > 1;
+	}
+
+	// accumulate the quadric of every triangle plane into its vertices
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3& p0 = vertices[triangles[t * 3 + 0]].pos;
+		const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].pos;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area <= 0.0f)
+		{
+			continue;
+		}
+		normal /= area;
+		float distance = -glm::dot(normal, p0);
+		for (size_t k = 0; k < 3; k++)
+		{
+			quadrics[triangles[t * 3 + k]].addPlane(normal, distance, area);
+		}
+	}
+
+	std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> collapseQueue;
+	auto pushCollapse = [&](uint32_t from, uint32_t to) {
+		if (bVertexLocked[from] || from == to)
+		{
+			return;
+		}
+		Quadric quadric = quadrics[from];
+		quadric.add(quadrics[to]);
+		collapseQueue.push({ quadric.evaluate(vertices[to].pos), from, to, vertexVersions[from], vertexVersions[to] });
+	};
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t a = triangles[t * 3 + k];
+			uint32_t b = triangles[t * 3 + (k + 1) % 3];
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	// a collapse is rejected if it flips or degenerates a remaining triangle
+	auto isCollapseValid = [&](uint32_t from, uint32_t to) {
+		bool bEdgeExists = false;
+		for (uint32_t t : vertexTriangles[from])
+		{
+			if (bTriangleRemoved[t])
+			{
+				continue;
+			}
+			const uint32_t* triangle = &triangles[t * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				bEdgeExists = true;
+				continue;
+			}
+
+			glm::vec3 p[3];
+			glm::vec3 q[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				p[k] = vertices[triangle[k]].pos;
+				q[k] = triangle[k] == from ? vertices[to].pos : p[k];
+			}
+			glm::vec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 newNormal = glm::cross(q[1] - q[0], q[2] - q[0]);
+			if (glm::dot(oldNormal, newNormal) <= 0.0f)
+			{
+				return false;
+			}
+		}
+		return bEdgeExists;
+	};
+
+	size_t liveTriangleCount = triangleCount;
+	double maxCollapseError = 0.0;
+	for (uint32_t lodIndex = 1; lodIndex < maxLodCount; lodIndex++)
+	{
+		size_t previousTriangleCount = lods.back().indexCount / 3;
+		size_t targetTriangleCount = static_cast<size_t>(static_cast<float>(previousTriangleCount) * lodReduction);
+
+		// collapse the cheapest edges until the target is reached
+		while (liveTriangleCount > targetTriangleCount && !collapseQueue.empty())
+		{
+			EdgeCollapse collapse = collapseQueue.top();
+			collapseQueue.pop();
+
+			uint32_t from = collapse.from;
+			uint32_t to = collapse.to;
+			if (bVertexRemoved[from] || bVertexRemoved[to] || collapse.fromVersion != vertexVersions[from] || collapse.toVersion != vertexVersions[to])
+			{
+				continue;
+			}
+			if (!isCollapseValid(from, to))
+			{
+				continue;
+			}
+
+			// move the triangles of 'from' onto 'to'; triangles that contained
+			// the collapsed edge become degenerate and are removed
+			for (uint32_t t : vertexTriangles[from])
+			{
+				if (bTriangleRemoved[t])
+				{
+					continue;
+				}
+				uint32_t* triangle = &triangles[t * 3];
+				for (size_t k = 0; k < 3; k++)
+				{
+					if (triangle[k] == from)
+					{
+						triangle[k] = to;
+					}
+				}
+				if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+				{
+					bTriangleRemoved[t] = true;
+					liveTriangleCount--;
+				}
+				else
+				{
+					vertexTriangles[to].push_back(t);
+				}
+			}
+			vertexTriangles[from].clear();
+			bVertexRemoved[from] = true;
+			quadrics[to].add(quadrics[from]);
+			vertexVersions[to]++;
+			maxCollapseError = std::max(maxCollapseError, collapse.cost);
+
+			// the quadric of 'to' changed so every edge around it needs a new cost
+			for (uint32_t t : vertexTriangles[to])
+			{
+				if (bTriangleRemoved[t])
+				{
+					continue;
+				}
+				for (size_t k = 0; k < 3; k++)
+				{
+					uint32_t other = triangles[t * 3 + k];
+					pushCollapse(other, to);
+					pushCollapse(to, other);
+				}
+			}
+		}
+
+		// stop once the remaining (mostly locked) mesh doesn't get smaller
+		if (static_cast<float>(liveTriangleCount) > static_cast<float>(previousTriangleCount) * (1.0f - MIN_LOD_REDUCTION))
+		{
+			break;
+		}
+
+		std::vector<uint32_t> lodIndices;
+		lodIndices.reserve(liveTriangleCount * 3);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (!bTriangleRemoved[t])
+			{
+				lodIndices.insert(lodIndices.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+			}
+		}
+		optimizeVertexCache(lodIndices, vertexCount);
+
+		BkMeshLod lod{};
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = static_cast<float>(std::sqrt(maxCollapseError));
+		lods.push_back(lod);
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "BkVertex.h"
+#include "BkMesh.h"
+
+const uint32_t MAX_MESH_LOD_COUNT = 8;
+
+// build a chain of simplified levels of detail with quadric error metric edge
+// collapses (Garland & Heckbert, "Surface Simplification Using Quadric Error
+// Metrics"); every level has about 'lodReduction' times the triangles of the
+// previous one, collapses only move onto existing vertices so all levels
+// share 'vertices'; the levels are appended to 'indices' and lods[0] is the
+// original index range; vertices on borders and UV seams are never removed
+void generateMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<BkMeshLod>& lods, uint32_t maxLodCount = MAX_MESH_LOD_COUNT, float lodReduction = 0.5f);
@@ -0,0 +1,232 @@
+#include "BkMeshlet.h"
+#include <algorithm>
+#include <cmath>
+
+// normal cones wider than this (cosine of the angle between the axis and the
+// furthest normal) cull too little to be worth testing
+static const float MIN_CONE_SPREAD = 0.1f;
+
+static void computeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, BkMeshlet& meshlet)
+{
+	// bounding sphere around the center of the meshlet's bounding box
+	glm::vec3 minPos = vertices[indices[meshlet.firstIndex]].pos;
+	glm::vec3 maxPos = minPos;
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+	{
+		minPos = glm::min(minPos, vertices[indices[i]].pos);
+		maxPos = glm::max(maxPos, vertices[indices[i]].pos);
+	}
+	meshlet.center = (minPos + maxPos) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.center));
+	}
+
+	// the cone axis is the average triangle normal
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> corners;
+	glm::vec3 normalSum(0.0f);
+	for (uint32_t i = meshlet.firstIndex; i + 2 < meshlet.firstIndex + meshlet.indexCount; i += 3)
+	{
+		const glm::vec3& p0 = vertices[indices[i + 0]].pos;
+		const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area <= 0.0f)
+		{
+			continue;
+		}
+		normals.push_back(normal / area);
+		corners.push_back(p0);
+		normalSum += normal / area;
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneApex = meshlet.center;
+	meshlet.coneCutoff = 1.0f;
+	float normalSumLength = glm::length(normalSum);
+	if (normalSumLength <= 0.0f)
+	{
+		return;
+	}
+	glm::vec3 axis = normalSum / normalSumLength;
+
+	// the cone has to contain the normal furthest away from the axis
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+	if (minDot <= MIN_CONE_SPREAD)
+	{
+		return;
+	}
+
+	// move the apex back along the axis until every triangle plane is in
+	// front of it, so the apex test is conservative for the whole meshlet
+	float maxOffset = 0.0f;
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		float offset = glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+		maxOffset = std::max(maxOffset, offset);
+	}
+
+	meshlet.coneAxis = axis;
+	meshlet.coneApex = meshlet.center - axis * maxOffset;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, std::vector<BkMeshlet>& meshlets)
+{
+	meshlets.clear();
+
+	// 'vertexMeshlet' stores the last meshlet that used a vertex so the
+	// unique vertex count of the current meshlet can be tracked in O(1)
+	const uint32_t NO_MESHLET = ~0u;
+	std::vector<uint32_t> vertexMeshlet(vertices.size(), NO_MESHLET);
+
+	BkMeshlet meshlet{};
+	meshlet.firstIndex = firstIndex;
+	for (uint32_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3)
+	{
+		uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+		uint32_t newVertexCount = 0;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t vertex = indices[i + k];
+			bool bDuplicate = (k > 0 && indices[i] == vertex) || (k > 1 && indices[i + 1] == vertex);
+			if (vertexMeshlet[vertex] != meshletIndex && !bDuplicate)
+			{
+				newVertexCount++;
+			}
+		}
+
+		// close the meshlet if the triangle doesn't fit anymore
+		if (meshlet.vertexCount + newVertexCount > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES)
+		{
+			computeMeshletBounds(vertices, indices, meshlet);
+			meshlets.push_back(meshlet);
+
+			meshlet = BkMeshlet{};
+			meshlet.firstIndex = i;
+			meshletIndex++;
+			newVertexCount = 0;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t vertex = indices[i + k];
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					newVertexCount++;
+				}
+			}
+		}
+		else
+		{
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				vertexMeshlet[indices[i + k]] = meshletIndex;
+			}
+		}
+
+		meshlet.vertexCount += newVertexCount;
+		meshlet.indexCount += 3;
+	}
+	if (meshlet.indexCount > 0)
+	{
+		computeMeshletBounds(vertices, indices, meshlet);
+		meshlets.push_back(meshlet);
+	}
+}
+
+BkFrustum extractFrustum(const glm::mat4& viewProj)
+{
+	// glm matrices are column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+	}
+
+	BkFrustum frustum{};
+	frustum.planes[0] = rows[3] + rows[0]; // left
+	frustum.planes[1] = rows[3] - rows[0]; // right
+	frustum.planes[2] = rows[3] + rows[1]; // bottom
+	frustum.planes[3] = rows[3] - rows[1]; // top
+	frustum.planes[4] = rows[2];           // near (depth range is [0, 1])
+	frustum.planes[5] = rows[3] - rows[2]; // far
+	for (glm::vec4& plane : frustum.planes)
+	{
+		float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+		if (length > 0.0f)
+		{
+			plane /= length;
+		}
+	}
+	return frustum;
+}
+
+bool isSphereInFrustum(const BkFrustum& frustum, const glm::vec3& center, float radius)
+{
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool isMeshletBackfacing(const BkMeshlet& meshlet, const glm::vec3& cameraPosition)
+{
+	glm::vec3 apexOffset = meshlet.coneApex - cameraPosition;
+	float apexDistance = glm::length(apexOffset);
+	if (apexDistance <= 0.0f)
+	{
+		return false;
+	}
+	return glm::dot(apexOffset / apexDistance, meshlet.coneAxis) >= meshlet.coneCutoff;
+}
+
+uint32_t cullMeshlets(const std::vector<BkMeshlet>& meshlets, const BkFrustum& frustum, const glm::vec3& cameraPosition, VkDrawIndexedIndirectCommand* drawCommands, uint32_t firstInstance)
+{
+	return cullMeshlets(meshlets.data(), static_cast<uint32_t>(meshlets.size()), frustum, cameraPosition, drawCommands, firstInstance);
+}
+
+uint32_t cullMeshlets(const BkMeshlet* meshlets, uint32_t meshletCount, const BkFrustum& frustum, const glm::vec3& cameraPosition, VkDrawIndexedIndirectCommand* drawCommands, uint32_t firstInstance)
+{
+	uint32_t drawCount = 0;
+	for (uint32_t i = 0; i < meshletCount; i++)
+	{
+		const BkMeshlet& meshlet = meshlets[i];
+		if (!isSphereInFrustum(frustum, meshlet.center, meshlet.radius) || isMeshletBackfacing(meshlet, cameraPosition))
+		{
+			continue;
+		}
+
+		VkDrawIndexedIndirectCommand& drawCommand = drawCommands[drawCount++];
+		drawCommand.indexCount = meshlet.indexCount;
+		drawCommand.instanceCount = 1;
+		drawCommand.firstIndex = meshlet.firstIndex;
+		drawCommand.vertexOffset = 0;
+		drawCommand.firstInstance = firstInstance;
+	}
+	return drawCount;
+}
+
+uint32_t cullMeshletIndices(const BkMeshlet* meshlets, uint32_t meshletCount, uint32_t firstMeshlet, const BkFrustum& frustum, const glm::vec3& cameraPosition, uint32_t* visibleMeshlets)
+{
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < meshletCount; i++)
+	{
+		const BkMeshlet& meshlet = meshlets[i];
+		if (isSphereInFrustum(frustum, meshlet.center, meshlet.radius) && !isMeshletBackfacing(meshlet, cameraPosition))
+		{
+			visibleMeshlets[visibleCount++] = firstMeshlet + i;
+		}
+	}
+	return visibleCount;
+}
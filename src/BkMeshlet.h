@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "BkVertex.h"
+
+// limits that fit the common mesh shader output sizes (NVIDIA recommends 64
+// vertices and 124 triangles so the primitive indices fit in 128 bytes)
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// a cluster of triangles stored as a contiguous range of the index buffer
+// with the bounds needed to cull it as a whole
+struct BkMeshlet {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t vertexCount = 0;
+
+	// bounding sphere of the meshlet's vertices
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	// every triangle normal is within the cone around 'coneAxis'; the meshlet
+	// is backfacing when the camera is inside the negative cone at 'coneApex';
+	// coneCutoff is the sine of the cone half angle, 1.0 disables the test
+	glm::vec3 coneApex = glm::vec3(0.0f);
+	glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float coneCutoff = 1.0f;
+};
+
+// view frustum planes (xyz = inward facing normal, w = distance) in the
+// space of the matrix they were extracted from
+struct BkFrustum {
+	glm::vec4 planes[6];
+};
+
+// split the triangles in [firstIndex, firstIndex + indexCount) into meshlets
+// in index buffer order; the index buffer should be vertex cache optimized
+// so consecutive triangles are spatially close
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, std::vector<BkMeshlet>& meshlets);
+
+// extract the frustum planes from a (model) view projection matrix with a
+// [0, 1] depth range (Gribb & Hartmann)
+BkFrustum extractFrustum(const glm::mat4& viewProj);
+
+bool isSphereInFrustum(const BkFrustum& frustum, const glm::vec3& center, float radius);
+
+// 'cameraPosition' has to be in the same (object) space as the meshlet
+bool isMeshletBackfacing(const BkMeshlet& meshlet, const glm::vec3& cameraPosition);
+
+// write an indexed indirect draw for every meshlet that is inside the frustum
+// and not backfacing; returns the number of draws written ('firstInstance'
+// is passed through, the bindless shaders use it as the material index)
+uint32_t cullMeshlets(const std::vector<BkMeshlet>& meshlets, const BkFrustum& frustum, const glm::vec3& cameraPosition, VkDrawIndexedIndirectCommand* drawCommands, uint32_t firstInstance = 0);
+
+// the same for 'meshletCount' meshlets, to cull a batch of them per job
+uint32_t cullMeshlets(const BkMeshlet* meshlets, uint32_t meshletCount, const BkFrustum& frustum, const glm::vec3& cameraPosition, VkDrawIndexedIndirectCommand* drawCommands, uint32_t firstInstance = 0);
+
+// the same, but write the indices (from 'firstMeshlet' on) of the meshlets
+// that pass instead of draws, for culling that continues on the GPU
+uint32_t cullMeshletIndices(const BkMeshlet* meshlets, uint32_t meshletCount, uint32_t firstMeshlet, const BkFrustum& frustum, const glm::vec3& cameraPosition, uint32_t* visibleMeshlets);
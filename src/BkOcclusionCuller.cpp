@@ -0,0 +1,698 @@
+#include "BkOcclusionCuller.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+static const std::string CULL_SHADER_PATH = "shaders/meshlet_cull.spv";
+static const std::string PYRAMID_SHADER_PATH = "shaders/depth_pyramid.spv";
+static const std::string PYRAMID_MULTISAMPLE_SHADER_PATH = "shaders/depth_pyramid_ms.spv";
+
+// std430 layout of a meshlet in the culling shader's meshlet buffer
+struct CullMeshlet {
+	float sphere[4];
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t padding[2];
+};
+
+// std430 layout of the counters, the first two are the draw counts
+struct CullCounters {
+	uint32_t drawCounts[2];
+	uint32_t occludedCount;
+	uint32_t padding;
+	uint32_t triangleCounts[2];
+};
+
+static std::vector<char> readFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("ERROR: failed to open '" + filename + "'!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+	return buffer;
+}
+
+// largest power of two not above 'value'
+static uint32_t getPreviousPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result * 2 <= value)
+	{
+		result *= 2;
+	}
+	return result;
+}
+
+BkOcclusionCuller::BkOcclusionCuller(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, const std::vector<BkMeshlet>& meshlets, VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, VkSampleCountFlagBits depthSamples)
+	: device(device), physicalDevice(physicalDevice), framesInFlight(framesInFlight), meshletCount(static_cast<uint32_t>(meshlets.size()))
+{
+	// culling set: meshlets, candidates, occluded meshlets, draws, counters
+	// and the pyramid
+	std::array<VkDescriptorSetLayoutBinding, 6> cullDescriptorSetLayoutBindings{};
+	for (uint32_t i = 0; i < cullDescriptorSetLayoutBindings.size(); i++)
+	{
+		cullDescriptorSetLayoutBindings[i].binding = i;
+		cullDescriptorSetLayoutBindings[i].descriptorType = i < 5 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		cullDescriptorSetLayoutBindings[i].descriptorCount = 1;
+		cullDescriptorSetLayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(cullDescriptorSetLayoutBindings.size());
+	descriptorSetLayoutCreateInfo.pBindings = cullDescriptorSetLayoutBindings.data();
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorSetLayout' failed to create the culling descriptor set layout!");
+	}
+
+	// pyramid level set: the source level (or depth image) and the level written
+	std::array<VkDescriptorSetLayoutBinding, 2> pyramidDescriptorSetLayoutBindings{};
+	pyramidDescriptorSetLayoutBindings[0].binding = 0;
+	pyramidDescriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidDescriptorSetLayoutBindings[0].descriptorCount = 1;
+	pyramidDescriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pyramidDescriptorSetLayoutBindings[1].binding = 1;
+	pyramidDescriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	pyramidDescriptorSetLayoutBindings[1].descriptorCount = 1;
+	pyramidDescriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(pyramidDescriptorSetLayoutBindings.size());
+	descriptorSetLayoutCreateInfo.pBindings = pyramidDescriptorSetLayoutBindings.data();
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &pyramidDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorSetLayout' failed to create the depth pyramid descriptor set layout!");
+	}
+
+	VkPushConstantRange cullPushConstantRange{};
+	cullPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	cullPushConstantRange.offset = 0;
+	cullPushConstantRange.size = sizeof(CullConstants);
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &cullDescriptorSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &cullPushConstantRange;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreatePipelineLayout' failed to create the culling pipeline layout!");
+	}
+
+	VkPushConstantRange pyramidPushConstantRange{};
+	pyramidPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pyramidPushConstantRange.offset = 0;
+	pyramidPushConstantRange.size = sizeof(PyramidConstants);
+	pipelineLayoutCreateInfo.pSetLayouts = &pyramidDescriptorSetLayout;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pyramidPushConstantRange;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pyramidPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreatePipelineLayout' failed to create the depth pyramid pipeline layout!");
+	}
+
+	cullPipeline = createComputePipeline(CULL_SHADER_PATH, cullPipelineLayout);
+	pyramidPipeline = createComputePipeline(PYRAMID_SHADER_PATH, pyramidPipelineLayout);
+
+	// the first level of a multisampled depth image takes the max of the
+	// samples, the shader is built with MULTISAMPLED defined
+	if (depthSamples != VK_SAMPLE_COUNT_1_BIT)
+	{
+		pyramidMultisamplePipeline = createComputePipeline(PYRAMID_MULTISAMPLE_SHADER_PATH, pyramidPipelineLayout);
+	}
+
+	// the shaders fetch texels, nearest and clamped keeps the reads in the level
+	VkSamplerCreateInfo samplerCreateInfo{};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(device, &samplerCreateInfo, nullptr, &pyramidSampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateSampler' failed to create the depth pyramid sampler!");
+	}
+
+	// the meshlets don't change, a host visible buffer is written once
+	VkDeviceSize meshletBufferSize = sizeof(CullMeshlet) * meshletCount;
+	createBuffer(meshletBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, meshletBuffer, meshletBufferDeviceMemory);
+	void* meshletData;
+	vkMapMemory(device, meshletBufferDeviceMemory, 0, meshletBufferSize, 0, &meshletData);
+	CullMeshlet* cullMeshlets = static_cast<CullMeshlet*>(meshletData);
+	meshletTriangleCounts.resize(meshletCount);
+	for (uint32_t i = 0; i < meshletCount; i++)
+	{
+		CullMeshlet cullMeshlet{};
+		cullMeshlet.sphere[0] = meshlets[i].center.x;
+		cullMeshlet.sphere[1] = meshlets[i].center.y;
+		cullMeshlet.sphere[2] = meshlets[i].center.z;
+		cullMeshlet.sphere[3] = meshlets[i].radius;
+		cullMeshlet.firstIndex = meshlets[i].firstIndex;
+		cullMeshlet.indexCount = meshlets[i].indexCount;
+		cullMeshlets[i] = cullMeshlet;
+		meshletTriangleCounts[i] = meshlets[i].indexCount / 3;
+	}
+	vkUnmapMemory(device, meshletBufferDeviceMemory);
+
+	// the draws of both phases fit every meshlet
+	VkDeviceSize candidateBufferSize = sizeof(uint32_t) * meshletCount;
+	VkDeviceSize drawBufferSize = sizeof(VkDrawIndexedIndirectCommand) * meshletCount * 2;
+	candidateBuffers.resize(framesInFlight);
+	candidateBuffersDeviceMemory.resize(framesInFlight);
+	candidateBuffersMapped.resize(framesInFlight);
+	occludedBuffers.resize(framesInFlight);
+	occludedBuffersDeviceMemory.resize(framesInFlight);
+	drawBuffers.resize(framesInFlight);
+	drawBuffersDeviceMemory.resize(framesInFlight);
+	counterBuffers.resize(framesInFlight);
+	counterBuffersDeviceMemory.resize(framesInFlight);
+	counterBuffersMapped.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		createBuffer(candidateBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, candidateBuffers[i], candidateBuffersDeviceMemory[i]);
+		void* candidateData;
+		vkMapMemory(device, candidateBuffersDeviceMemory[i], 0, candidateBufferSize, 0, &candidateData);
+		candidateBuffersMapped[i] = static_cast<uint32_t*>(candidateData);
+
+		createBuffer(candidateBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, occludedBuffers[i], occludedBuffersDeviceMemory[i]);
+		createBuffer(drawBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBuffers[i], drawBuffersDeviceMemory[i]);
+		createBuffer(sizeof(CullCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, counterBuffers[i], counterBuffersDeviceMemory[i]);
+		vkMapMemory(device, counterBuffersDeviceMemory[i], 0, sizeof(CullCounters), 0, &counterBuffersMapped[i]);
+		memset(counterBuffersMapped[i], 0, sizeof(CullCounters));
+	}
+	framesCandidateCounts.resize(framesInFlight, 0);
+	framesCandidateTriangleCounts.resize(framesInFlight, 0);
+	framesCulled.resize(framesInFlight, false);
+
+	// a culling set per frame in flight, the buffers are written once and the
+	// pyramid every frame since it's replaced on resize
+	std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes{};
+	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorPoolSizes[0].descriptorCount = 5 * framesInFlight;
+	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorPoolSizes[1].descriptorCount = framesInFlight;
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+	descriptorPoolCreateInfo.maxSets = framesInFlight;
+	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorPool' failed to create the culling descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(framesInFlight, cullDescriptorSetLayout);
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.descriptorPool = cullDescriptorPool;
+	descriptorSetAllocateInfo.descriptorSetCount = framesInFlight;
+	descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
+	cullDescriptorSets.resize(framesInFlight);
+	if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, cullDescriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateDescriptorSets' failed to allocate the culling descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		std::array<VkDescriptorBufferInfo, 5> descriptorBufferInfos{};
+		descriptorBufferInfos[0].buffer = meshletBuffer;
+		descriptorBufferInfos[1].buffer = candidateBuffers[i];
+		descriptorBufferInfos[2].buffer = occludedBuffers[i];
+		descriptorBufferInfos[3].buffer = drawBuffers[i];
+		descriptorBufferInfos[4].buffer = counterBuffers[i];
+
+		std::array<VkWriteDescriptorSet, 5> writeDescriptorSets{};
+		for (uint32_t j = 0; j < writeDescriptorSets.size(); j++)
+		{
+			descriptorBufferInfos[j].offset = 0;
+			descriptorBufferInfos[j].range = VK_WHOLE_SIZE;
+
+			writeDescriptorSets[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[j].dstSet = cullDescriptorSets[i];
+			writeDescriptorSets[j].dstBinding = j;
+			writeDescriptorSets[j].dstArrayElement = 0;
+			writeDescriptorSets[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSets[j].descriptorCount = 1;
+			writeDescriptorSets[j].pBufferInfo = &descriptorBufferInfos[j];
+		}
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	createDepthPyramid(depthImageView, depthWidth, depthHeight, depthPyramid);
+}
+
+BkOcclusionCuller::~BkOcclusionCuller()
+{
+	destroyDepthPyramid(depthPyramid);
+	for (uint32_t i = 0; i < framesInFlight; i++)
+	{
+		vkDestroyBuffer(device, counterBuffers[i], nullptr);
+		vkFreeMemory(device, counterBuffersDeviceMemory[i], nullptr);
+		vkDestroyBuffer(device, drawBuffers[i], nullptr);
+		vkFreeMemory(device, drawBuffersDeviceMemory[i], nullptr);
+		vkDestroyBuffer(device, occludedBuffers[i], nullptr);
+		vkFreeMemory(device, occludedBuffersDeviceMemory[i], nullptr);
+		vkDestroyBuffer(device, candidateBuffers[i], nullptr);
+		vkFreeMemory(device, candidateBuffersDeviceMemory[i], nullptr);
+	}
+	vkDestroyBuffer(device, meshletBuffer, nullptr);
+	vkFreeMemory(device, meshletBufferDeviceMemory, nullptr);
+	vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+	vkDestroySampler(device, pyramidSampler, nullptr);
+	if (pyramidMultisamplePipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, pyramidMultisamplePipeline, nullptr);
+	}
+	vkDestroyPipeline(device, pyramidPipeline, nullptr);
+	vkDestroyPipeline(device, cullPipeline, nullptr);
+	vkDestroyPipelineLayout(device, pyramidPipelineLayout, nullptr);
+	vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, pyramidDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+}
+
+bool BkOcclusionCuller::isSupported(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+	physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	physicalDeviceFeatures2.pNext = &physicalDeviceVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
+
+	return physicalDeviceVulkan12Features.drawIndirectCount
+		&& physicalDeviceFeatures2.features.multiDrawIndirect;
+}
+
+uint32_t BkOcclusionCuller::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags memoryPropertyFlags)
+{
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+	for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+	{
+		if ((memoryTypeBits & (1 << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+		{
+			return i;
+		}
+	}
+	throw std::runtime_error("ERROR: failed to find suitable memory type for occlusion culling!");
+}
+
+void BkOcclusionCuller::createBuffer(VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferDeviceMemory)
+{
+	VkBufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = deviceSize;
+	bufferCreateInfo.usage = bufferUsageFlags;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateBuffer' failed to create an occlusion culling buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, memoryPropertyFlags);
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &bufferDeviceMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to create device memory for an occlusion culling buffer!");
+	}
+	vkBindBufferMemory(device, buffer, bufferDeviceMemory, 0);
+}
+
+VkPipeline BkOcclusionCuller::createComputePipeline(const std::string& shaderPath, VkPipelineLayout pipelineLayout)
+{
+	std::vector<char> shaderBytecode = readFile(shaderPath);
+	VkShaderModuleCreateInfo shaderModuleCreateInfo{};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = shaderBytecode.size();
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderBytecode.data());
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateShaderModule' failed to create the shader module of '" + shaderPath + "'!");
+	}
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo{};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computePipelineCreateInfo.stage.module = shaderModule;
+	computePipelineCreateInfo.stage.pName = "main";
+	computePipelineCreateInfo.layout = pipelineLayout;
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateComputePipelines' failed to create the pipeline of '" + shaderPath + "'!");
+	}
+	return pipeline;
+}
+
+void BkOcclusionCuller::createDepthPyramid(VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, DepthPyramid& pyramid)
+{
+	// halving a power of two exactly keeps the levels aligned, so a texel of
+	// a level covers exactly 2x2 texels of the level below
+	pyramid.width = getPreviousPowerOfTwo(depthWidth);
+	pyramid.height = getPreviousPowerOfTwo(depthHeight);
+	pyramid.depthWidth = depthWidth;
+	pyramid.depthHeight = depthHeight;
+	uint32_t levelCount = 1;
+	while ((std::max(pyramid.width, pyramid.height) >> levelCount) > 0)
+	{
+		levelCount++;
+	}
+
+	VkImageCreateInfo imageCreateInfo{};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.extent.width = pyramid.width;
+	imageCreateInfo.extent.height = pyramid.height;
+	imageCreateInfo.extent.depth = 1;
+	imageCreateInfo.mipLevels = levelCount;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateImage(device, &imageCreateInfo, nullptr, &pyramid.image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateImage' failed to create the depth pyramid!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, pyramid.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &pyramid.imageDeviceMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to allocate the depth pyramid memory!");
+	}
+	vkBindImageMemory(device, pyramid.image, pyramid.imageDeviceMemory, 0);
+
+	// a view of the whole chain for the culling and one per level for the
+	// pyramid build, which reads a level while writing the next
+	VkImageViewCreateInfo imageViewCreateInfo{};
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.image = pyramid.image;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+	imageViewCreateInfo.subresourceRange.levelCount = levelCount;
+	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewCreateInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &pyramid.imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateImageView' failed to create the depth pyramid view!");
+	}
+	pyramid.levelImageViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		imageViewCreateInfo.subresourceRange.baseMipLevel = level;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &pyramid.levelImageViews[level]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkCreateImageView' failed to create a depth pyramid level view!");
+		}
+	}
+
+	std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes{};
+	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorPoolSizes[0].descriptorCount = levelCount;
+	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	descriptorPoolSizes[1].descriptorCount = levelCount;
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+	descriptorPoolCreateInfo.maxSets = levelCount;
+	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &pyramid.descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateDescriptorPool' failed to create the depth pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(levelCount, pyramidDescriptorSetLayout);
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.descriptorPool = pyramid.descriptorPool;
+	descriptorSetAllocateInfo.descriptorSetCount = levelCount;
+	descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
+	pyramid.descriptorSets.resize(levelCount);
+	if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, pyramid.descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateDescriptorSets' failed to allocate the depth pyramid descriptor sets!");
+	}
+
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		VkDescriptorImageInfo sourceDescriptorImageInfo{};
+		sourceDescriptorImageInfo.sampler = pyramidSampler;
+		sourceDescriptorImageInfo.imageView = level == 0 ? depthImageView : pyramid.levelImageViews[level - 1];
+		sourceDescriptorImageInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationDescriptorImageInfo{};
+		destinationDescriptorImageInfo.imageView = pyramid.levelImageViews[level];
+		destinationDescriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSets[0].dstSet = pyramid.descriptorSets[level];
+		writeDescriptorSets[0].dstBinding = 0;
+		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writeDescriptorSets[0].descriptorCount = 1;
+		writeDescriptorSets[0].pImageInfo = &sourceDescriptorImageInfo;
+		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSets[1].dstSet = pyramid.descriptorSets[level];
+		writeDescriptorSets[1].dstBinding = 1;
+		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writeDescriptorSets[1].descriptorCount = 1;
+		writeDescriptorSets[1].pImageInfo = &destinationDescriptorImageInfo;
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	pyramid.bInitialized = false;
+	pyramid.bValid = false;
+}
+
+void BkOcclusionCuller::destroyDepthPyramid(const DepthPyramid& pyramid)
+{
+	vkDestroyDescriptorPool(device, pyramid.descriptorPool, nullptr);
+	for (VkImageView levelImageView : pyramid.levelImageViews)
+	{
+		vkDestroyImageView(device, levelImageView, nullptr);
+	}
+	vkDestroyImageView(device, pyramid.imageView, nullptr);
+	vkDestroyImage(device, pyramid.image, nullptr);
+	vkFreeMemory(device, pyramid.imageDeviceMemory, nullptr);
+}
+
+void BkOcclusionCuller::resize(VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, BkDeletionQueue& deletionQueue, uint64_t lastUseValue)
+{
+	DepthPyramid retiredPyramid = depthPyramid;
+	deletionQueue.push(lastUseValue, [this, retiredPyramid]()
+	{
+		destroyDepthPyramid(retiredPyramid);
+	});
+	depthPyramid = DepthPyramid();
+	createDepthPyramid(depthImageView, depthWidth, depthHeight, depthPyramid);
+}
+
+uint32_t* BkOcclusionCuller::getCandidates(uint32_t frame) const
+{
+	return candidateBuffersMapped[frame];
+}
+
+bool BkOcclusionCuller::getStats(uint32_t frame, BkOcclusionStats& stats) const
+{
+	if (!framesCulled[frame])
+	{
+		return false;
+	}
+
+	CullCounters counters;
+	memcpy(&counters, counterBuffersMapped[frame], sizeof(CullCounters));
+	stats.candidateCount = framesCandidateCounts[frame];
+	stats.candidateTriangleCount = framesCandidateTriangleCounts[frame];
+	for (uint32_t phase = 0; phase < 2; phase++)
+	{
+		stats.drawCounts[phase] = counters.drawCounts[phase];
+		stats.triangleCounts[phase] = counters.triangleCounts[phase];
+	}
+	return true;
+}
+
+void BkOcclusionCuller::initializeDepthPyramid(VkCommandBuffer commandBuffer)
+{
+	// a new pyramid is moved to the general layout before anything uses it
+	if (depthPyramid.bInitialized)
+	{
+		return;
+	}
+
+	VkImageMemoryBarrier imageMemoryBarrier{};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.srcAccessMask = 0;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.image = depthPyramid.image;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+	imageMemoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+	depthPyramid.bInitialized = true;
+}
+
+void BkOcclusionCuller::recordCullPhase(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase)
+{
+	cullConstants.phase = phase;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[frame], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &cullConstants);
+
+	// the second phase tests at most as many meshlets as the first, the
+	// shader reads the actual count from the counters
+	if (cullConstants.candidateCount > 0)
+	{
+		vkCmdDispatch(commandBuffer, (cullConstants.candidateCount + OCCLUSION_CULL_GROUP_SIZE - 1) / OCCLUSION_CULL_GROUP_SIZE, 1, 1);
+	}
+
+	// the draws and counts are read by the indirect draws, the rejected
+	// meshlets and counters by the second phase, the statistics by the host
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void BkOcclusionCuller::recordFirstPhase(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t candidateCount, const glm::mat4& modelView, const glm::mat4& proj, uint32_t firstInstance)
+{
+	framesCandidateCounts[frame] = candidateCount;
+	framesCandidateTriangleCounts[frame] = 0;
+	for (uint32_t i = 0; i < candidateCount; i++)
+	{
+		framesCandidateTriangleCounts[frame] += meshletTriangleCounts[candidateBuffersMapped[frame][i]];
+	}
+	framesCulled[frame] = true;
+
+	// the frame's set isn't in use anymore, point it at the current pyramid
+	VkDescriptorImageInfo descriptorImageInfo{};
+	descriptorImageInfo.sampler = pyramidSampler;
+	descriptorImageInfo.imageView = depthPyramid.imageView;
+	descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	VkWriteDescriptorSet writeDescriptorSet{};
+	writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorSet.dstSet = cullDescriptorSets[frame];
+	writeDescriptorSet.dstBinding = 5;
+	writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeDescriptorSet.descriptorCount = 1;
+	writeDescriptorSet.pImageInfo = &descriptorImageInfo;
+	vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
+	initializeDepthPyramid(commandBuffer);
+
+	// clear the counters; the culling waits for the clear and for the
+	// previous frame's pyramid build
+	vkCmdFillBuffer(commandBuffer, counterBuffers[frame], 0, sizeof(CullCounters), 0);
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	// the spheres are scaled by the largest axis scale of the model view
+	float radiusScale = std::max({ glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2])) });
+	memcpy(cullConstants.modelView, &modelView[0][0], sizeof(cullConstants.modelView));
+	cullConstants.projection[0] = proj[0][0];
+	cullConstants.projection[1] = proj[1][1];
+	cullConstants.projection[2] = proj[2][2];
+	cullConstants.projection[3] = proj[3][2];
+	cullConstants.pyramidSize[0] = static_cast<float>(depthPyramid.width);
+	cullConstants.pyramidSize[1] = static_cast<float>(depthPyramid.height);
+	cullConstants.radiusScale = radiusScale;
+	cullConstants.candidateCount = candidateCount;
+	cullConstants.firstInstance = firstInstance;
+	cullConstants.pyramidValid = depthPyramid.bValid ? 1 : 0;
+	cullConstants.meshletCount = meshletCount;
+	recordCullPhase(commandBuffer, frame, 0);
+}
+
+void BkOcclusionCuller::recordDepthPyramid(VkCommandBuffer commandBuffer, uint32_t depthWidth, uint32_t depthHeight)
+{
+	// the first level stretches the drawn region over the whole pyramid, so
+	// the culling's screen space bounds map to it at any render resolution
+	initializeDepthPyramid(commandBuffer);
+	uint32_t sourceWidth = std::min(depthWidth, depthPyramid.depthWidth);
+	uint32_t sourceHeight = std::min(depthHeight, depthPyramid.depthHeight);
+	for (uint32_t level = 0; level < depthPyramid.levelImageViews.size(); level++)
+	{
+		if (level == 0 && pyramidMultisamplePipeline != VK_NULL_HANDLE)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidMultisamplePipeline);
+		}
+		else if (level <= 1)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipeline);
+		}
+
+		PyramidConstants pyramidConstants{};
+		pyramidConstants.sourceSize[0] = sourceWidth;
+		pyramidConstants.sourceSize[1] = sourceHeight;
+		pyramidConstants.destinationSize[0] = std::max(depthPyramid.width >> level, 1u);
+		pyramidConstants.destinationSize[1] = std::max(depthPyramid.height >> level, 1u);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipelineLayout, 0, 1, &depthPyramid.descriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants), &pyramidConstants);
+		vkCmdDispatch(commandBuffer,
+			(pyramidConstants.destinationSize[0] + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+			(pyramidConstants.destinationSize[1] + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+		// the next level (or the second phase) reads this one
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		sourceWidth = pyramidConstants.destinationSize[0];
+		sourceHeight = pyramidConstants.destinationSize[1];
+	}
+	depthPyramid.bValid = true;
+}
+
+void BkOcclusionCuller::recordSecondPhase(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	recordCullPhase(commandBuffer, frame, 1);
+}
+
+void BkOcclusionCuller::recordDraws(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase)
+{
+	VkDeviceSize drawOffset = sizeof(VkDrawIndexedIndirectCommand) * meshletCount * phase;
+	VkDeviceSize countOffset = sizeof(uint32_t) * phase;
+	vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffers[frame], drawOffset, counterBuffers[frame], countOffset, meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+}
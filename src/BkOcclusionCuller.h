@@ -0,0 +1,182 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "BkMeshlet.h"
+#include "BkDeletionQueue.h"
+
+// invocations per workgroup of meshlet_cull.comp and per dimension of
+// depth_pyramid.comp
+const uint32_t OCCLUSION_CULL_GROUP_SIZE = 64;
+const uint32_t DEPTH_PYRAMID_GROUP_SIZE = 8;
+
+// what the two culling phases of a frame drew; the candidates passed the CPU
+// frustum and cone culling, everything else was occluded
+struct BkOcclusionStats {
+	uint32_t candidateCount = 0;
+	uint32_t candidateTriangleCount = 0;
+	uint32_t drawCounts[2] = { 0, 0 };
+	uint32_t triangleCounts[2] = { 0, 0 };
+};
+
+// occlusion culling of meshlets on the GPU against a hierarchical depth
+// buffer (Hi-Z): a pyramid of max depth levels built by compute from the
+// depth image. A frame culls in two phases around the pyramid build:
+//   1. the candidates are tested against the previous frame's pyramid, the
+//      passing ones are drawn and the rejected ones remembered
+//   2. the pyramid is rebuilt from that depth and the rejected meshlets are
+//      tested again, the ones that became visible (disoccluded) are drawn
+// both phases append to an indirect buffer drawn with a GPU side count
+class BkOcclusionCuller
+{
+private:
+	// max depth mip chain of the previous power of two of the depth image's
+	// size, kept in the general layout for both the storage writes and the
+	// sampled reads; replaced with the depth image
+	struct DepthPyramid {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory imageDeviceMemory = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		std::vector<VkImageView> levelImageViews;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		// one per level, reading the level before (or the depth image)
+		std::vector<VkDescriptorSet> descriptorSets;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depthWidth = 0;
+		uint32_t depthHeight = 0;
+
+		// the layout transition is recorded before the first use, the
+		// contents are valid once a frame has built them
+		bool bInitialized = false;
+		bool bValid = false;
+	};
+
+	// push constants of meshlet_cull.comp
+	struct CullConstants {
+		float modelView[16];
+		// P00, P11, P22 and P32 of the projection matrix
+		float projection[4];
+		float pyramidSize[2];
+		float radiusScale;
+		uint32_t candidateCount;
+		uint32_t phase;
+		uint32_t firstInstance;
+		uint32_t pyramidValid;
+		uint32_t meshletCount;
+	};
+
+	// push constants of depth_pyramid.comp
+	struct PyramidConstants {
+		uint32_t sourceSize[2];
+		uint32_t destinationSize[2];
+	};
+
+	VkDevice device;
+	VkPhysicalDevice physicalDevice;
+	uint32_t framesInFlight;
+	uint32_t meshletCount;
+	std::vector<uint32_t> meshletTriangleCounts;
+
+	VkDescriptorSetLayout cullDescriptorSetLayout;
+	VkPipelineLayout cullPipelineLayout;
+	VkPipeline cullPipeline;
+	VkDescriptorSetLayout pyramidDescriptorSetLayout;
+	VkPipelineLayout pyramidPipelineLayout;
+	VkPipeline pyramidPipeline;
+	// builds the first level from a multisampled depth image
+	VkPipeline pyramidMultisamplePipeline = VK_NULL_HANDLE;
+	VkSampler pyramidSampler;
+
+	VkDescriptorPool cullDescriptorPool;
+	std::vector<VkDescriptorSet> cullDescriptorSets;
+
+	VkBuffer meshletBuffer;
+	VkDeviceMemory meshletBufferDeviceMemory;
+
+	// per frame in flight: the candidates written by the CPU, the meshlets
+	// the first phase rejected, the draws of both phases and the counters,
+	// which stay mapped to read the statistics back
+	std::vector<VkBuffer> candidateBuffers;
+	std::vector<VkDeviceMemory> candidateBuffersDeviceMemory;
+	std::vector<uint32_t*> candidateBuffersMapped;
+	std::vector<VkBuffer> occludedBuffers;
+	std::vector<VkDeviceMemory> occludedBuffersDeviceMemory;
+	std::vector<VkBuffer> drawBuffers;
+	std::vector<VkDeviceMemory> drawBuffersDeviceMemory;
+	std::vector<VkBuffer> counterBuffers;
+	std::vector<VkDeviceMemory> counterBuffersDeviceMemory;
+	std::vector<void*> counterBuffersMapped;
+
+	// what the frames recorded, for the statistics
+	std::vector<uint32_t> framesCandidateCounts;
+	std::vector<uint32_t> framesCandidateTriangleCounts;
+	std::vector<bool> framesCulled;
+
+	DepthPyramid depthPyramid;
+
+	// the first phase's constants, reused by the second phase
+	CullConstants cullConstants{};
+
+	uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags memoryPropertyFlags);
+
+	void createBuffer(VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferDeviceMemory);
+
+	VkPipeline createComputePipeline(const std::string& shaderPath, VkPipelineLayout pipelineLayout);
+
+	void createDepthPyramid(VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, DepthPyramid& pyramid);
+
+	void destroyDepthPyramid(const DepthPyramid& pyramid);
+
+	// record the layout transition of a new pyramid, once
+	void initializeDepthPyramid(VkCommandBuffer commandBuffer);
+
+	void recordCullPhase(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase);
+
+public:
+	// 'depthImageView' is the depth the pyramid is built from, it has to be
+	// created with the sampled usage; a multisampled one ('depthSamples') is
+	// reduced to the farthest sample
+	BkOcclusionCuller(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, const std::vector<BkMeshlet>& meshlets, VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, VkSampleCountFlagBits depthSamples = VK_SAMPLE_COUNT_1_BIT);
+	~BkOcclusionCuller();
+
+	BkOcclusionCuller(const BkOcclusionCuller&) = delete;
+	BkOcclusionCuller& operator=(const BkOcclusionCuller&) = delete;
+
+	// true if the device supports drawing with a GPU side count
+	// (drawIndirectCount, which also has to be enabled, and multiDrawIndirect)
+	static bool isSupported(VkPhysicalDevice physicalDevice);
+
+	// rebuild the pyramid for a new depth image; the old one is destroyed
+	// through the deletion queue once 'lastUseValue' has completed
+	void resize(VkImageView depthImageView, uint32_t depthWidth, uint32_t depthHeight, BkDeletionQueue& deletionQueue, uint64_t lastUseValue);
+
+	// the frame's candidate buffer, room for every meshlet; write the indices
+	// of the meshlets to test after waiting for the frame's fence
+	uint32_t* getCandidates(uint32_t frame) const;
+
+	// what the frame drew the last time it culled; false if it never did,
+	// call after waiting for the frame's fence
+	bool getStats(uint32_t frame, BkOcclusionStats& stats) const;
+
+	// reset the frame's counters and cull the first 'candidateCount'
+	// candidates against the previous frame's pyramid; outside a render pass
+	void recordFirstPhase(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t candidateCount, const glm::mat4& modelView, const glm::mat4& proj, uint32_t firstInstance);
+
+	// build the pyramid from the depth the first phase's draws left in the
+	// top left 'depthWidth' x 'depthHeight' of the depth image (less than
+	// its size with dynamic resolution), which has to be in the depth
+	// stencil read only layout
+	void recordDepthPyramid(VkCommandBuffer commandBuffer, uint32_t depthWidth, uint32_t depthHeight);
+
+	// cull the meshlets the first phase rejected against the new pyramid
+	void recordSecondPhase(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	// draw what 'phase' (0 or 1) appended, inside the render pass with the
+	// graphics pipeline, vertex and index buffers bound
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase);
+};
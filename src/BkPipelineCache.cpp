@@ -0,0 +1,67 @@
+#include "BkPipelineCache.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+
+BkPipelineCache::BkPipelineCache(VkDevice device, const std::string& path)
+	: device(device), path(path)
+{
+	// a missing file just means an empty cache
+	std::vector<char> initialData;
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		initialData.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(initialData.data(), initialData.size());
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.initialDataSize = initialData.size();
+	pipelineCacheCreateInfo.pInitialData = initialData.data();
+	if (vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+	{
+		// data the driver rejects outright, start over with an empty cache
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkCreatePipelineCache' failed to create a pipeline cache!");
+		}
+	}
+}
+
+BkPipelineCache::~BkPipelineCache()
+{
+	save();
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+}
+
+VkPipelineCache BkPipelineCache::get() const
+{
+	return pipelineCache;
+}
+
+void BkPipelineCache::save() const
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "WARNING: failed to write the pipeline cache to '" << path << "'" << std::endl;
+		return;
+	}
+	file.write(data.data(), dataSize);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// VkPipelineCache that is loaded from and saved to a file, so the shader
+// variants compiled in one run are reused by the next; the driver checks the
+// header of the data and ignores a cache written by another device or driver
+class BkPipelineCache
+{
+private:
+	VkDevice device;
+	std::string path;
+	VkPipelineCache pipelineCache;
+
+public:
+	BkPipelineCache(VkDevice device, const std::string& path = PIPELINE_CACHE_PATH);
+	~BkPipelineCache();
+
+	BkPipelineCache(const BkPipelineCache&) = delete;
+	BkPipelineCache& operator=(const BkPipelineCache&) = delete;
+
+	// internally synchronized, pipelines can be created from several threads
+	VkPipelineCache get() const;
+
+	void save() const;
+};
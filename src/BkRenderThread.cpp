@@ -0,0 +1,98 @@
+#include "BkRenderThread.h"
+
+BkRenderThread::BkRenderThread(BkRenderer& renderer)
+	: renderer(renderer)
+{
+	thread = std::thread(&BkRenderThread::renderLoop, this);
+}
+
+BkRenderThread::~BkRenderThread()
+{
+	bStopping = true;
+	wake(packetCondition);
+	thread.join();
+}
+
+void BkRenderThread::publish(const BkFramePacket& packet)
+{
+	while (!framePackets.tryPush(packet))
+	{
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		spaceCondition.wait(lock, [this] { return bFailed || !framePackets.isFull(); });
+		if (bFailed)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+	wake(packetCondition);
+
+	if (bFailed)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+uint64_t BkRenderThread::getPresentedFrameCount() const
+{
+	return presentedFrameCount.load(std::memory_order_acquire);
+}
+
+std::chrono::high_resolution_clock::time_point BkRenderThread::getFirstFrameTime() const
+{
+	return firstFrameTime;
+}
+
+void BkRenderThread::wake(std::condition_variable& condition)
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	condition.notify_one();
+}
+
+void BkRenderThread::renderLoop()
+{
+	try
+	{
+		while (true)
+		{
+			BkFramePacket packet;
+			if (!framePackets.tryPop(packet))
+			{
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				packetCondition.wait(lock, [this] { return bStopping || !framePackets.isEmpty(); });
+				if (bStopping && framePackets.isEmpty())
+				{
+					return;
+				}
+				continue;
+			}
+			wake(spaceCondition);
+
+			renderer.setView(packet.view);
+			renderer.setModel(packet.model);
+
+			// the packet is dropped while the swapchain is being recreated
+			if (!renderer.beginFrame())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(RENDER_THREAD_RETRY_MS));
+				continue;
+			}
+			renderer.submit();
+			renderer.endFrame();
+
+			// the time is written before the count is published
+			if (presentedFrameCount.load(std::memory_order_relaxed) == 0)
+			{
+				firstFrameTime = std::chrono::high_resolution_clock::now();
+			}
+			presentedFrameCount.fetch_add(1, std::memory_order_release);
+		}
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+		bFailed = true;
+		wake(spaceCondition);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "BkRenderer.h"
+#include "BkSpscRing.h"
+
+// packets published ahead of the one being rendered; with 1 the simulation
+// prepares frame N + 1 while frame N is rendered
+const uint32_t RENDER_QUEUE_CAPACITY = 1;
+
+// how long the render thread waits before it tries again to render into a
+// swapchain that can't be recreated (minimized window)
+const int RENDER_THREAD_RETRY_MS = 10;
+
+// everything the renderer needs from the simulation to draw one frame, copied
+// into the ring so the simulation is free to change its state afterwards
+struct BkFramePacket {
+	uint64_t frame = 0;
+	glm::mat4 view = glm::mat4(1.0f);
+
+	// transform of the renderer's mesh instance
+	glm::mat4 model = glm::mat4(1.0f);
+};
+
+// drives the renderer on its own thread: the simulation thread publishes a
+// frame packet through a lock-free SPSC ring and carries on with the next
+// frame while this one records, submits and presents it; the mutex and
+// condition variables are only used to sleep while there's nothing to do
+class BkRenderThread
+{
+private:
+	BkRenderer& renderer;
+	std::thread thread;
+	BkSpscRing<BkFramePacket, RENDER_QUEUE_CAPACITY> framePackets;
+
+	std::mutex sleepMutex;
+	std::condition_variable packetCondition;
+	std::condition_variable spaceCondition;
+	std::atomic<bool> bStopping{ false };
+
+	// set when the render thread stopped because of an exception, rethrown on
+	// the simulation thread
+	std::atomic<bool> bFailed{ false };
+	std::exception_ptr exception;
+
+	std::atomic<uint64_t> presentedFrameCount{ 0 };
+	std::chrono::high_resolution_clock::time_point firstFrameTime;
+
+	void renderLoop();
+
+	// wake a thread sleeping on 'condition', taking the lock first so a
+	// sleeper that is checking its predicate can't miss it
+	void wake(std::condition_variable& condition);
+
+public:
+	BkRenderThread(BkRenderer& renderer);
+
+	// renders the frames already published, then stops the thread
+	~BkRenderThread();
+
+	BkRenderThread(const BkRenderThread&) = delete;
+	BkRenderThread& operator=(const BkRenderThread&) = delete;
+
+	// publish the next frame, waits while the render thread is still
+	// RENDER_QUEUE_CAPACITY frames behind; simulation thread only
+	void publish(const BkFramePacket& packet);
+
+	uint64_t getPresentedFrameCount() const;
+
+	// when the first frame was presented, valid once a frame was presented
+	std::chrono::high_resolution_clock::time_point getFirstFrameTime() const;
+};
@@ -2,6 +2,9 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
@@ -17,24 +20,15 @@
 #include <tiny_obj_loader.h>
 #include <unordered_map>
 
+#include "BkMeshOptimizer.h"
+#include "BkMeshSimplifier.h"
+
 struct UniformBufferObject {
 	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
 };
 
-// callback function for debug utils messenger create info
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* pUserData) {
-
-    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
-    return VK_FALSE;
-}
-
 // helper function to load the *.spv binary shader files
 static std::vector<char> readFile(const std::string& filename)
 {
@@ -55,14 +49,22 @@ static std::vector<char> readFile(const std::string& filename)
 
 void BkRenderer::createDepthResources(VkFormat& depthFormat)
 {
-	// find the supported depth buffer format for the depth image
+	// find the supported depth buffer format for the depth image, the depth
+	// pyramid of the occlusion culling samples it
+	VkFormatFeatureFlags formatFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	VkImageUsageFlags depthImageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (bOcclusionCulling)
+	{
+		formatFeatures |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		depthImageUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
 	bool bFoundSupportedFormat = false;
 	std::vector<VkFormat> formatCandidates = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
 	for (VkFormat format : formatCandidates) {
 		VkFormatProperties formatProperties;
 		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-		if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) == VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+		if ((formatProperties.optimalTilingFeatures & formatFeatures) == formatFeatures) {
 			depthFormat = format;
 			bFoundSupportedFormat = true;
 			break;
@@ -73,26 +75,285 @@ void BkRenderer::createDepthResources(VkFormat& depthFormat)
 		throw std::runtime_error("ERROR: failed to find supported format!");
 	}
 
+	// the depth of a single pass is never stored, so it doesn't need memory
+	// on tile based GPUs
+	VkMemoryPropertyFlags depthMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (!bOcclusionCulling)
+	{
+		depthImageUsage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		depthMemoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
 	// create an image and image view for the depth image
-	createImage(swapchainExtent.width, swapchainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageDeviceMemory);
+	createImage(renderTargetExtent.width, renderTargetExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, depthImageUsage, depthMemoryProperties, depthImage, depthImageDeviceMemory, msaaSamples);
 	createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, depthImageView);
 }
 
+void BkRenderer::createColorResources()
+{
+	// the samples are resolved within the last pass and never stored, unless
+	// the second occlusion culling pass draws over the first one's
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+	{
+		VkImageUsageFlags colorImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		VkMemoryPropertyFlags colorMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		if (!bOcclusionCulling)
+		{
+			colorImageUsage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			colorMemoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		}
+		createImage(renderTargetExtent.width, renderTargetExtent.height, swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL, colorImageUsage, colorMemoryProperties, colorImage, colorImageDeviceMemory, msaaSamples);
+		createImageView(colorImage, swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, colorImageView);
+	}
+
+	// the scene image takes the place of the swapchain image in the render
+	// passes and is the source of the upscaling blit
+	if (bDynamicResolution)
+	{
+		createImage(renderTargetExtent.width, renderTargetExtent.height, swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sceneImage, sceneImageDeviceMemory);
+		createImageView(sceneImage, swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, sceneImageView);
+	}
+}
+
+bool BkRenderer::isDynamicResolutionSupported(VkFormat swapchainFormat, VkFormat sceneFormat)
+{
+	// the frame time is measured on the graphics queue
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamiliesProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamiliesProperties.data());
+	if (queueFamiliesProperties[graphicsQueueFamilyIndex].timestampValidBits == 0)
+	{
+		return false;
+	}
+
+	// the swapchain images are blitted to, in the swapchain's format
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+	if (!(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+	{
+		return false;
+	}
+	VkFormatProperties swapchainFormatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, swapchainFormat, &swapchainFormatProperties);
+	if (!(swapchainFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT))
+	{
+		return false;
+	}
+
+	// the scene image is rendered to and blitted from
+	VkFormatProperties sceneFormatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, sceneFormat, &sceneFormatProperties);
+	VkFormatFeatureFlags sceneFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT;
+	return (sceneFormatProperties.optimalTilingFeatures & sceneFeatures) == sceneFeatures;
+}
+
+void BkRenderer::readFrameTimestamps()
+{
+	// the frame that last used the slot has completed, so its timestamps are
+	// available unless the slot wasn't submitted yet
+	if (!framesTimestamped[currentFrame])
+	{
+		return;
+	}
+
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(device, timestampQueryPool, 2 * currentFrame, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+	{
+		// the timestamps wrap around at 'timestampValidBits'
+		uint64_t mask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+		uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+		frameTimings.gpuFrame = inFlightFrameNumbers[currentFrame];
+		frameTimings.gpuTime = ticks * static_cast<double>(timestampPeriod) / 1000000.0;
+		frameTimings.bGpuTime = true;
+	}
+}
+
+void BkRenderer::updateRenderExtent()
+{
+	if (!bDynamicResolution)
+	{
+		renderExtent = swapchainExtent;
+		return;
+	}
+
+	// only a time read for this slot's previous frame is new
+	if (frameTimings.bGpuTime && frameTimings.gpuFrame == inFlightFrameNumbers[currentFrame])
+	{
+		dynamicResolution->update(static_cast<float>(frameTimings.gpuTime));
+	}
+	renderExtent.width = std::min(dynamicResolution->scaleExtent(swapchainExtent.width), renderTargetExtent.width);
+	renderExtent.height = std::min(dynamicResolution->scaleExtent(swapchainExtent.height), renderTargetExtent.height);
+}
+
+VkRenderPass BkRenderer::createRenderPass(VkFormat depthFormat, bool bFirstPass, bool bLastPass)
+{
+	// create depth attachment description
+	VkAttachmentDescription depthAttachmentDescription{};
+	depthAttachmentDescription.format = depthFormat;
+	depthAttachmentDescription.samples = msaaSamples;
+	depthAttachmentDescription.loadOp = bFirstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachmentDescription.storeOp = bLastPass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+	// the depth pyramid is built from the depth between the passes
+	depthAttachmentDescription.initialLayout = bFirstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthAttachmentDescription.finalLayout = bLastPass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	// create depth attachment reference
+	VkAttachmentReference depthAttachmentReference{};
+	depthAttachmentReference.attachment = 1;
+	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// create color attachment description; the last pass leaves the image that
+	// takes the samples ready to present, or to blit with dynamic resolution
+	bool bMultisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+	VkImageLayout presentedLayout = bDynamicResolution ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	VkAttachmentDescription colorAttachmentDescription{};
+	colorAttachmentDescription.format = swapchainImageFormat;
+	colorAttachmentDescription.samples = msaaSamples;
+
+	// clear framebuffer before drawing and store drawing data, later passes
+	// draw over what the first one drew; the samples of the last pass are
+	// resolved before the store, so they don't have to leave the tile memory
+	colorAttachmentDescription.loadOp = bFirstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	colorAttachmentDescription.storeOp = bMultisampled && bLastPass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+
+	// set to don't care because the program doesn't use the stencil buffer
+	colorAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+	// set final layout to present src KHR so imags can be presented in
+	// the swapchain
+	colorAttachmentDescription.initialLayout = bFirstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentDescription.finalLayout = bLastPass && !bMultisampled ? presentedLayout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// create color attachment reference
+	VkAttachmentReference colorAttachmentReference{};
+	colorAttachmentReference.attachment = 0;
+	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// create resolve attachment description for the swapchain image; the
+	// passes before the last resolve too (to stay compatible with the last
+	// one) but don't store it
+	VkAttachmentDescription resolveAttachmentDescription{};
+	resolveAttachmentDescription.format = swapchainImageFormat;
+	resolveAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachmentDescription.storeOp = bLastPass ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachmentDescription.finalLayout = bLastPass ? presentedLayout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// create resolve attachment reference
+	VkAttachmentReference resolveAttachmentReference{};
+	resolveAttachmentReference.attachment = 2;
+	resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// create subpass description
+	VkSubpassDescription subpassDescription{};
+	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpassDescription.colorAttachmentCount = 1;
+	subpassDescription.pColorAttachments = &colorAttachmentReference;
+	subpassDescription.pResolveAttachments = bMultisampled ? &resolveAttachmentReference : nullptr;
+	subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+
+	// create subpass dependency to specify what operations should wait to
+	// be performed
+	std::vector<VkSubpassDependency> subpassDependencies;
+	VkSubpassDependency subpassDependency{};
+	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependency.dstSubpass = 0;
+	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependency.srcAccessMask = 0;
+	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	if (bFirstPass && bDynamicResolution)
+	{
+		// the previous frame's blit may still read the scene image
+		subpassDependency.srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	if (!bFirstPass)
+	{
+		// draw over the previous pass once the depth pyramid build is done
+		// reading its depth
+		subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		subpassDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	}
+	subpassDependencies.push_back(subpassDependency);
+	if (!bLastPass)
+	{
+		// the depth pyramid build reads the depth after the pass
+		VkSubpassDependency depthSubpassDependency{};
+		depthSubpassDependency.srcSubpass = 0;
+		depthSubpassDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		depthSubpassDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		depthSubpassDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthSubpassDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		depthSubpassDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		subpassDependencies.push_back(depthSubpassDependency);
+	}
+	if (bLastPass && bDynamicResolution)
+	{
+		// the upscaling blit reads the scene image after the pass
+		VkSubpassDependency blitSubpassDependency{};
+		blitSubpassDependency.srcSubpass = 0;
+		blitSubpassDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		blitSubpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		blitSubpassDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		blitSubpassDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		blitSubpassDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		subpassDependencies.push_back(blitSubpassDependency);
+	}
+
+	// create render pass
+	std::vector<VkAttachmentDescription> attachmentDescriptions = { colorAttachmentDescription, depthAttachmentDescription };
+	if (bMultisampled)
+	{
+		attachmentDescriptions.push_back(resolveAttachmentDescription);
+	}
+	VkRenderPassCreateInfo renderPassCreateInfo{};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
+	renderPassCreateInfo.pAttachments = attachmentDescriptions.data();
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpassDescription;
+	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+	renderPassCreateInfo.pDependencies = subpassDependencies.data();
+	VkRenderPass createdRenderPass;
+	if (vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &createdRenderPass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateRenderPass' failed to create a render pass!");
+	}
+	return createdRenderPass;
+}
+
 void BkRenderer::createSwapchainFramebuffer()
 {
-	// wrap all of the VkImageViews into a frame buffer
-	swapchainFramebuffers.resize(swapchainImageViews.size());
-	for (size_t i = 0; i < swapchainImageViews.size(); i++)
+	// wrap all of the VkImageViews into a frame buffer, with dynamic
+	// resolution there is one for the scene image instead
+	swapchainFramebuffers.resize(bDynamicResolution ? 1 : swapchainImageViews.size());
+	for (size_t i = 0; i < swapchainFramebuffers.size(); i++)
 	{
-		std::array<VkImageView, 2> attachments = { swapchainImageViews[i], depthImageView };
+		// with MSAA the swapchain (or scene) image is the resolve attachment
+		VkImageView presentedImageView = bDynamicResolution ? sceneImageView : swapchainImageViews[i];
+		std::vector<VkImageView> attachments = { presentedImageView, depthImageView };
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			attachments = { colorImageView, depthImageView, presentedImageView };
+		}
 
 		VkFramebufferCreateInfo framebufferCreateInfo{};
 		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebufferCreateInfo.renderPass = renderPass;
 		framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 		framebufferCreateInfo.pAttachments = attachments.data();
-		framebufferCreateInfo.width = swapchainExtent.width;
-		framebufferCreateInfo.height = swapchainExtent.height;
+		framebufferCreateInfo.width = renderTargetExtent.width;
+		framebufferCreateInfo.height = renderTargetExtent.height;
 		framebufferCreateInfo.layers = 1;
 		if (vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &swapchainFramebuffers[i]) != VK_SUCCESS)
 		{
@@ -101,31 +362,246 @@ void BkRenderer::createSwapchainFramebuffer()
 	}
 }
 
-void BkRenderer::recreateSwapchain()
+VkSurfaceFormatKHR BkRenderer::chooseSurfaceFormat()
 {
-	// wait until window is unminimized to prevent framebuffer being size of 0
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
-	while (width == 0 || height == 0)
+	// query the surface formats for a format that supports
+	// VK_FORMAT_B8G8R8A8_SRGB & VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
+	uint32_t surfaceFormatCount;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, nullptr);
+	std::vector<VkSurfaceFormatKHR> surfaceFormats(surfaceFormatCount);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &surfaceFormatCount, surfaceFormats.data());
+	VkSurfaceFormatKHR surfaceFormat{};
+	bool foundSurfaceFormat = false;
+	for (const auto& format : surfaceFormats)
+	{
+		if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+		{
+			foundSurfaceFormat = true;
+			surfaceFormat = format;
+		}
+	}
+	if (!foundSurfaceFormat)
 	{
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
+		throw std::runtime_error("ERROR: failed to find a surface format that supports 'VK_FORMAT_B8G8R8A8_SRGB' & 'VK_COLOR_SPACE_SRGB_NONLINEAR_KHR'!");
 	}
+	return surfaceFormat;
+}
 
-	// wait for the logical device to finish operations before cleanup
-	vkDeviceWaitIdle(device);
+void BkRenderer::createSwapchainAndImageViews(VkSwapchainKHR oldSwapchain)
+{
+	VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat();
+
+	// query the supported presentation modes
+	uint32_t presentModeCount;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
 
-	// cleanup allocated swapchain resources
-	cleanupSwapchain();
+	// present mode FIFO (capped frame rate) is guaranteed to be available
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	for (const auto& mode : presentModes)
+	{
+		// replaces queued images with newer ones ("triple buffering")
+		if (mode == VK_PRESENT_MODE_MAILBOX_KHR && presentMode == VK_PRESENT_MODE_FIFO_KHR)
+		{
+			presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+		}
+
+		// presents right away, even in the middle of a scanout (tearing)
+		if (mode == VK_PRESENT_MODE_IMMEDIATE_KHR && !bVsync)
+		{
+			presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+		}
+	}
+
+	// query surface extent (controls image resolution) to be in pixels instead
+	// of screen coordinates
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+	VkExtent2D extent{};
+	if (surfaceCapabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
+	{
+		extent = surfaceCapabilities.currentExtent;
+	}
+	else
+	{
+		extent = {
+			framebufferWidth.load(),
+			framebufferHeight.load()
+		};
+
+		extent.width = std::clamp(extent.width, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
+		extent.height = std::clamp(extent.height, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
+	}
+
+	// specify number of images in the swapchain to be one more than the min to prevent 
+	// waiting on the driver to complete operations before getting the next image
+	uint32_t swapchainMinImageCount = surfaceCapabilities.minImageCount + 1;
+	if (surfaceCapabilities.maxImageCount > 0 && swapchainMinImageCount > surfaceCapabilities.maxImageCount)
+	{
+		swapchainMinImageCount = surfaceCapabilities.maxImageCount;
+	}
+
+	// populate swapchain create info
+	swapchainImageFormat = surfaceFormat.format;
+	swapchainExtent = extent;
+
+	// the render targets fit the largest scale of the dynamic resolution
+	renderTargetExtent = extent;
+	if (bDynamicResolution)
+	{
+		renderTargetExtent.width = std::max(static_cast<uint32_t>(std::lround(extent.width * DYNAMIC_RESOLUTION_MAX_SCALE)), 1u);
+		renderTargetExtent.height = std::max(static_cast<uint32_t>(std::lround(extent.height * DYNAMIC_RESOLUTION_MAX_SCALE)), 1u);
+	}
+	renderExtent = extent;
+	VkSwapchainCreateInfoKHR swapchainCreateInfo{};
+	swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	swapchainCreateInfo.surface = surface;
+	swapchainCreateInfo.minImageCount = swapchainMinImageCount;
+	swapchainCreateInfo.imageFormat = surfaceFormat.format;
+	swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
+	swapchainCreateInfo.imageExtent = extent;
+	swapchainCreateInfo.imageArrayLayers = 1;
+
+	// specify we want to render directly to the images in the swapchain when rendering
+	// to a separate image first for post-fx use VK_IMAGE_USAGE_TRANSFER_DST_BIT
+	swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (bDynamicResolution)
+	{
+		swapchainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
+	// specify how to handle images used across queue families
+	uint32_t queueFamilyIndices[] = { graphicsQueueFamilyIndex, presentQueueFamilyIndex };
+	if (graphicsQueueFamilyIndex != presentQueueFamilyIndex)
+	{
+		// use concurrent ownership over queue families to avoid managing it
+		swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		swapchainCreateInfo.queueFamilyIndexCount = 2;
+		swapchainCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+	{
+		// exclusive ownership is more performant
+		swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		swapchainCreateInfo.queueFamilyIndexCount = 0; // optional
+		swapchainCreateInfo.pQueueFamilyIndices = nullptr; // optional
+	}
+
+	swapchainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
+
+	// choose opaque to ignore how the alpha value blends with other windows
+	swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+
+	swapchainCreateInfo.presentMode = presentMode;
+	swapchainCreateInfo.clipped = VK_TRUE;
+	// lets the driver reuse the resources of the swapchain being replaced,
+	// which is retired and destroyed once the frames in flight are done
+	swapchainCreateInfo.oldSwapchain = oldSwapchain;
+
+	// create swapchain
+	if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapchain) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateSwapchainKHR' failed to create a swapchain!");
+	}
+
+	// create swapchain images to reference during rendering
+	uint32_t swapchainImageCount;
+	vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, nullptr);
+	swapchainImages.resize(swapchainImageCount);
+	vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, swapchainImages.data());
+
+	// create image views to use the images
+	swapchainImageViews.resize(swapchainImages.size());
+	for (size_t i = 0; i < swapchainImages.size(); i++)
+	{
+		createImageView(swapchainImages[i], swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, swapchainImageViews[i]);
+	}
+}
+
+void BkRenderer::retireSwapchain()
+{
+	// the objects may still be used by the frames in flight, destroy them once
+	// the last submitted frame has completed
+	std::vector<VkFramebuffer> retiredFramebuffers = swapchainFramebuffers;
+	std::vector<VkImageView> retiredImageViews = swapchainImageViews;
+	VkImage retiredDepthImage = depthImage;
+	VkDeviceMemory retiredDepthImageDeviceMemory = depthImageDeviceMemory;
+	VkImageView retiredDepthImageView = depthImageView;
+	VkImage retiredColorImage = colorImage;
+	VkDeviceMemory retiredColorImageDeviceMemory = colorImageDeviceMemory;
+	VkImageView retiredColorImageView = colorImageView;
+	VkImage retiredSceneImage = sceneImage;
+	VkDeviceMemory retiredSceneImageDeviceMemory = sceneImageDeviceMemory;
+	VkImageView retiredSceneImageView = sceneImageView;
+	VkSwapchainKHR retiredSwapchain = swapchain;
+	deletionQueue.push(frameNumber, [this, retiredFramebuffers, retiredImageViews, retiredDepthImage, retiredDepthImageDeviceMemory, retiredDepthImageView, retiredColorImage, retiredColorImageDeviceMemory, retiredColorImageView, retiredSceneImage, retiredSceneImageDeviceMemory, retiredSceneImageView, retiredSwapchain]()
+	{
+		for (VkFramebuffer framebuffer : retiredFramebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		vkDestroyImageView(device, retiredDepthImageView, nullptr);
+		vkDestroyImage(device, retiredDepthImage, nullptr);
+		vkFreeMemory(device, retiredDepthImageDeviceMemory, nullptr);
+		if (retiredColorImage != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, retiredColorImageView, nullptr);
+			vkDestroyImage(device, retiredColorImage, nullptr);
+			vkFreeMemory(device, retiredColorImageDeviceMemory, nullptr);
+		}
+		if (retiredSceneImage != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, retiredSceneImageView, nullptr);
+			vkDestroyImage(device, retiredSceneImage, nullptr);
+			vkFreeMemory(device, retiredSceneImageDeviceMemory, nullptr);
+		}
+		for (VkImageView imageView : retiredImageViews)
+		{
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+		vkDestroySwapchainKHR(device, retiredSwapchain, nullptr);
+	});
+	swapchainFramebuffers.clear();
+	swapchainImageViews.clear();
+	colorImage = VK_NULL_HANDLE;
+	colorImageDeviceMemory = VK_NULL_HANDLE;
+	colorImageView = VK_NULL_HANDLE;
+	sceneImage = VK_NULL_HANDLE;
+	sceneImageDeviceMemory = VK_NULL_HANDLE;
+	sceneImageView = VK_NULL_HANDLE;
+}
+
+bool BkRenderer::recreateSwapchain()
+{
+	// a minimized window has a framebuffer size of 0, which a swapchain can't
+	// have; the events can't be waited for here since this may not be the
+	// window's thread, so the caller tries again later
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+	if (surfaceCapabilities.currentExtent.width == 0 || surfaceCapabilities.currentExtent.height == 0 || framebufferWidth == 0 || framebufferHeight == 0)
+	{
+		return false;
+	}
+
+	// hand the swapchain resources to the deletion queue instead of waiting
+	// for the device to be idle
+	VkSwapchainKHR oldSwapchain = swapchain;
+	retireSwapchain();
 
 	// recreate swapchain
-	std::optional<uint32_t> graphicsQueueFamilyIndex;
-	std::optional<uint32_t> presentQueueFamilyIndex;
-	findQueueFamiliesIndex(graphicsQueueFamilyIndex, presentQueueFamilyIndex);
-	createSwapchainAndImageViews(graphicsQueueFamilyIndex, presentQueueFamilyIndex);
+	createSwapchainAndImageViews(oldSwapchain);
 	VkFormat depthFormat;
 	createDepthResources(depthFormat);
+	createColorResources();
 	createSwapchainFramebuffer();
+
+	// the frames in flight may still read the old depth pyramid
+	if (occlusionCuller)
+	{
+		occlusionCuller->resize(depthImageView, renderTargetExtent.width, renderTargetExtent.height, deletionQueue, frameNumber);
+	}
+	return true;
 }
 
 void BkRenderer::beginSingleTimeCommands(VkCommandBuffer& commandBuffer)
@@ -165,7 +641,7 @@ void BkRenderer::endSingleTimeCommands(VkCommandBuffer commandBuffer)
 	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void BkRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkImage& image, VkDeviceMemory& imageDeviceMemory)
+void BkRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkImage& image, VkDeviceMemory& imageDeviceMemory, VkSampleCountFlagBits samples)
 {
 	// create image
 	VkImageCreateInfo imageCreateInfo{};
@@ -180,7 +656,7 @@ void BkRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, V
 	imageCreateInfo.tiling = imageTiling;
 	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	imageCreateInfo.usage = imageUsageFlags;
-	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.samples = samples;
 	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	if (vkCreateImage(device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create image!");
@@ -204,6 +680,22 @@ void BkRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, V
 			break;
 		}
 	}
+
+	// desktop GPUs have no lazily allocated memory, transient attachments
+	// get regular memory there
+	if (!bFoundMemoryType && (memoryPropertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+	{
+		VkMemoryPropertyFlags fallbackMemoryPropertyFlags = memoryPropertyFlags & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+		{
+			if ((memoryRequirements.memoryTypeBits & (1 << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & fallbackMemoryPropertyFlags) == fallbackMemoryPropertyFlags)
+			{
+				memoryTypeIndex = i;
+				bFoundMemoryType = true;
+				break;
+			}
+		}
+	}
 	if (!bFoundMemoryType)
 	{
 		throw std::runtime_error("ERROR: failed to find suitable memory type for vertex buffer!");
@@ -326,6 +818,7 @@ void BkRenderer::createBuffer(VkDeviceSize deviceSize, VkBufferUsageFlags buffer
 			break;
 		}
 	}
+
 	if (!bFoundMemoryType)
 	{
 		throw std::runtime_error("ERROR: failed to find suitable memory type for vertex buffer!");
@@ -364,16 +857,8 @@ void BkRenderer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize
 	endSingleTimeCommands(commandBuffer);
 }
 
-BkRenderer::BkRenderer()
+VkPipeline BkRenderer::createGraphicsPipeline(const std::vector<char>& vertShaderBytecode, const std::vector<char>& fragShaderBytecode, uint32_t shaderFeatures)
 {
-	// create depth resources
-	VkFormat depthFormat;
-	createDepthResources(depthFormat);
-
-	// load the bytecode of the two shaders
-	std::vector<char> vertShaderBytecode = readFile("shaders/vert.spv");
-	std::vector<char> fragShaderBytecode = readFile("shaders/frag.spv");
-
 	// create shader modules
 	VkShaderModuleCreateInfo vertShaderModuleCreateInfo{};
 	vertShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -392,149 +877,56 @@ BkRenderer::BkRenderer()
 	VkShaderModule fragShaderModule;
 	if (vkCreateShaderModule(device, &fragShaderModuleCreateInfo, nullptr, &fragShaderModule) != VK_SUCCESS)
 	{
+		vkDestroyShaderModule(device, vertShaderModule, nullptr);
 		throw std::runtime_error("ERROR: 'vkCreateShaderModule' failed to create the fragment shader module");
 	}
 
-	// create depth attachment description
-	VkAttachmentDescription depthAttachmentDescription{};
-	depthAttachmentDescription.format = depthFormat;
-	depthAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// assign shader modules to a specific pipeline stage, the specialization
+	// constants select the variant
+	BkShaderVariant shaderVariant(shaderFeatures);
+	VkPipelineShaderStageCreateInfo vertPipelineShaderStageCreateInfo{};
+	vertPipelineShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertPipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertPipelineShaderStageCreateInfo.module = vertShaderModule;
+	vertPipelineShaderStageCreateInfo.pName = "main";
+	vertPipelineShaderStageCreateInfo.pSpecializationInfo = shaderVariant.getSpecializationInfo();
 
-	// create depth attachment reference
-	VkAttachmentReference depthAttachmentReference{};
-	depthAttachmentReference.attachment = 1;
-	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	VkPipelineShaderStageCreateInfo fragPipelineShaderStageCreateInfo{};
+	fragPipelineShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragPipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragPipelineShaderStageCreateInfo.module = fragShaderModule;
+	fragPipelineShaderStageCreateInfo.pName = "main";
+	fragPipelineShaderStageCreateInfo.pSpecializationInfo = shaderVariant.getSpecializationInfo();
 
-	// create color attachment description
-	VkAttachmentDescription colorAttachmentDescription{};
-	colorAttachmentDescription.format = swapchainImageFormat;
-	colorAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+	VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[] = { vertPipelineShaderStageCreateInfo, fragPipelineShaderStageCreateInfo };
 
-	// clear framebuffer before drawing and store drawing data
-	colorAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	// create dynamic states for viewport resizing in the pipeline (making 
+	// the viewport and scissor rect dynamic does NOT effect performance)
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo{};
+	pipelineDynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	pipelineDynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	pipelineDynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
 
-	// set to don't care because the program doesn't use the stencil buffer
-	colorAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// create vertex input state to describe the vertex data format
+	VkVertexInputBindingDescription vertexInputBindingDescription = Vertex::getVertexInputBindingDescription();
+	auto vertexInputAttributeDescription = Vertex::getVertexInputAttributeDescriptions();
 
-	// set final layout to present src KHR so imags can be presented in
-	// the swapchain
-	colorAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{};
+	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &vertexInputBindingDescription; // optional
+	pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributeDescription.size());
+	pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexInputAttributeDescription.data(); // optional
 
-	// create color attachment reference
-	VkAttachmentReference colorAttachmentReference{};
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// create subpass description
-	VkSubpassDescription subpassDescription{};
-	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassDescription.colorAttachmentCount = 1;
-	subpassDescription.pColorAttachments = &colorAttachmentReference;
-	subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
-
-	// create subpass dependency to specify what operations should wait to
-	// be performed
-	VkSubpassDependency subpassDependency{};
-	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependency.dstSubpass = 0;
-	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	subpassDependency.srcAccessMask = 0;
-	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	// create render pass
-	std::array<VkAttachmentDescription, 2> attachmentDescriptions = { colorAttachmentDescription, depthAttachmentDescription };
-	VkRenderPassCreateInfo renderPassCreateInfo{};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
-	renderPassCreateInfo.pAttachments = attachmentDescriptions.data();
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpassDescription;
-	renderPassCreateInfo.dependencyCount = 1;
-	renderPassCreateInfo.pDependencies = &subpassDependency;
-	if (vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: 'vkCreateRenderPass' failed to create a render pass!");
-	}
-
-	// create a descriptor set layout binding for the UBO uniform
-	VkDescriptorSetLayoutBinding uboDescriptorSetLayoutBinding{};
-	uboDescriptorSetLayoutBinding.binding = 0;
-	uboDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboDescriptorSetLayoutBinding.descriptorCount = 1;
-	uboDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboDescriptorSetLayoutBinding.pImmutableSamplers = nullptr; // optional
-
-	// create a descriptor set layout binding for the sampler uniform
-	VkDescriptorSetLayoutBinding samplerDescriptorSetLayoutBinding{};
-	samplerDescriptorSetLayoutBinding.binding = 1;
-	samplerDescriptorSetLayoutBinding.descriptorCount = 1;
-	samplerDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
-	samplerDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	// create a descriptor set layout
-	std::array<VkDescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings = { uboDescriptorSetLayoutBinding, samplerDescriptorSetLayoutBinding };
-	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
-	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(descriptorSetLayoutBindings.size());
-	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
-	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: 'vkCreateDescriptorSetLayout' failed to create descriptor set layout!");
-	}
-
-	// assign shader modules to a specific pipeline stage
-	VkPipelineShaderStageCreateInfo vertPipelineShaderStageCreateInfo{};
-	vertPipelineShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertPipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertPipelineShaderStageCreateInfo.module = vertShaderModule;
-	vertPipelineShaderStageCreateInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragPipelineShaderStageCreateInfo{};
-	fragPipelineShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragPipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragPipelineShaderStageCreateInfo.module = fragShaderModule;
-	fragPipelineShaderStageCreateInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[] = { vertPipelineShaderStageCreateInfo, fragPipelineShaderStageCreateInfo };
-
-	// create dynamic states for viewport resizing in the pipeline (making 
-	// the viewport and scissor rect dynamic does NOT effect performance)
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
-	VkPipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo{};
-	pipelineDynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	pipelineDynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-	pipelineDynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
-
-	// create vertex input state to describe the vertex data format
-	VkVertexInputBindingDescription vertexInputBindingDescription = Vertex::getVertexInputBindingDescription();
-	auto vertexInputAttributeDescription = Vertex::getVertexInputAttributeDescriptions();
-
-	VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{};
-	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &vertexInputBindingDescription; // optional
-	pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributeDescription.size());
-	pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexInputAttributeDescription.data(); // optional
-
-	// create input assembly state to describe the type of geometry being drawn
-	// (points, lines, triangles)
-	VkPipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo{};
-	pipelineInputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	pipelineInputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	// create input assembly state to describe the type of geometry being drawn
+	// (points, lines, triangles)
+	VkPipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo{};
+	pipelineInputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	pipelineInputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
 	// setting to VK_TRUE allows you to break up lines and triangles in *_STRIP
 	pipelineInputAssemblyStateCreateInfo.primitiveRestartEnable = VK_FALSE;
@@ -569,11 +961,12 @@ BkRenderer::BkRenderer()
 	pipelineRasterizationStateCreateInfo.depthBiasClamp = 0.0f; // optional
 	pipelineRasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f; // optional
 
-	// configure multisampling used in anti-aliasing (disabled for now)
+	// configure multisampling used in anti-aliasing, the samples of the
+	// attachments (no sample shading, the edges are what gets smoothed)
 	VkPipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo{};
 	pipelineMultisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	pipelineMultisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;
-	pipelineMultisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	pipelineMultisampleStateCreateInfo.rasterizationSamples = msaaSamples;
 	pipelineMultisampleStateCreateInfo.minSampleShading = 1.0f; // optional
 	pipelineMultisampleStateCreateInfo.pSampleMask = nullptr; // optional
 	pipelineMultisampleStateCreateInfo.alphaToCoverageEnable = VK_FALSE; // optional
@@ -607,22 +1000,6 @@ BkRenderer::BkRenderer()
 	pipelineColorBlendStateCreateInfo.blendConstants[2] = 0.0f; // optional
 	pipelineColorBlendStateCreateInfo.blendConstants[3] = 0.0f;
 
-	// create a pipeline layout to specify uniform (global) variables in shaders
-	// that can be changed at draw time (disabled for now)
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-	// specify the descriptor set layout for uniform buffer
-	pipelineLayoutCreateInfo.setLayoutCount = 1;
-	pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0; // optional
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr; // optional
-
-	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: 'vkCreatePipelineLayout' failed to create a pipeline layout!");
-	}
-
 	// create a depth and stencil state
 	VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo{};
 	depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -656,15 +1033,142 @@ BkRenderer::BkRenderer()
 	graphicsPipelineCreateInfo.basePipelineIndex = -1; // optional
 
 	// this call can create multiple pipelines and also reference a pipeline cache
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
-	{
-		throw std::runtime_error("ERROR: 'vkCreateGraphicsPipelines' failed to create a graphics pipeline!");
-	}
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache->get(), 1, &graphicsPipelineCreateInfo, nullptr, &pipeline);
 
 	// cleanup the vertex and fragment shader modules
 	vkDestroyShaderModule(device, fragShaderModule, nullptr);
 	vkDestroyShaderModule(device, vertShaderModule, nullptr);
 
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateGraphicsPipelines' failed to create a graphics pipeline!");
+	}
+
+	return pipeline;
+}
+
+BkRenderer::BkRenderer(const BkContext& context, bool bVsync)
+	: surface(context.getSurface()),
+	physicalDevice(context.getPhysicalDevice()),
+	device(context.getDevice()),
+	graphicsQueueFamilyIndex(context.getGraphicsQueueFamilyIndex()),
+	presentQueueFamilyIndex(context.getPresentQueueFamilyIndex()),
+	computeQueueFamilyIndex(context.getComputeQueueFamilyIndex()),
+	graphicsQueue(context.getGraphicsQueue()),
+	presentQueue(context.getPresentQueue()),
+	computeQueue(context.getComputeQueue()),
+	bVsync(bVsync)
+{
+	auto initStartTime = std::chrono::high_resolution_clock::now();
+	jobSystem = std::make_unique<BkJobSystem>();
+
+	int width, height;
+	glfwGetFramebufferSize(context.getWindow(), &width, &height);
+	framebufferWidth = static_cast<uint32_t>(width);
+	framebufferHeight = static_cast<uint32_t>(height);
+
+	// the swapchain images are blitted to with dynamic resolution, from the
+	// scene image in the same format
+	swapchainImageFormat = chooseSurfaceFormat().format;
+	bDynamicResolution = ENABLE_DYNAMIC_RESOLUTION && isDynamicResolutionSupported(swapchainImageFormat, swapchainImageFormat);
+	createSwapchainAndImageViews(VK_NULL_HANDLE);
+
+	// the depth image is sampled and the frame drawn in two passes with
+	// occlusion culling
+	bOcclusionCulling = ENABLE_MESHLET_CULLING && ENABLE_OCCLUSION_CULLING && BkOcclusionCuller::isSupported(physicalDevice);
+
+	// the most samples up to MSAA_SAMPLES the color and depth attachments
+	// support, the depth pyramid also samples the multisampled depth
+	VkPhysicalDeviceProperties msaaPhysicalDeviceProperties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &msaaPhysicalDeviceProperties);
+	VkSampleCountFlags supportedSampleCounts = msaaPhysicalDeviceProperties.limits.framebufferColorSampleCounts & msaaPhysicalDeviceProperties.limits.framebufferDepthSampleCounts;
+	if (bOcclusionCulling)
+	{
+		supportedSampleCounts &= msaaPhysicalDeviceProperties.limits.sampledImageDepthSampleCounts;
+	}
+	for (VkSampleCountFlagBits sampleCount : { VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT })
+	{
+		if (sampleCount <= MSAA_SAMPLES && (supportedSampleCounts & sampleCount))
+		{
+			msaaSamples = sampleCount;
+			break;
+		}
+	}
+
+	// create depth and multisampled color resources
+	VkFormat depthFormat;
+	createDepthResources(depthFormat);
+	createColorResources();
+
+	// the bindless shaders read the texture index from the material buffer
+	bBindless = ENABLE_BINDLESS && BkBindlessTable::isSupported(physicalDevice);
+
+	// a frame is one render pass, or two around the depth pyramid build
+	if (bOcclusionCulling)
+	{
+		renderPass = createRenderPass(depthFormat, true, false);
+		secondPhaseRenderPass = createRenderPass(depthFormat, false, true);
+	}
+	else
+	{
+		renderPass = createRenderPass(depthFormat, true, true);
+	}
+
+	// create a descriptor set layout binding for the UBO uniform
+	VkDescriptorSetLayoutBinding uboDescriptorSetLayoutBinding{};
+	uboDescriptorSetLayoutBinding.binding = 0;
+	uboDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uboDescriptorSetLayoutBinding.descriptorCount = 1;
+	uboDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	uboDescriptorSetLayoutBinding.pImmutableSamplers = nullptr; // optional
+
+	// create a descriptor set layout binding for the sampler uniform
+	VkDescriptorSetLayoutBinding samplerDescriptorSetLayoutBinding{};
+	samplerDescriptorSetLayoutBinding.binding = 1;
+	samplerDescriptorSetLayoutBinding.descriptorCount = 1;
+	samplerDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	samplerDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
+	samplerDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// create a descriptor set layout
+	std::array<VkDescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings = { uboDescriptorSetLayoutBinding, samplerDescriptorSetLayoutBinding };
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(descriptorSetLayoutBindings.size());
+	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
+	descriptorLayoutCache = std::make_unique<BkDescriptorLayoutCache>(device);
+	descriptorSetLayout = descriptorLayoutCache->getLayout(descriptorSetLayoutCreateInfo);
+
+	// create a pipeline layout to specify uniform (global) variables in shaders
+	// that can be changed at draw time (disabled for now)
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+	// specify the descriptor set layout for uniform buffer, the bindless
+	// textures and materials are set 1
+	std::vector<VkDescriptorSetLayout> pipelineDescriptorSetLayouts = { descriptorSetLayout };
+	if (bBindless)
+	{
+		bindlessTable = std::make_unique<BkBindlessTable>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+		pipelineDescriptorSetLayouts.push_back(bindlessTable->getDescriptorSetLayout());
+	}
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(pipelineDescriptorSetLayouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = pipelineDescriptorSetLayouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 0; // optional
+	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr; // optional
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreatePipelineLayout' failed to create a pipeline layout!");
+	}
+
+	// the paths are kept so the hot reload can rebuild the pipeline from the
+	// recompiled shaders
+	vertShaderPath = bBindless ? "shaders/vert_bindless.spv" : "shaders/vert.spv";
+	fragShaderPath = bBindless ? "shaders/frag_bindless.spv" : "shaders/frag.spv";
+	pipelineCache = std::make_unique<BkPipelineCache>(device);
+
 	// wrap all of the VkImageViews into a frame buffer
 	createSwapchainFramebuffer();
 	
@@ -674,7 +1178,7 @@ BkRenderer::BkRenderer()
 
 	// set flag to 'reset command buffer' as we want to rerecord over it every frame
 	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	commandPoolCreateInfo.queueFamilyIndex = graphicsQueueFamilyIndex.value();
+	commandPoolCreateInfo.queueFamilyIndex = graphicsQueueFamilyIndex;
 	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
 	{
 		throw std::runtime_error("ERROR: 'vkCreateCommandPool' failed to create a command pool!");
@@ -699,69 +1203,16 @@ BkRenderer::BkRenderer()
 			throw std::runtime_error("ERROR: 'vkAllocateCommandBuffers' failed to allocate command buffers!");
 		}
 	}
-
-	// create texture image
-	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	VkDeviceSize texDeviceSize = texWidth * texHeight * 4;
-	if (!pixels)
+	upscaleCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, upscaleCommandBuffers.data()) != VK_SUCCESS)
 	{
-		throw std::runtime_error("ERROR: failed to load texture image!");
+		throw std::runtime_error("ERROR: 'vkAllocateCommandBuffers' failed to allocate upscale command buffers!");
 	}
 
-	// create staging buffer for texture and copy image data into it
-	VkBuffer texStagingBuffer;
-	VkDeviceMemory texStagingBufferDeviceMemory;
-	createBuffer(texDeviceSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, texStagingBuffer, texStagingBufferDeviceMemory);
-	void* texData;
-	vkMapMemory(device, texStagingBufferDeviceMemory, 0, texDeviceSize, 0, &texData);
-	memcpy(texData, pixels, static_cast<size_t>(texDeviceSize));
-	vkUnmapMemory(device, texStagingBufferDeviceMemory);
-	
-	// cleanup original pixel array
-	stbi_image_free(pixels);
-
-	// create image object
-	createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageDeviceMemory);
-
-	// transition image layout to something the GPU can read better
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-	// create a single time command buffer to copy the image
-	VkCommandBuffer copyImgCommandBuffer;
-	beginSingleTimeCommands(copyImgCommandBuffer);
-
-	// copy that buffer to an image
-	VkBufferImageCopy bufferImageCopy{};
-	bufferImageCopy.bufferOffset = 0;
-	bufferImageCopy.bufferRowLength = 0;
-	bufferImageCopy.bufferImageHeight = 0;
-	bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	bufferImageCopy.imageSubresource.mipLevel = 0;
-	bufferImageCopy.imageSubresource.baseArrayLayer = 0;
-	bufferImageCopy.imageSubresource.layerCount = 1;
-	bufferImageCopy.imageOffset = { 0, 0, 0 };
-	bufferImageCopy.imageExtent = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 };
-	vkCmdCopyBufferToImage(copyImgCommandBuffer, texStagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
-
-	// close the single time command buffer
-	endSingleTimeCommands(copyImgCommandBuffer);
-
-	// transition image layout back to something the shaders can read better
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-	// cleanup staging buffer resources
-	vkDestroyBuffer(device, texStagingBuffer, nullptr);
-	vkFreeMemory(device, texStagingBufferDeviceMemory, nullptr);
-
-	// TODO: all of the helper functions that submit commands so far are set up
-	// to execute synchronously by waiting for the queue to become idle. For 
-	// real applications, it would be better to combine these operations in a 
-	// single commadn buffer and execut them asynchronously for higher
-	// performance especially (create Texture Image).
-
-	// access texture image through an image view 
-	createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView);
+	// start decoding the texture on the streamer's worker threads, the
+	// placeholder is bound until the upload has finished
+	textureStreamer = std::make_unique<BkTextureStreamer>(device, physicalDevice, graphicsQueue, graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, TEXTURE_STREAMING_BUDGET);
+	texture = textureStreamer->requestTexture(TEXTURE_PATH);
 
 	// create a texture sampler to deal with under/over sampling
 	VkSamplerCreateInfo samplerCreateInfo{};
@@ -771,13 +1222,16 @@ BkRenderer::BkRenderer()
 	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerCreateInfo.anisotropyEnable = VK_TRUE;
 
 	// set the maximum amount of anisotropy samples allowed to the physical
-	// device specifications
+	// device specifications (anisotropic filtering is optional, e.g. on
+	// software rasterizers)
+	VkPhysicalDeviceFeatures samplerPhysicalDeviceFeatures{};
+	vkGetPhysicalDeviceFeatures(physicalDevice, &samplerPhysicalDeviceFeatures);
 	VkPhysicalDeviceProperties physicalDeviceProperties{};
 	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-	samplerCreateInfo.maxAnisotropy = physicalDeviceProperties.limits.maxSamplerAnisotropy;
+	samplerCreateInfo.anisotropyEnable = samplerPhysicalDeviceFeatures.samplerAnisotropy;
+	samplerCreateInfo.maxAnisotropy = samplerPhysicalDeviceFeatures.samplerAnisotropy ? physicalDeviceProperties.limits.maxSamplerAnisotropy : 1.0f;
 
 	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
@@ -786,179 +1240,259 @@ BkRenderer::BkRenderer()
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerCreateInfo.mipLodBias = 0.0f;
 	samplerCreateInfo.minLod = 0.0f;
-	samplerCreateInfo.maxLod = 0.0f;
+
+	// the streamed images only contain the resident mip levels
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
 	if (vkCreateSampler(device, &samplerCreateInfo, nullptr, &textureSampler) != VK_SUCCESS)
 	{
 		throw std::runtime_error("'vkCreateSampler' failed to create texture sampler!");
 	}
 
+	// the texture handle doubles as its slot in the bindless texture array
+	if (bBindless)
+	{
+		if (texture >= bindlessTable->getMaxTextureCount())
+		{
+			throw std::runtime_error("ERROR: texture doesn't fit into the bindless texture array!");
+		}
+		BkMaterial bkMaterial{};
+		bkMaterial.baseColorTexture = texture;
+		material = bindlessTable->addMaterial(bkMaterial);
+	}
+
 	// TODO: real world applications dont call vkAllocateMemory for every 
 	// individual buffer, instead create a custom allocator that splits up a 
 	// single allocation among many different objects by using the 'offset'
 	// parameter. vkAllocateMemory is called in createBuffer
 
-	// load model data
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
+	// the shader files are read and the pipelines compiled while the model is
+	// parsed and uploaded, the texture is already decoding on the streamer's
+	// threads; the tasks only share the device and the pipeline cache, which
+	// are internally synchronized, and only the upload task uses the queue
+	BkTaskGraph initTaskGraph;
+	std::vector<char> vertShaderBytecode;
+	std::vector<char> fragShaderBytecode;
+	uint32_t readVertShaderTask = initTaskGraph.addTask("read vertex shader", [this, &vertShaderBytecode]()
+	{
+		vertShaderBytecode = readFile(vertShaderPath);
+	});
+	uint32_t readFragShaderTask = initTaskGraph.addTask("read fragment shader", [this, &fragShaderBytecode]()
 	{
-		throw std::runtime_error(warn + err);
+		fragShaderBytecode = readFile(fragShaderPath);
+	});
+
+	// create the variants drawn with from the start, the untextured one is
+	// used until the texture is resident
+	std::array<uint32_t, 2> initialShaderFeatures = { SHADER_FEATURE_TEXTURED, SHADER_FEATURE_VERTEX_COLOR };
+	std::array<VkPipeline, 2> initialGraphicsPipelines{};
+	for (size_t i = 0; i < initialShaderFeatures.size(); i++)
+	{
+		initTaskGraph.addTask("create pipeline " + std::to_string(initialShaderFeatures[i]), [this, &vertShaderBytecode, &fragShaderBytecode, &initialShaderFeatures, &initialGraphicsPipelines, i]()
+		{
+			initialGraphicsPipelines[i] = createGraphicsPipeline(vertShaderBytecode, fragShaderBytecode, initialShaderFeatures[i]);
+		}, { readVertShaderTask, readFragShaderTask });
 	}
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			Vertex vertex{};
+	uint32_t loadModelTask = initTaskGraph.addTask("load model", [this]()
+	{
+		// load model data
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
 
-			vertex.pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
+		{
+			throw std::runtime_error(warn + err);
+		}
 
-			vertex.texCoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		for (const auto& shape : shapes) {
+			for (const auto& index : shape.mesh.indices) {
+				Vertex vertex{};
 
-			vertex.color = { 1.0f, 1.0f, 1.0f };
+				vertex.pos = {
+					attrib.vertices[3 * index.vertex_index + 0],
+					attrib.vertices[3 * index.vertex_index + 1],
+					attrib.vertices[3 * index.vertex_index + 2]
+				};
 
-			if (uniqueVertices.count(vertex) == 0)
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
+				vertex.texCoord = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+				};
 
-			indices.push_back(uniqueVertices[vertex]);
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+
+				if (uniqueVertices.count(vertex) == 0)
+				{
+					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+					vertices.push_back(vertex);
+				}
+
+				indices.push_back(uniqueVertices[vertex]);
+			}
 		}
-	}
+	});
 
-	// create a host-visible staging buffer as a temporary buffer for mapping
-	// and copying the vertex data; buffer will be used as src in a memory 
-	// transfer operation
-	VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-	VkBuffer vertStagingBuffer;
-	VkDeviceMemory vertStagingBufferDeviceMemory;
-	createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertStagingBuffer, vertStagingBufferDeviceMemory);
-
-	// copy the vertex data to the staging buffer
-	void* vertData;
-	vkMapMemory(device, vertStagingBufferDeviceMemory, 0, vertexBufferSize, 0, &vertData);
-	memcpy(vertData, vertices.data(), (size_t)vertexBufferSize);
-	vkUnmapMemory(device, vertStagingBufferDeviceMemory);
-
-	// create a vertex buffer; buffer can be used as destination in a memory
-	// transfer operation
-	createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferDeviceMemory);
-
-	// create a command buffer to copy staging buffer(src) into vertex buffer (dst)
-	copyBuffer(vertStagingBuffer, vertexBuffer, vertexBufferSize);
-
-	// cleanup resources
-	vkDestroyBuffer(device, vertStagingBuffer, nullptr);
-	vkFreeMemory(device, vertStagingBufferDeviceMemory, nullptr);
-
-	// staging buffer as a temporary buffer for mapping/copying the index data
-	VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
-	VkBuffer indexStagingBuffer;
-	VkDeviceMemory indexStagingBufferDeviceMemory;
-	createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexStagingBuffer, indexStagingBufferDeviceMemory);
-
-	// copy the index data to the staging buffer
-	void* indexData;
-	vkMapMemory(device, indexStagingBufferDeviceMemory, 0, indexBufferSize, 0, &indexData);
-	memcpy(indexData, indices.data(), (size_t)indexBufferSize);
-	vkUnmapMemory(device, indexStagingBufferDeviceMemory);
-
-	// create an index buffer
-	createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferDeviceMemory);
-
-	// create a command buffer to copy staging buffer(src) into index buffer (dst)
-	copyBuffer(indexStagingBuffer, indexBuffer, indexBufferSize);
-
-	// cleanup resources
-	vkDestroyBuffer(device, indexStagingBuffer, nullptr);
-	vkFreeMemory(device, indexStagingBufferDeviceMemory, nullptr);
-
-	// create a uniform buffer for every frame that is in flight to avoid
-	// updating a buffer while its being read
-	VkDeviceSize uniformBufferSize = sizeof(UniformBufferObject);
-
-	uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	uniformBuffersDeviceMemory.resize(MAX_FRAMES_IN_FLIGHT);
-	uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	uint32_t processMeshTask = initTaskGraph.addTask("process mesh", [this]()
 	{
-		createBuffer(uniformBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersDeviceMemory[i]);
-		vkMapMemory(device, uniformBuffersDeviceMemory[i], 0, uniformBufferSize, 0, &uniformBuffersMapped[i]);
-	}
+		// the indices come out in file order; reorder the triangles for the
+		// post-transform vertex cache and overdraw, then reorder the vertices for
+		// vertex fetch locality
+		if (ENABLE_MESH_OPTIMIZATION)
+		{
+			BkVertexCacheStats beforeStats = analyzeVertexCache(indices, vertices.size());
+			optimizeVertexCache(indices, vertices.size());
+			optimizeOverdraw(indices, vertices);
+			optimizeVertexFetch(vertices, indices);
+			BkVertexCacheStats afterStats = analyzeVertexCache(indices, vertices.size());
+
+			std::cout << "mesh optimization: ACMR " << beforeStats.acmr << " -> " << afterStats.acmr
+				<< ", ATVR " << beforeStats.atvr << " -> " << afterStats.atvr << std::endl;
+		}
+
+		// append the simplified levels of detail to the index buffer, they all
+		// share the vertex buffer
+		meshBounds = computeBoundingSphere(vertices);
+		if (ENABLE_MESH_LODS)
+		{
+			generateMeshLods(vertices, indices, meshLods);
+		}
+		else
+		{
+			meshLods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+		}
+
+		// meshlets are contiguous ranges of the full detail level, so they are
+		// drawn from the same index buffer
+		if (ENABLE_MESHLET_CULLING)
+		{
+			buildMeshlets(vertices, indices, meshLods[0].firstIndex, meshLods[0].indexCount, meshlets);
+		}
+	}, { loadModelTask });
 
-	// create descriptor pool to bind the buffer resource to the uniform buffer 
-	// descriptor
-	std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes{};
-	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorPoolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorPoolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	initTaskGraph.addTask("build mesh bvh", [this]()
+	{
+		std::vector<BkAabb> triangleBounds;
+		computeTriangleBounds(vertices, indices, meshLods[0].firstIndex, meshLods[0].indexCount, triangleBounds);
+		meshBvh.build(triangleBounds, jobSystem.get());
+	}, { processMeshTask });
 
-	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
-	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
-	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-	descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	initTaskGraph.addTask("upload mesh", [this]()
+	{
+		// create a host-visible staging buffer as a temporary buffer for mapping
+		// and copying the vertex data; buffer will be used as src in a memory 
+		// transfer operation
+		VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
+		VkBuffer vertStagingBuffer;
+		VkDeviceMemory vertStagingBufferDeviceMemory;
+		createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertStagingBuffer, vertStagingBufferDeviceMemory);
+
+		// copy the vertex data to the staging buffer
+		void* vertData;
+		vkMapMemory(device, vertStagingBufferDeviceMemory, 0, vertexBufferSize, 0, &vertData);
+		memcpy(vertData, vertices.data(), (size_t)vertexBufferSize);
+		vkUnmapMemory(device, vertStagingBufferDeviceMemory);
+
+		// create a vertex buffer; buffer can be used as destination in a memory
+		// transfer operation
+		createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferDeviceMemory);
+
+		// create a command buffer to copy staging buffer(src) into vertex buffer (dst)
+		copyBuffer(vertStagingBuffer, vertexBuffer, vertexBufferSize);
+
+		// cleanup resources
+		vkDestroyBuffer(device, vertStagingBuffer, nullptr);
+		vkFreeMemory(device, vertStagingBufferDeviceMemory, nullptr);
+
+		// pack the indices to 16 bit if the mesh has few enough vertices, the
+		// index type is used again when binding the index buffer
+		BkPackedIndices packedIndices;
+		packIndices(indices, vertices.size(), packedIndices);
+		indexType = packedIndices.indexType;
+
+		// staging buffer as a temporary buffer for mapping/copying the index data
+		VkDeviceSize indexBufferSize = packedIndices.data.size();
+		VkBuffer indexStagingBuffer;
+		VkDeviceMemory indexStagingBufferDeviceMemory;
+		createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexStagingBuffer, indexStagingBufferDeviceMemory);
+
+		// copy the index data to the staging buffer
+		void* indexData;
+		vkMapMemory(device, indexStagingBufferDeviceMemory, 0, indexBufferSize, 0, &indexData);
+		memcpy(indexData, packedIndices.data.data(), (size_t)indexBufferSize);
+		vkUnmapMemory(device, indexStagingBufferDeviceMemory);
+
+		// create an index buffer
+		createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferDeviceMemory);
+
+		// create a command buffer to copy staging buffer(src) into index buffer (dst)
+		copyBuffer(indexStagingBuffer, indexBuffer, indexBufferSize);
+
+		// cleanup resources
+		vkDestroyBuffer(device, indexStagingBuffer, nullptr);
+		vkFreeMemory(device, indexStagingBufferDeviceMemory, nullptr);
+	}, { processMeshTask });
+
+	// without the job system the tasks run one after another on this thread,
+	// to compare the startup time
+	initTaskGraph.run(ENABLE_PARALLEL_INIT ? jobSystem.get() : nullptr);
+	for (size_t i = 0; i < initialShaderFeatures.size(); i++)
 	{
-		throw std::runtime_error("ERROR: 'vkCreateDescriptorPool' failed to create a descriptor pool!");
+		graphicsPipelines[initialShaderFeatures[i]] = initialGraphicsPipelines[i];
 	}
-
-	// create a descriptor set
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
-	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptorSetAllocateInfo.descriptorPool = descriptorPool;
-	descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
-	
-	descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-	if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, descriptorSets.data()) != VK_SUCCESS)
+	if (ENABLE_INIT_TIMING_OUTPUT)
 	{
-		throw std::runtime_error("ERROR: 'vkAllocateDescriptorSets' failed to allocate descriptor sets!");
+		for (uint32_t i = 0; i < initTaskGraph.getTaskCount(); i++)
+		{
+			std::cout << "init task '" << initTaskGraph.getTaskName(i) << "': " << initTaskGraph.getTaskDuration(i) << " ms" << std::endl;
+		}
 	}
 
-	// update descriptor sets info
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	// create the arena the uniform data of every frame is allocated from, each
+	// frame in flight has its own region to avoid updating data while its
+	// being read
+	frameArena = std::make_unique<BkFrameArena>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+
+	// the occlusion culling appends the draws on the GPU, the CPU culling
+	// only hands it the candidates
+	if (bOcclusionCulling && !meshlets.empty())
 	{
-		VkDescriptorBufferInfo descriptorBufferInfo{};
-		descriptorBufferInfo.buffer = uniformBuffers[i];
-		descriptorBufferInfo.offset = 0;
-		descriptorBufferInfo.range = sizeof(UniformBufferObject);
+		occlusionCuller = std::make_unique<BkOcclusionCuller>(device, physicalDevice, MAX_FRAMES_IN_FLIGHT, meshlets, depthImageView, renderTargetExtent.width, renderTargetExtent.height, msaaSamples);
+		meshletCullIndices.resize(meshlets.size());
+	}
 
-		VkDescriptorImageInfo descriptorImageInfo{};
-		descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		descriptorImageInfo.imageView = textureImageView;
-		descriptorImageInfo.sampler = textureSampler;
+	// create a host visible indirect draw buffer for every frame in flight
+	// that the CPU meshlet culling writes the visible meshlet draws into
+	if (!meshlets.empty() && !occlusionCuller)
+	{
+		VkDeviceSize indirectBufferSize = sizeof(VkDrawIndexedIndirectCommand) * meshlets.size();
 
-		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
-		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[0].dstSet = descriptorSets[i];
-		writeDescriptorSets[0].dstBinding = 0;
-		writeDescriptorSets[0].dstArrayElement = 0;
-		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSets[0].descriptorCount = 1;
-		writeDescriptorSets[0].pBufferInfo = &descriptorBufferInfo;
+		indirectBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		indirectBuffersDeviceMemory.resize(MAX_FRAMES_IN_FLIGHT);
+		indirectBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			createBuffer(indirectBufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indirectBuffers[i], indirectBuffersDeviceMemory[i]);
+			vkMapMemory(device, indirectBuffersDeviceMemory[i], 0, indirectBufferSize, 0, &indirectBuffersMapped[i]);
+		}
 
-		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[1].dstSet = descriptorSets[i];
-		writeDescriptorSets[1].dstBinding = 1;
-		writeDescriptorSets[1].dstArrayElement = 0;
-		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writeDescriptorSets[1].descriptorCount = 1;
-		writeDescriptorSets[1].pImageInfo = &descriptorImageInfo;
+		// without multiDrawIndirect every indirect draw has to be issued separately
+		VkPhysicalDeviceFeatures physicalDeviceFeatures{};
+		vkGetPhysicalDeviceFeatures(physicalDevice, &physicalDeviceFeatures);
+		bMultiDrawIndirect = physicalDeviceFeatures.multiDrawIndirect == VK_TRUE;
+	}
 
-		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	// create a descriptor allocator for every frame in flight, the frame's
+	// sets are allocated again every frame once its fence has been waited on
+	std::vector<BkDescriptorPoolRatio> descriptorPoolRatios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f }
+	};
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		frameDescriptorAllocators.push_back(std::make_unique<BkDescriptorAllocator>(device, descriptorPoolRatios));
 	}
 
 	// create a semaphore (GPU synchronization object) for each frame in flight
@@ -993,175 +1527,787 @@ BkRenderer::BkRenderer()
 			throw std::runtime_error("ERROR: 'vkCreateFence' failed to create 'inFlightFences'!");
 		}
 	}
+
+	// create a timeline semaphore that counts the completed frames, it
+	// replaces the fences when supported
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+	physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	physicalDeviceFeatures2.pNext = &physicalDeviceVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
+	bTimelineSemaphore = ENABLE_TIMELINE_SEMAPHORE && physicalDeviceVulkan12Features.timelineSemaphore == VK_TRUE;
+	if (bTimelineSemaphore)
+	{
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeCreateInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo timelineSemaphoreCreateInfo{};
+		timelineSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		timelineSemaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+		if (vkCreateSemaphore(device, &timelineSemaphoreCreateInfo, nullptr, &frameTimelineSemaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkCreateSemaphore' failed to create 'frameTimelineSemaphore'!");
+		}
+
+		// compute work is synchronized with timeline semaphores as well
+		if (ENABLE_ASYNC_COMPUTE)
+		{
+			asyncCompute = std::make_unique<BkAsyncCompute>(device, computeQueue, computeQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT);
+		}
+	}
+
+	// a begin and end timestamp per frame in flight measure the GPU frame
+	// time, for the frame timings and the dynamic resolution to scale with
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamiliesProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamiliesProperties.data());
+	timestampValidBits = queueFamiliesProperties[graphicsQueueFamilyIndex].timestampValidBits;
+	if (timestampValidBits > 0)
+	{
+		VkQueryPoolCreateInfo queryPoolCreateInfo{};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+		if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("ERROR: 'vkCreateQueryPool' failed to create a timestamp query pool!");
+		}
+
+		VkPhysicalDeviceProperties timestampPhysicalDeviceProperties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &timestampPhysicalDeviceProperties);
+		timestampPeriod = timestampPhysicalDeviceProperties.limits.timestampPeriod;
+	}
+
+	if (bDynamicResolution)
+	{
+		// upscale with linear filtering where the format supports it
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, swapchainImageFormat, &formatProperties);
+		if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+		{
+			upscaleFilter = VK_FILTER_LINEAR;
+		}
+		dynamicResolution = std::make_unique<BkDynamicResolution>(DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE, DYNAMIC_RESOLUTION_TARGET_FRAME_TIME);
+	}
+
+	// the sources of the shaders the pipeline was created from, mapped to
+	// the SPIR-V files the Shaders target builds
+	if (ENABLE_SHADER_HOT_RELOAD)
+	{
+		shaderHotReload = std::make_unique<BkShaderHotReload>();
+		shaderHotReload->watch(bBindless ? "shader_bindless.vert" : "shader.vert", vertShaderPath);
+		shaderHotReload->watch(bBindless ? "shader_bindless.frag" : "shader.frag", fragShaderPath);
+		shaderHotReload->start();
+	}
+
+	if (ENABLE_INIT_TIMING_OUTPUT)
+	{
+		auto initEndTime = std::chrono::high_resolution_clock::now();
+		std::cout << "renderer initialization: " << std::chrono::duration<double, std::milli>(initEndTime - initStartTime).count() << " ms" << std::endl;
+	}
 }
 
-void BkRenderer::render()
+bool BkRenderer::isFrameComplete(uint64_t frame)
 {
-	// viewport describes the region of the framebuffer that the output will render to
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(swapchainExtent.width);
-	viewport.height = static_cast<float>(swapchainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	return getCompletedFrameNumber() >= frame;
+}
 
-	// scissor rectangle acts like a clipping mask
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapchainExtent;
+BkAsyncCompute* BkRenderer::getAsyncCompute() const
+{
+	return asyncCompute.get();
+}
+
+const BkFrameTimings& BkRenderer::getFrameTimings() const
+{
+	return frameTimings;
+}
+
+bool BkRenderer::pickTriangle(const glm::vec3& origin, const glm::vec3& direction, uint32_t& triangle, float& distance) const
+{
+	// the BVH's triangles are numbered from the start of the full detail level
+	const uint32_t* levelIndices = indices.data() + meshLods[0].firstIndex;
+	distance = FLT_MAX;
+	triangle = meshBvh.intersectRay(origin, direction, distance, [this, levelIndices, &origin, &direction](uint32_t primitive, float& primitiveDistance)
+	{
+		return intersectRayTriangle(origin, direction, vertices[levelIndices[3 * primitive]].pos, vertices[levelIndices[3 * primitive + 1]].pos, vertices[levelIndices[3 * primitive + 2]].pos, primitiveDistance);
+	});
+	return triangle != BVH_NO_HIT;
+}
 
-	// main loop
-	uint32_t currentFrame = 0;
-	while (!glfwWindowShouldClose(window))
+VkPipeline BkRenderer::getGraphicsPipeline(uint32_t shaderFeatures)
+{
+	auto graphicsPipeline = graphicsPipelines.find(shaderFeatures);
+	if (graphicsPipeline != graphicsPipelines.end())
 	{
-		// determines if user wants to close the window
-		glfwPollEvents();
+		return graphicsPipeline->second;
+	}
 
-		// wait for fence to be signaled
-		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	VkPipeline pipeline = createGraphicsPipeline(readFile(vertShaderPath), readFile(fragShaderPath), shaderFeatures);
+	graphicsPipelines[shaderFeatures] = pipeline;
+	return pipeline;
+}
 
-		// aquire the image from the swapchain to render after the presentation is done with it
-		uint32_t imageIndex;
-		VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-		
-		// you cannot present an image if the swapchain is out of date 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+void BkRenderer::updateShaderHotReload()
+{
+	if (pendingGraphicsPipelines.valid())
+	{
+		if (pendingGraphicsPipelines.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return;
+		}
+
+		// a shader that compiles but doesn't match the pipeline layout keeps
+		// the old pipelines
+		std::unordered_map<uint32_t, VkPipeline> pipelines;
+		try
 		{
-			recreateSwapchain();
-			continue;
+			pipelines = pendingGraphicsPipelines.get();
 		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		catch (const std::exception& exception)
 		{
-			throw std::runtime_error("ERROR: 'vkAcquireNextImageKHR' failed to get swapchain image!");
+			std::cerr << exception.what() << std::endl;
+			return;
 		}
 
-		// TODO: a more efficient way to pass a small buffer of frequently 
-		// changing data to shaders are 'push constants' 
-
-		// update the uniform buffers
-		static auto startTime = std::chrono::high_resolution_clock::now();
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-		// z-axis rotation 90 deg/sec, a camera at 2,2,2 looking at origin, 
-		UniformBufferObject ubo{};
-		ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.proj = glm::perspective(glm::radians(45.0f), swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 10.0f);
-		
-		// invert y because in OpenGL the y coord in clip coords is inverted
-		// which will render image upside down if unchanged
-		ubo.proj[1][1] *= -1;
-		memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
-
-		// reset the fence only if we are submitting work to prevent deadlock on
-		// vkAcquireNextImageKHR returning VK_ERROR_OUT_OF_DATE_KHR
-		vkResetFences(device, 1, &inFlightFences[currentFrame]);
+		// the frames in flight still reference the old pipelines, variants
+		// created while the rebuild was running are retired as well and
+		// recreated on their next use
+		for (const auto& retiredPipeline : graphicsPipelines)
+		{
+			VkPipeline pipeline = retiredPipeline.second;
+			deletionQueue.push(frameNumber, [this, pipeline]()
+			{
+				vkDestroyPipeline(device, pipeline, nullptr);
+			});
+		}
+		graphicsPipelines = std::move(pipelines);
+	}
 
-		// reset the command buffer
-		vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+	std::vector<std::string> reloadedSpirvPaths = shaderHotReload->takeReloaded();
+	if (reloadedSpirvPaths.empty())
+	{
+		return;
+	}
 
-		// create a command buffer begin info to write the commands to execute into a command buffer
-		VkCommandBufferBeginInfo commandBufferBeginInfo{};
-		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		commandBufferBeginInfo.flags = 0; // optional
-		commandBufferBeginInfo.pInheritanceInfo = nullptr; // optional
-		if (vkBeginCommandBuffer(commandBuffers[currentFrame], &commandBufferBeginInfo) != VK_SUCCESS)
+	// the device, render pass, pipeline layout and pipeline cache don't
+	// change while the pipelines are being created, so the creation can run
+	// on another thread
+	std::vector<uint32_t> variants;
+	for (const auto& graphicsPipeline : graphicsPipelines)
+	{
+		variants.push_back(graphicsPipeline.first);
+	}
+	pendingGraphicsPipelines = std::async(std::launch::async, [this, variants]()
+	{
+		std::vector<char> vertShaderBytecode = readFile(vertShaderPath);
+		std::vector<char> fragShaderBytecode = readFile(fragShaderPath);
+		std::unordered_map<uint32_t, VkPipeline> pipelines;
+		try
 		{
-			throw std::runtime_error("ERROR: 'vkBeginCommandBuffer' failed to begin a command buffer!");
+			for (uint32_t shaderFeatures : variants)
+			{
+				pipelines[shaderFeatures] = createGraphicsPipeline(vertShaderBytecode, fragShaderBytecode, shaderFeatures);
+			}
+		}
+		catch (...)
+		{
+			for (const auto& pipeline : pipelines)
+			{
+				vkDestroyPipeline(device, pipeline.second, nullptr);
+			}
+			throw;
 		}
+		return pipelines;
+	});
+}
 
-		// create a render pass begin info to start the render pass to begin drawing
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		VkRenderPassBeginInfo renderPassBeginInfo{};
-		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassBeginInfo.renderPass = renderPass;
-		renderPassBeginInfo.framebuffer = swapchainFramebuffers[imageIndex];
-		renderPassBeginInfo.renderArea.offset = { 0, 0 };
-		renderPassBeginInfo.renderArea.extent = swapchainExtent;
-		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassBeginInfo.pClearValues = clearValues.data();
-		vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+uint64_t BkRenderer::getCompletedFrameNumber()
+{
+	if (bTimelineSemaphore)
+	{
+		uint64_t value;
+		vkGetSemaphoreCounterValue(device, frameTimelineSemaphore, &value);
+		return value;
+	}
 
-		// bind the graphics pipeline
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	// without the timeline only the frames whose fences have been waited on
+	// are known to be complete
+	uint64_t completedFrameNumber = frameNumber;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (vkGetFenceStatus(device, inFlightFences[i]) != VK_SUCCESS)
+		{
+			completedFrameNumber = std::min(completedFrameNumber, inFlightFrameNumbers[i] - 1);
+		}
+	}
+	return completedFrameNumber;
+}
+
+bool BkRenderer::beginFrame()
+{
+	// wait for the frame that last used this slot, on the timeline or its fence
+	uint64_t completedFrameNumber = inFlightFrameNumbers[currentFrame];
+	if (bTimelineSemaphore)
+	{
+		VkSemaphoreWaitInfo semaphoreWaitInfo{};
+		semaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		semaphoreWaitInfo.semaphoreCount = 1;
+		semaphoreWaitInfo.pSemaphores = &frameTimelineSemaphore;
+		semaphoreWaitInfo.pValues = &completedFrameNumber;
+		vkWaitSemaphores(device, &semaphoreWaitInfo, UINT64_MAX);
+
+		// later frames may have completed as well
+		completedFrameNumber = getCompletedFrameNumber();
+	}
+	else
+	{
+		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	}
+
+	// the frame that last used this slot and every frame before it have
+	// completed, destroy the objects they were the last users of
+	deletionQueue.collect(completedFrameNumber);
+
+	if (shaderHotReload)
+	{
+		updateShaderHotReload();
+	}
+
+	// the frame's arena region isn't read anymore after the fence wait
+	frameArena->beginFrame(currentFrame);
+
+	// submit finished texture decodes
+	textureStreamer->update();
+
+	// aquire the image from the swapchain to render after the presentation is done with it
+	VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 	
-		// set the viewport and scissor state in the command buffer since we set
-		// them to be dynamic in the pipeline
-		vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
+	// you cannot present an image if the swapchain is out of date 
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		recreateSwapchain();
+		return false;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+	{
+		throw std::runtime_error("ERROR: 'vkAcquireNextImageKHR' failed to get swapchain image!");
+	}
 
-		// bind the vertex buffers
-		VkBuffer vertexBuffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
+	bFrameBegun = true;
+	return true;
+}
+
+void BkRenderer::submit()
+{
+	if (!bFrameBegun || bFrameSubmitted)
+	{
+		throw std::runtime_error("ERROR: 'submit' called without a frame begun by 'beginFrame'!");
+	}
+
+	auto submitStartTime = std::chrono::high_resolution_clock::now();
+	VkImageView textureImageView = textureStreamer->getImageView(texture);
+	readFrameTimestamps();
+	updateRenderExtent();
+
+	// the sets of this frame aren't in use anymore after the fence wait, so
+	// its pools are reset in bulk and the sets allocated and written again
+	frameDescriptorAllocators[currentFrame]->reset();
+	VkDescriptorSet descriptorSet = frameDescriptorAllocators[currentFrame]->allocate(descriptorSetLayout);
+
+	VkDescriptorBufferInfo descriptorBufferInfo{};
+	descriptorBufferInfo.buffer = frameArena->getBuffer();
+	descriptorBufferInfo.offset = 0;
+	descriptorBufferInfo.range = sizeof(UniformBufferObject);
+
+	VkDescriptorImageInfo descriptorImageInfo{};
+	descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	descriptorImageInfo.imageView = textureImageView;
+	descriptorImageInfo.sampler = textureSampler;
+
+	std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+	writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorSets[0].dstSet = descriptorSet;
+	writeDescriptorSets[0].dstBinding = 0;
+	writeDescriptorSets[0].dstArrayElement = 0;
+	writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	writeDescriptorSets[0].descriptorCount = 1;
+	writeDescriptorSets[0].pBufferInfo = &descriptorBufferInfo;
+
+	writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorSets[1].dstSet = descriptorSet;
+	writeDescriptorSets[1].dstBinding = 1;
+	writeDescriptorSets[1].dstArrayElement = 0;
+	writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeDescriptorSets[1].descriptorCount = 1;
+	writeDescriptorSets[1].pImageInfo = &descriptorImageInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+	if (bBindless)
+	{
+		bindlessTable->setTexture(texture, textureImageView, textureSampler);
+		bindlessTable->flush(currentFrame);
+	}
 
-		// bind the index buffer
-		vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	// TODO: a more efficient way to pass a small buffer of frequently 
+	// changing data to shaders are 'push constants' 
 
-		// bind the correct descriptor set to access the uniform buffer object
-		vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+	// update the uniform buffers with the application's transforms
+	UniformBufferObject ubo{};
+	ubo.model = model;
+	ubo.view = view;
+	ubo.proj = glm::perspective(glm::radians(45.0f), swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 10.0f);
+	
+	// invert y because in OpenGL the y coord in clip coords is inverted
+	// which will render image upside down if unchanged
+	ubo.proj[1][1] *= -1;
+	uint32_t uboDynamicOffset;
+	*frameArena->allocate<UniformBufferObject>(uboDynamicOffset) = ubo;
+
+	// select the level of detail whose error projects to less than
+	// LOD_MAX_SCREEN_ERROR pixels at the mesh's view space distance, in the
+	// pixels actually rendered; the errors and bounds are in object space, so
+	// they are scaled by the largest axis scale of the model view matrix
+	glm::mat4 modelView = ubo.view * ubo.model;
+	float meshScale = std::max({ glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2])) });
+	glm::vec4 meshViewCenter = modelView * glm::vec4(meshBounds.center, 1.0f);
+	float meshViewDistance = glm::length(glm::vec3(meshViewCenter)) - meshBounds.radius * meshScale;
+	uint32_t meshLodIndex = selectMeshLod(meshLods, meshViewDistance, ubo.proj[1][1] * meshScale, static_cast<float>(renderExtent.height), LOD_MAX_SCREEN_ERROR);
+	const BkMeshLod& meshLod = meshLods[meshLodIndex];
+
+	// the texture is mapped over the mesh once, so it needs about as many
+	// texels as the mesh's projected diameter in pixels
+	float meshScreenSize = std::numeric_limits<float>::max();
+	if (meshViewDistance > 0.0f)
+	{
+		meshScreenSize = meshBounds.radius * meshScale * std::abs(ubo.proj[1][1]) * renderExtent.height / meshViewDistance;
+	}
+	textureStreamer->requestScreenSize(texture, meshScreenSize);
+
+	// at full detail cull the meshlets in object space against the frustum
+	// and their normal cones
+	bool bDrawMeshlets = meshLodIndex == 0 && !meshlets.empty();
+	bool bCullOcclusion = bDrawMeshlets && occlusionCuller;
+	uint32_t meshletDrawCount = 0;
+	if (bDrawMeshlets)
+	{
+		BkFrustum frustum = extractFrustum(ubo.proj * modelView);
+		glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+
+		// cull the batches in parallel, then append their draws in meshlet
+		// order so the result matches the serial culling
+		uint32_t meshletCount = static_cast<uint32_t>(meshlets.size());
+		uint32_t batchCount = (meshletCount + MESHLET_CULL_BATCH_SIZE - 1) / MESHLET_CULL_BATCH_SIZE;
+		meshletCullDraws.resize(meshletCount);
+		meshletCullDrawCounts.resize(batchCount);
+		jobSystem->parallelFor(batchCount, 1, [&](uint32_t firstBatch, uint32_t endBatch)
+		{
+			for (uint32_t batch = firstBatch; batch < endBatch; batch++)
+			{
+				uint32_t firstMeshlet = batch * MESHLET_CULL_BATCH_SIZE;
+				uint32_t batchMeshletCount = std::min(MESHLET_CULL_BATCH_SIZE, meshletCount - firstMeshlet);
+				if (bCullOcclusion)
+				{
+					meshletCullDrawCounts[batch] = cullMeshletIndices(meshlets.data() + firstMeshlet, batchMeshletCount, firstMeshlet, frustum, cameraPosition, meshletCullIndices.data() + firstMeshlet);
+				}
+				else
+				{
+					meshletCullDrawCounts[batch] = cullMeshlets(meshlets.data() + firstMeshlet, batchMeshletCount, frustum, cameraPosition, meshletCullDraws.data() + firstMeshlet, material);
+				}
+			}
+		});
 
-		// draw and end commands
-		vkCmdDrawIndexed(commandBuffers[currentFrame], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		// with occlusion culling the count is that of the candidates, the
+		// GPU appends the draws
+		if (bCullOcclusion)
+		{
+			uint32_t* candidates = occlusionCuller->getCandidates(currentFrame);
+			for (uint32_t batch = 0; batch < batchCount; batch++)
+			{
+				memcpy(candidates + meshletDrawCount, meshletCullIndices.data() + batch * MESHLET_CULL_BATCH_SIZE, meshletCullDrawCounts[batch] * sizeof(uint32_t));
+				meshletDrawCount += meshletCullDrawCounts[batch];
+			}
+		}
+		else
+		{
+			VkDrawIndexedIndirectCommand* drawCommands = static_cast<VkDrawIndexedIndirectCommand*>(indirectBuffersMapped[currentFrame]);
+			for (uint32_t batch = 0; batch < batchCount; batch++)
+			{
+				memcpy(drawCommands + meshletDrawCount, meshletCullDraws.data() + batch * MESHLET_CULL_BATCH_SIZE, meshletCullDrawCounts[batch] * sizeof(VkDrawIndexedIndirectCommand));
+				meshletDrawCount += meshletCullDrawCounts[batch];
+			}
+		}
+	}
+
+	// the frame's counters hold the results of the frame that last used
+	// this slot, which has completed
+	BkOcclusionStats occlusionStats;
+	if (occlusionCuller && OCCLUSION_STATS_INTERVAL > 0 && frameNumber % OCCLUSION_STATS_INTERVAL == 0 && occlusionCuller->getStats(currentFrame, occlusionStats))
+	{
+		std::cout << "occlusion culling: " << occlusionStats.candidateCount << " meshlets (" << occlusionStats.candidateTriangleCount << " triangles) in the frustum, drawn "
+			<< occlusionStats.drawCounts[0] << " + " << occlusionStats.drawCounts[1] << " meshlets ("
+			<< occlusionStats.triangleCounts[0] + occlusionStats.triangleCounts[1] << " triangles)" << std::endl;
+	}
+
+	// reset the fence only if we are submitting work to prevent deadlock on
+	// vkAcquireNextImageKHR returning VK_ERROR_OUT_OF_DATE_KHR
+	if (!bTimelineSemaphore)
+	{
+		vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	}
+
+	// reset the command buffer
+	vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+
+	// create a command buffer begin info to write the commands to execute into a command buffer
+	VkCommandBufferBeginInfo commandBufferBeginInfo{};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = 0; // optional
+	commandBufferBeginInfo.pInheritanceInfo = nullptr; // optional
+	if (vkBeginCommandBuffer(commandBuffers[currentFrame], &commandBufferBeginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkBeginCommandBuffer' failed to begin a command buffer!");
+	}
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffers[currentFrame], timestampQueryPool, 2 * currentFrame, 2);
+		vkCmdWriteTimestamp(commandBuffers[currentFrame], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrame);
+	}
+
+	// the first phase draws what the previous frame's depth doesn't hide
+	if (bCullOcclusion)
+	{
+		occlusionCuller->recordFirstPhase(commandBuffers[currentFrame], currentFrame, meshletDrawCount, modelView, ubo.proj, material);
+	}
+
+	// create a render pass begin info to start the render pass to begin drawing
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	VkRenderPassBeginInfo renderPassBeginInfo{};
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass = renderPass;
+	renderPassBeginInfo.framebuffer = swapchainFramebuffers[bDynamicResolution ? 0 : imageIndex];
+	renderPassBeginInfo.renderArea.offset = { 0, 0 };
+	renderPassBeginInfo.renderArea.extent = renderExtent;
+	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassBeginInfo.pClearValues = clearValues.data();
+	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	// bind the graphics pipeline
+	// draw with the vertex colors until the texture is resident instead of
+	// sampling the placeholder
+	uint32_t shaderFeatures = textureStreamer->isResident(texture) ? SHADER_FEATURE_TEXTURED : SHADER_FEATURE_VERTEX_COLOR;
+	vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, getGraphicsPipeline(shaderFeatures));
+
+	// set the viewport and scissor state in the command buffer since we set
+	// them to be dynamic in the pipeline, the extent changes with the swapchain
+	// and the dynamic resolution
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(renderExtent.width);
+	viewport.height = static_cast<float>(renderExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	// scissor rectangle acts like a clipping mask
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = renderExtent;
+	vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
+
+	// bind the vertex buffers
+	VkBuffer vertexBuffers[] = { vertexBuffer };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
+
+	// bind the index buffer
+	vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0, indexType);
+
+	// bind the correct descriptor set to access the uniform buffer object,
+	// the dynamic offset selects this frame's copy in the arena
+	vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &uboDynamicOffset);
+	if (bBindless)
+	{
+		VkDescriptorSet bindlessDescriptorSet = bindlessTable->getDescriptorSet(currentFrame);
+		vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &bindlessDescriptorSet, 0, nullptr);
+	}
+
+	// draw and end commands
+	if (bCullOcclusion)
+	{
+		occlusionCuller->recordDraws(commandBuffers[currentFrame], currentFrame, 0);
+	}
+	else if (bDrawMeshlets && bMultiDrawIndirect)
+	{
+		vkCmdDrawIndexedIndirect(commandBuffers[currentFrame], indirectBuffers[currentFrame], 0, meshletDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else if (bDrawMeshlets)
+	{
+		for (uint32_t i = 0; i < meshletDrawCount; i++)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffers[currentFrame], indirectBuffers[currentFrame], i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+	else
+	{
+		vkCmdDrawIndexed(commandBuffers[currentFrame], meshLod.indexCount, 1, meshLod.firstIndex, 0, material);
+	}
+	vkCmdEndRenderPass(commandBuffers[currentFrame]);
+
+	// build the depth pyramid from the first pass, then draw the meshlets
+	// it rejected that are visible in the new depth; the bound pipeline,
+	// buffers and sets carry over into the second pass
+	if (bOcclusionCulling)
+	{
+		if (occlusionCuller)
+		{
+			occlusionCuller->recordDepthPyramid(commandBuffers[currentFrame], renderExtent.width, renderExtent.height);
+		}
+		if (bCullOcclusion)
+		{
+			occlusionCuller->recordSecondPhase(commandBuffers[currentFrame], currentFrame);
+		}
+		renderPassBeginInfo.renderPass = secondPhaseRenderPass;
+		vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (bCullOcclusion)
+		{
+			occlusionCuller->recordDraws(commandBuffers[currentFrame], currentFrame, 1);
+		}
 		vkCmdEndRenderPass(commandBuffers[currentFrame]);
+	}
+
+	// upscale the drawn part of the scene image to the swapchain image; the
+	// frame time is measured up to here, the upscale waits for the acquire
+	VkCommandBuffer frameCommandBuffers[] = { commandBuffers[currentFrame], upscaleCommandBuffers[currentFrame] };
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffers[currentFrame], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrame + 1);
+		framesTimestamped[currentFrame] = true;
+	}
+	if (bDynamicResolution)
+	{
 		if (vkEndCommandBuffer(commandBuffers[currentFrame]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("ERROR: 'vkEndCommandBuffer' failed to end command buffer!");
 		}
-
-		// waits for image to be done presenting, renders an image, and signals when finsihed
-		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		VkPipelineStageFlags pipelineStageFlags[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = pipelineStageFlags;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
-
-		// submit the command buffer to the graphics queue
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+		vkResetCommandBuffer(upscaleCommandBuffers[currentFrame], 0);
+		if (vkBeginCommandBuffer(upscaleCommandBuffers[currentFrame], &commandBufferBeginInfo) != VK_SUCCESS)
 		{
-			throw std::runtime_error("ERROR: 'vkQueueSubmit' failed to submit a queue!");
+			throw std::runtime_error("ERROR: 'vkBeginCommandBuffer' failed to begin a command buffer!");
 		}
 
-		// waits for rendering to be finished, present an image to the swapchain
-		VkSwapchainKHR swapchains[] = { swapchain };
-		VkPresentInfoKHR presentInfo{};
-		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = signalSemaphores;
-		presentInfo.swapchainCount = 1;
-		presentInfo.pSwapchains = swapchains;
-		presentInfo.pImageIndices = &imageIndex;
-		presentInfo.pResults = nullptr; // optional
-		result = vkQueuePresentKHR(presentQueue, &presentInfo);
-
-		// consider suboptimal as a fail to maintain good image quality
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || bFramebufferResized)
+		VkImageMemoryBarrier imageMemoryBarrier{};
+		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageMemoryBarrier.srcAccessMask = 0;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.image = swapchainImages[imageIndex];
+		imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+		imageMemoryBarrier.subresourceRange.levelCount = 1;
+		imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+		imageMemoryBarrier.subresourceRange.layerCount = 1;
+		vkCmdPipelineBarrier(upscaleCommandBuffers[currentFrame], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+		VkImageBlit imageBlit{};
+		imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBlit.srcSubresource.mipLevel = 0;
+		imageBlit.srcSubresource.baseArrayLayer = 0;
+		imageBlit.srcSubresource.layerCount = 1;
+		imageBlit.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+		imageBlit.dstSubresource = imageBlit.srcSubresource;
+		imageBlit.dstOffsets[1] = { static_cast<int32_t>(swapchainExtent.width), static_cast<int32_t>(swapchainExtent.height), 1 };
+		vkCmdBlitImage(upscaleCommandBuffers[currentFrame], sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, upscaleFilter);
+
+		// presentation waits on the semaphore, no access to make available
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask = 0;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		vkCmdPipelineBarrier(upscaleCommandBuffers[currentFrame], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+	}
+	if (vkEndCommandBuffer(frameCommandBuffers[bDynamicResolution ? 1 : 0]) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkEndCommandBuffer' failed to end command buffer!");
+	}
+
+	// waits for image to be done presenting, renders an image, and signals
+	// when finsihed; with dynamic resolution the rendering is a batch of its
+	// own that doesn't wait for the acquire, only the upscale batch writes
+	// the image. Otherwise the measured frame time would include the wait for
+	// the presentation engine to release an image, which with FIFO present
+	// mode is up to a vsync interval regardless of the rendering
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<VkPipelineStageFlags> pipelineStageFlags;
+	std::vector<uint64_t> waitSemaphoreValues;
+	if (!bDynamicResolution)
+	{
+		waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+		pipelineStageFlags.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		waitSemaphoreValues.push_back(0);
+	}
+
+	// wait for compute work submitted since the last frame before the
+	// vertex and indirect stages that may consume its results
+	if (asyncCompute && asyncCompute->getSubmittedValue() > computeWaitedValue)
+	{
+		computeWaitedValue = asyncCompute->getSubmittedValue();
+		waitSemaphores.push_back(asyncCompute->getTimelineSemaphore());
+		pipelineStageFlags.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+		waitSemaphoreValues.push_back(computeWaitedValue);
+	}
+
+	// the upscale batch waits for the acquire before the blit
+	VkPipelineStageFlags upscaleStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	uint64_t upscaleWaitSemaphoreValue = 0;
+
+	VkSubmitInfo submitInfos[2]{};
+	VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfos[2]{};
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		submitInfos[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfos[i].commandBufferCount = 1;
+		submitInfos[i].pCommandBuffers = &frameCommandBuffers[i];
+		timelineSemaphoreSubmitInfos[i].sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	}
+	submitInfos[0].waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfos[0].pWaitSemaphores = waitSemaphores.data();
+	submitInfos[0].pWaitDstStageMask = pipelineStageFlags.data();
+	timelineSemaphoreSubmitInfos[0].waitSemaphoreValueCount = static_cast<uint32_t>(waitSemaphoreValues.size());
+	timelineSemaphoreSubmitInfos[0].pWaitSemaphoreValues = waitSemaphoreValues.data();
+	submitInfos[1].waitSemaphoreCount = 1;
+	submitInfos[1].pWaitSemaphores = &imageAvailableSemaphores[currentFrame];
+	submitInfos[1].pWaitDstStageMask = &upscaleStageFlags;
+	timelineSemaphoreSubmitInfos[1].waitSemaphoreValueCount = 1;
+	timelineSemaphoreSubmitInfos[1].pWaitSemaphoreValues = &upscaleWaitSemaphoreValue;
+
+	// the last batch submitted signals the end of the frame
+	uint32_t submitCount = bDynamicResolution ? 2 : 1;
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame], frameTimelineSemaphore };
+	VkSubmitInfo& submitInfo = submitInfos[submitCount - 1];
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	// present needs the binary semaphore, the timeline is signaled with the
+	// frame's number alongside it (binary semaphore values are ignored)
+	uint64_t signalSemaphoreValues[] = { 0, frameNumber + 1 };
+	timelineSemaphoreSubmitInfos[submitCount - 1].signalSemaphoreValueCount = 2;
+	timelineSemaphoreSubmitInfos[submitCount - 1].pSignalSemaphoreValues = signalSemaphoreValues;
+	if (bTimelineSemaphore)
+	{
+		for (uint32_t i = 0; i < submitCount; i++)
 		{
-			bFramebufferResized = false;
-			recreateSwapchain();
+			submitInfos[i].pNext = &timelineSemaphoreSubmitInfos[i];
 		}
-		else if (result != VK_SUCCESS)
+		submitInfo.signalSemaphoreCount = 2;
+	}
+
+	// submit the command buffers to the graphics queue
+	if (vkQueueSubmit(graphicsQueue, submitCount, submitInfos, bTimelineSemaphore ? VK_NULL_HANDLE : inFlightFences[currentFrame]) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkQueueSubmit' failed to submit a queue!");
+	}
+	inFlightFrameNumbers[currentFrame] = ++frameNumber;
+	bFrameSubmitted = true;
+
+	auto submitEndTime = std::chrono::high_resolution_clock::now();
+	frameTimings.frame = frameNumber;
+	frameTimings.cpuTime = std::chrono::duration<double, std::milli>(submitEndTime - submitStartTime).count();
+}
+
+void BkRenderer::endFrame()
+{
+	// presenting waits for the frame's render finished semaphore, which is only
+	// signaled by a submitted frame
+	if (!bFrameSubmitted)
+	{
+		throw std::runtime_error("ERROR: 'endFrame' called without a frame submitted by 'submit'!");
+	}
+	bFrameBegun = false;
+	bFrameSubmitted = false;
+
+	// waits for rendering to be finished, present an image to the swapchain
+	VkSwapchainKHR swapchains[] = { swapchain };
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = swapchains;
+	presentInfo.pImageIndices = &imageIndex;
+	presentInfo.pResults = nullptr; // optional
+	VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+	// consider suboptimal as a fail to maintain good image quality
+	bool bResized = bFramebufferResized.exchange(false);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || bResized)
+	{
+		if (!recreateSwapchain())
 		{
-			throw std::runtime_error("ERROR: 'vkQueuePresentKHR' failed to present swap chain image!");
+			bFramebufferResized = true;
 		}
-
-		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	}
+	else if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkQueuePresentKHR' failed to present swap chain image!");
 	}
 
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void BkRenderer::setModel(const glm::mat4& model)
+{
+	this->model = model;
+}
+
+void BkRenderer::resize(uint32_t width, uint32_t height)
+{
+	framebufferWidth = width;
+	framebufferHeight = height;
+	bFramebufferResized = true;
+}
+
+void BkRenderer::setView(const glm::mat4& view)
+{
+	this->view = view;
+}
+
+BkRenderer::~BkRenderer()
+{
 	// wait for the logical device to finish operations before cleanup
 	vkDeviceWaitIdle(device);
 
+	// stop watching and destroy the pipelines that were still being rebuilt
+	shaderHotReload.reset();
+	if (pendingGraphicsPipelines.valid())
+	{
+		try
+		{
+			for (const auto& pipeline : pendingGraphicsPipelines.get())
+			{
+				vkDestroyPipeline(device, pipeline.second, nullptr);
+			}
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	// destroy the swapchain resources and everything still waiting in the
+	// deletion queue
+	retireSwapchain();
+	deletionQueue.flush();
+
 	// cleanup allocated resources
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
@@ -1169,23 +2315,41 @@ void BkRenderer::render()
 		vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
 	}
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	asyncCompute.reset();
+	if (bTimelineSemaphore)
+	{
+		vkDestroySemaphore(device, frameTimelineSemaphore, nullptr);
+	}
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	}
+	frameDescriptorAllocators.clear();
+	frameArena.reset();
+	occlusionCuller.reset();
+	for (size_t i = 0; i < indirectBuffers.size(); i++)
 	{
-		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-		vkFreeMemory(device, uniformBuffersDeviceMemory[i], nullptr);
+		vkDestroyBuffer(device, indirectBuffers[i], nullptr);
+		vkFreeMemory(device, indirectBuffersDeviceMemory[i], nullptr);
 	}
 	vkDestroyBuffer(device, indexBuffer, nullptr);
 	vkFreeMemory(device, indexBufferDeviceMemory, nullptr);
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
 	vkFreeMemory(device, vertexBufferDeviceMemory, nullptr);
+	bindlessTable.reset();
 	vkDestroySampler(device, textureSampler, nullptr);
-	vkDestroyImageView(device, textureImageView, nullptr);
-	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageDeviceMemory, nullptr);
+	textureStreamer.reset();
 	vkDestroyCommandPool(device, commandPool, nullptr);
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	for (const auto& graphicsPipeline : graphicsPipelines)
+	{
+		vkDestroyPipeline(device, graphicsPipeline.second, nullptr);
+	}
+	pipelineCache.reset();
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	descriptorLayoutCache.reset();
+	if (secondPhaseRenderPass != VK_NULL_HANDLE)
+	{
+		vkDestroyRenderPass(device, secondPhaseRenderPass, nullptr);
+	}
 	vkDestroyRenderPass(device, renderPass, nullptr);
 }
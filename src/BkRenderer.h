@@ -4,60 +4,51 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <memory>
+#include <future>
+#include <atomic>
 
 #include <glm/glm.hpp>
 #include <array>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-struct Vertex {
-	glm::vec3 pos;
-	glm::vec3 color;
-	glm::vec2 texCoord;
-
-	// tell vulkan how to pass the data format to the vertex shader once
-	// in GPU memory
-	static VkVertexInputBindingDescription getVertexInputBindingDescription()
-	{
-		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 3> getVertexInputAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-		
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-		return attributeDescriptions;
-	}
-
-	bool operator==(const Vertex& other) const {
-		return pos == other.pos && color == other.color && texCoord == other.texCoord;
-	}
+#include <unordered_map>
+
+#include "BkContext.h"
+#include "BkVertex.h"
+#include "BkMesh.h"
+#include "BkMeshlet.h"
+#include "BkOcclusionCuller.h"
+#include "BkDynamicResolution.h"
+#include "BkBvh.h"
+#include "BkTextureStreamer.h"
+#include "BkBindless.h"
+#include "BkDescriptorAllocator.h"
+#include "BkFrameArena.h"
+#include "BkDeletionQueue.h"
+#include "BkAsyncCompute.h"
+#include "BkShaderHotReload.h"
+#include "BkShaderVariant.h"
+#include "BkPipelineCache.h"
+#include "BkJobSystem.h"
+#include "BkTaskGraph.h"
+
+// durations of the renderer's frames in milliseconds, for profiling; the
+// GPU time lags a few frames behind, it is read once the frame completed
+struct BkFrameTimings {
+	// the time submit() took to cull, record and submit frame 'frame'
+	uint64_t frame = 0;
+	double cpuTime = 0.0;
+
+	// the time between the frame's first and last command on the graphics
+	// queue, without the upscale; without dynamic resolution it includes the
+	// wait for the swapchain image. Only if the queue supports timestamps
+	uint64_t gpuFrame = 0;
+	double gpuTime = 0.0;
+	bool bGpuTime = false;
 };
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
-		}
-	};
-}
 
+// draws the scene into the context's window; the application drives it one
+// frame at a time with beginFrame(), submit() and endFrame() and can do its
+// own work between them while the GPU renders the previous frames
 class BkRenderer
 {
 private:
@@ -66,13 +57,128 @@ private:
 	const std::string MODEL_PATH = "models/viking_room.obj";
 	const std::string TEXTURE_PATH = "textures/viking_room.png";
 
-
+	// reorder the loaded mesh for vertex cache, overdraw and vertex fetch
+	const bool ENABLE_MESH_OPTIMIZATION = true;
+
+	// generate simplified levels of detail and switch between them once their
+	// error projects to less than LOD_MAX_SCREEN_ERROR pixels
+	const bool ENABLE_MESH_LODS = true;
+	const float LOD_MAX_SCREEN_ERROR = 1.0f;
+
+	// split the full detail mesh into meshlets and cull backfacing and
+	// off-screen meshlets on the CPU into an indirect draw buffer
+	const bool ENABLE_MESHLET_CULLING = true;
+
+	// test the meshlets that pass the CPU culling against a depth pyramid
+	// (Hi-Z) on the GPU in two phases around the depth of the frame, so
+	// meshlets hidden behind others aren't drawn (needs drawIndirectCount,
+	// falls back to the CPU culling alone)
+	const bool ENABLE_OCCLUSION_CULLING = true;
+
+	// print the meshlets and triangles drawn by the occlusion culling every
+	// this many frames (0 disables)
+	const uint32_t OCCLUSION_STATS_INTERVAL = 600;
+
+	// samples per pixel of the multisample anti-aliasing (1, 2, 4 or 8),
+	// lowered to what the device supports; the samples are resolved to the
+	// swapchain image at the end of the frame's last render pass
+	const VkSampleCountFlagBits MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+
+	// render at a fraction of the swapchain's resolution between the bounds,
+	// lowered while the GPU frame time is above the target and raised again
+	// below it, and upscale to the swapchain image with a blit; the render
+	// targets have the size of the upper bound, so scaling never reallocates
+	// (needs timestamp queries and blits to the swapchain)
+	const bool ENABLE_DYNAMIC_RESOLUTION = true;
+	const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+	const float DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+	const float DYNAMIC_RESOLUTION_TARGET_FRAME_TIME = 1000.0f / 60.0f;
+
+	// video memory the streamed texture mip levels may use
+	const VkDeviceSize TEXTURE_STREAMING_BUDGET = 128 * 1024 * 1024;
+
+	// sample textures and materials through one bindless descriptor set
+	// indexed in the shader instead of rebinding per draw (falls back to the
+	// per-draw set if the device lacks descriptor indexing)
+	const bool ENABLE_BINDLESS = true;
+
+	// track frame completion with one timeline semaphore signaled with the
+	// frame number instead of a fence per frame in flight (Vulkan 1.2)
+	const bool ENABLE_TIMELINE_SEMAPHORE = true;
+
+	// submit compute work to the dedicated compute queue (if there is one) so
+	// it overlaps with rendering, requires the timeline semaphore
+	const bool ENABLE_ASYNC_COMPUTE = true;
+
+	// recompile the GLSL sources when they are saved and swap in the rebuilt
+	// graphics pipeline while the application keeps running
+	const bool ENABLE_SHADER_HOT_RELOAD = true;
+
+	// run the independent parts of the initialization (shader loading and
+	// pipeline compilation, model parsing and upload) as a task graph on the
+	// job system instead of one after another
+	const bool ENABLE_PARALLEL_INIT = true;
+
+	// print the duration of every init task and of the whole initialization,
+	// to see where the startup time goes
+	const bool ENABLE_INIT_TIMING_OUTPUT = false;
+
+	// meshlets culled by one job
+	const uint32_t MESHLET_CULL_BATCH_SIZE = 64;
+
+	// runs the CPU work of the initialization and the frames on all cores,
+	// the texture streamer keeps its own threads for the blocking file reads
+	std::unique_ptr<BkJobSystem> jobSystem;
+
+	// owned by the context
+	VkSurfaceKHR surface;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	uint32_t graphicsQueueFamilyIndex;
+	uint32_t presentQueueFamilyIndex;
+	uint32_t computeQueueFamilyIndex;
+	VkQueue graphicsQueue;
+	VkQueue presentQueue;
+	VkQueue computeQueue;
+
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	std::vector<VkImage> swapchainImages;
+	std::vector<VkImageView> swapchainImageViews;
+	VkFormat swapchainImageFormat;
+	VkExtent2D swapchainExtent;
+
+	// set by resize() on the window's thread, the swapchain is recreated by
+	// the thread that renders
+	std::atomic<bool> bFramebufferResized{ false };
+	std::atomic<uint32_t> framebufferWidth{ 0 };
+	std::atomic<uint32_t> framebufferHeight{ 0 };
+
+	// present with the immediate mode where available instead of waiting for
+	// the vertical blank
+	bool bVsync;
+
+	// with occlusion culling the frame is drawn in two passes around the
+	// depth pyramid build, 'renderPass' is the first one then
 	VkRenderPass renderPass;
+	VkRenderPass secondPhaseRenderPass = VK_NULL_HANDLE;
 
+	// owned by the layout cache
+	std::unique_ptr<BkDescriptorLayoutCache> descriptorLayoutCache;
 	VkDescriptorSetLayout descriptorSetLayout;
 
 	VkPipelineLayout pipelineLayout;
-	VkPipeline graphicsPipeline;
+	// a pipeline per shader variant (BkShaderFeature bits), created on first
+	// use through the pipeline cache
+	std::unordered_map<uint32_t, VkPipeline> graphicsPipelines;
+	std::unique_ptr<BkPipelineCache> pipelineCache;
+	std::string vertShaderPath;
+	std::string fragShaderPath;
+
+	// the replacement pipelines are created off the render thread and
+	// swapped in once they are ready, the old ones are retired through the
+	// deletion queue
+	std::unique_ptr<BkShaderHotReload> shaderHotReload;
+	std::future<std::unordered_map<uint32_t, VkPipeline>> pendingGraphicsPipelines;
 
 	std::vector<VkFramebuffer> swapchainFramebuffers;
 
@@ -83,47 +189,173 @@ private:
 	VkDeviceMemory depthImageDeviceMemory;
 	VkImageView depthImageView;
 
-	VkImage textureImage;
-	VkDeviceMemory textureImageDeviceMemory;
-	VkImageView textureImageView;
+	// the multisampled color image resolved to the swapchain, only with MSAA;
+	// the depth image has the same sample count. Both are transient (lazily
+	// allocated where supported) unless the two occlusion culling passes keep
+	// them between the passes
+	VkImage colorImage = VK_NULL_HANDLE;
+	VkDeviceMemory colorImageDeviceMemory = VK_NULL_HANDLE;
+	VkImageView colorImageView = VK_NULL_HANDLE;
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// with dynamic resolution the frame is drawn (or resolved) into the scene
+	// image, of which the top left 'renderExtent' is blitted to the swapchain
+	// image; without it both extents are the swapchain's
+	VkImage sceneImage = VK_NULL_HANDLE;
+	VkDeviceMemory sceneImageDeviceMemory = VK_NULL_HANDLE;
+	VkImageView sceneImageView = VK_NULL_HANDLE;
+	VkExtent2D renderTargetExtent{};
+	VkExtent2D renderExtent{};
+	std::unique_ptr<BkDynamicResolution> dynamicResolution;
+	VkFilter upscaleFilter = VK_FILTER_NEAREST;
+	bool bDynamicResolution = false;
+
+	// the blit to the swapchain image is submitted in a batch of its own, so
+	// only it waits for the image to be acquired
+	std::vector<VkCommandBuffer> upscaleCommandBuffers;
+
+	// a begin and end timestamp per frame in flight around the rendering
+	// (without the upscale), for the GPU frame time; no pool if the graphics
+	// queue doesn't support timestamps
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	float timestampPeriod = 1.0f;
+	uint32_t timestampValidBits = 0;
+	std::vector<bool> framesTimestamped = std::vector<bool>(MAX_FRAMES_IN_FLIGHT, false);
+	BkFrameTimings frameTimings;
+
+	// the texture is decoded and uploaded in the background; the descriptor
+	// sets reference the placeholder until it is resident
+	std::unique_ptr<BkTextureStreamer> textureStreamer;
+	uint32_t texture;
 	VkSampler textureSampler;
 
+	std::unique_ptr<BkBindlessTable> bindlessTable;
+	uint32_t material = 0;
+	bool bBindless = false;
+
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferDeviceMemory;
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferDeviceMemory;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<BkMeshLod> meshLods;
+	BkBoundingSphere meshBounds;
+	std::vector<BkMeshlet> meshlets;
+
+	// over the triangles of the full detail level, for picking
+	BkBvh meshBvh;
+
+	std::vector<VkBuffer> indirectBuffers;
+	std::vector<VkDeviceMemory> indirectBuffersDeviceMemory;
+	std::vector<void*> indirectBuffersMapped;
 
-	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersDeviceMemory;
-	std::vector<void*> uniformBuffersMapped;
+	// every culling batch writes its draws to its own range, they are
+	// compacted into the indirect buffer afterwards
+	std::vector<VkDrawIndexedIndirectCommand> meshletCullDraws;
+	std::vector<uint32_t> meshletCullDrawCounts;
+	bool bMultiDrawIndirect = false;
 
-	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	// the CPU culling writes candidate meshlets instead of draws for it
+	std::unique_ptr<BkOcclusionCuller> occlusionCuller;
+	std::vector<uint32_t> meshletCullIndices;
+	bool bOcclusionCulling = false;
+
+	// transient per-frame data bound with dynamic offsets
+	std::unique_ptr<BkFrameArena> frameArena;
+
+	std::vector<std::unique_ptr<BkDescriptorAllocator>> frameDescriptorAllocators;
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 	std::vector<VkFence> inFlightFences;
+
+	// signaled with the frame number by the graphics queue only; async compute
+	// signals a timeline of its own, because signals of one timeline have to
+	// increase in execution order, which would serialize the two queues
+	VkSemaphore frameTimelineSemaphore = VK_NULL_HANDLE;
+	bool bTimelineSemaphore = false;
+
+	// the graphics submission waits for compute values above computeWaitedValue
+	std::unique_ptr<BkAsyncCompute> asyncCompute;
+	uint64_t computeWaitedValue = 0;
 	uint32_t currentFrame = 0;
 
-	void findQueueFamiliesIndex(std::optional<uint32_t>& graphicsQueueFamilyIndex, std::optional<uint32_t>& presentQueueFamilyIndex);
+	// the swapchain image acquired by beginFrame() for submit() and endFrame()
+	uint32_t imageIndex = 0;
+	bool bFrameBegun = false;
+	bool bFrameSubmitted = false;
 
-	void createSwapchainAndImageViews(std::optional<uint32_t>& graphicsQueueFamilyIndex, std::optional<uint32_t>& presentQueueFamilyIndex);
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat4 view = glm::mat4(1.0f);
+
+	// number of submitted frames and the frame number each frame in flight
+	// slot was last submitted with; deletions are tagged with frame numbers
+	uint64_t frameNumber = 0;
+	std::vector<uint64_t> inFlightFrameNumbers = std::vector<uint64_t>(MAX_FRAMES_IN_FLIGHT, 0);
+	BkDeletionQueue deletionQueue;
+
+	// the B8G8R8A8 sRGB surface format, throws if the surface doesn't support it
+	VkSurfaceFormatKHR chooseSurfaceFormat();
+
+	// 'oldSwapchain' is the retired swapchain being replaced, if any
+	void createSwapchainAndImageViews(VkSwapchainKHR oldSwapchain);
 
 	void createDepthResources(VkFormat& depthFormat);
 
+	// the multisampled color image, if MSAA is enabled, and the scene image,
+	// if dynamic resolution is
+	void createColorResources();
+
+	// timestamps on the graphics queue and blits from the scene image in
+	// 'sceneFormat' to the swapchain images in 'swapchainFormat'
+	bool isDynamicResolutionSupported(VkFormat swapchainFormat, VkFormat sceneFormat);
+
+	// the GPU time of the frame that last used the slot into 'frameTimings',
+	// after waiting for it
+	void readFrameTimestamps();
+
+	// the scale of the frame from the GPU time read by readFrameTimestamps()
+	void updateRenderExtent();
+
+	// the first pass of a frame clears the attachments, the last one leaves
+	// the color image ready to present (or to blit from with dynamic
+	// resolution); passes before the last keep the depth
+	// for the depth pyramid and the passes after them load it. With MSAA the
+	// swapchain image is the resolve attachment of every pass, so all passes
+	// share the framebuffers and pipelines, but only the last one stores it
+	VkRenderPass createRenderPass(VkFormat depthFormat, bool bFirstPass, bool bLastPass);
+
 	void createSwapchainFramebuffer();
 
-	void cleanupSwapchain();
+	// queue the swapchain, its image views, the framebuffers and the depth
+	// image for destruction once the frames in flight are done with them; the
+	// replacement swapchain is created with the retired one as 'oldSwapchain'
+	void retireSwapchain();
 
-	void recreateSwapchain();
+	VkPipeline createGraphicsPipeline(const std::vector<char>& vertShaderBytecode, const std::vector<char>& fragShaderBytecode, uint32_t shaderFeatures);
+
+	VkPipeline getGraphicsPipeline(uint32_t shaderFeatures);
+
+	// start rebuilding the pipelines if their shaders were recompiled and swap
+	// in the rebuilt pipelines once they are ready, never waits
+	void updateShaderHotReload();
+
+	// number of the newest frame known to have finished on the GPU
+	uint64_t getCompletedFrameNumber();
+
+	// false if the window is minimized, the old swapchain is kept until the
+	// next try then
+	bool recreateSwapchain();
 
 	void beginSingleTimeCommands(VkCommandBuffer& commandBuffer);
 
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkImage& image, VkDeviceMemory& imageDeviceMemory);
+	// lazily allocated memory in 'memoryPropertyFlags' is dropped if the
+	// device has none for the image
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkImage& image, VkDeviceMemory& imageDeviceMemory, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
 	
 	void createImageView(VkImage image, VkFormat format, VkImageAspectFlags imageAspectFlags, VkImageView& imageView);
 
@@ -134,9 +366,50 @@ private:
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize deviceSize);
 
 public:
-	bool bFramebufferResized = false;
+	// creates the swapchain for the window's current framebuffer size, call
+	// it on the thread that created the window; without 'bVsync' the frame
+	// rate isn't capped at the display's refresh rate (for benchmarks)
+	BkRenderer(const BkContext& context, bool bVsync = true);
+
+	// waits for the device to be idle, the context has to outlive the renderer
+	~BkRenderer();
+
+	BkRenderer(const BkRenderer&) = delete;
+	BkRenderer& operator=(const BkRenderer&) = delete;
+
+	// wait until the oldest frame in flight has finished and acquire the next
+	// swapchain image; false if the swapchain had to be recreated instead (or
+	// can't be while the window is minimized), then the frame is skipped and
+	// neither submit() nor endFrame() is called
+	bool beginFrame();
+
+	// record the frame's commands with the current model and view and submit
+	// them to the graphics queue
+	void submit();
+
+	// present the frame and move on to the next frame in flight
+	void endFrame();
+
+	void setModel(const glm::mat4& model);
+
+	// the window's framebuffer was resized to 'width' x 'height' pixels, can
+	// be called from any thread
+	void resize(uint32_t width, uint32_t height);
+
+	void setView(const glm::mat4& view);
+
+	// true once frame number 'frame' has finished on the GPU, without waiting
+	bool isFrameComplete(uint64_t frame);
+
+	// compute queue scheduler, null without timeline semaphore support
+	BkAsyncCompute* getAsyncCompute() const;
+
+	// the CPU time of the last submitted frame and the newest GPU time read
+	const BkFrameTimings& getFrameTimings() const;
 
-	BkRenderer();
-	void render();
+	// nearest triangle of the full detail mesh hit by a ray in the mesh's
+	// object space, its index and the distance along 'direction'; only reads
+	// data that doesn't change after construction, so any thread can pick
+	bool pickTriangle(const glm::vec3& origin, const glm::vec3& direction, uint32_t& triangle, float& distance) const;
 };
 
@@ -0,0 +1,179 @@
+#include "BkShaderHotReload.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+BkShaderHotReload::BkShaderHotReload(const std::string& sourceDirectory, const std::string& glslcPath)
+	: sourceDirectory(sourceDirectory), glslcPath(glslcPath)
+{
+}
+
+BkShaderHotReload::~BkShaderHotReload()
+{
+	bStopping = true;
+	if (watchThread.joinable())
+	{
+		watchThread.join();
+	}
+#ifdef __linux__
+	if (inotifyFd != -1)
+	{
+		close(inotifyFd);
+	}
+#endif
+}
+
+void BkShaderHotReload::watch(const std::string& sourceFile, const std::string& spirvPath)
+{
+	WatchedShader shader{};
+	shader.sourceFile = sourceFile;
+	shader.spirvPath = spirvPath;
+
+	std::error_code errorCode;
+	shader.lastWriteTime = std::filesystem::last_write_time(std::filesystem::path(sourceDirectory) / sourceFile, errorCode);
+	shaders.push_back(shader);
+}
+
+void BkShaderHotReload::start()
+{
+#ifdef __linux__
+	// editors either write the file in place or replace it with a renamed
+	// temporary file, so watch for both
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd != -1 && inotify_add_watch(inotifyFd, sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+	{
+		std::cerr << "WARNING: 'inotify_add_watch' failed to watch '" << sourceDirectory << "', polling instead" << std::endl;
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+#endif
+
+	watchThread = std::thread(&BkShaderHotReload::watchLoop, this);
+}
+
+std::vector<std::string> BkShaderHotReload::takeReloaded()
+{
+	std::lock_guard<std::mutex> lock(reloadedMutex);
+	std::vector<std::string> reloaded;
+	reloaded.swap(reloadedSpirvPaths);
+	return reloaded;
+}
+
+std::vector<std::string> BkShaderHotReload::waitForChanges()
+{
+	std::vector<std::string> changedFiles;
+
+#ifdef __linux__
+	if (inotifyFd != -1)
+	{
+		pollfd pollFd{};
+		pollFd.fd = inotifyFd;
+		pollFd.events = POLLIN;
+		if (poll(&pollFd, 1, SHADER_WATCH_INTERVAL_MS) <= 0)
+		{
+			return changedFiles;
+		}
+
+		// let the editor finish writing, then drain every queued event so a
+		// save that touches the file several times compiles once
+		std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCH_SETTLE_MS));
+		alignas(inotify_event) char events[4096];
+		ssize_t length;
+		while ((length = read(inotifyFd, events, sizeof(events))) > 0)
+		{
+			for (char* event = events; event < events + length;)
+			{
+				const inotify_event* inotifyEvent = reinterpret_cast<const inotify_event*>(event);
+				if (inotifyEvent->len > 0)
+				{
+					changedFiles.push_back(inotifyEvent->name);
+				}
+				event += sizeof(inotify_event) + inotifyEvent->len;
+			}
+		}
+		return changedFiles;
+	}
+#endif
+
+	// no change notifications, compare the modification times instead
+	std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCH_INTERVAL_MS));
+	for (WatchedShader& shader : shaders)
+	{
+		std::error_code errorCode;
+		std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(std::filesystem::path(sourceDirectory) / shader.sourceFile, errorCode);
+		if (!errorCode && lastWriteTime != shader.lastWriteTime)
+		{
+			shader.lastWriteTime = lastWriteTime;
+			changedFiles.push_back(shader.sourceFile);
+		}
+	}
+	if (!changedFiles.empty())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCH_SETTLE_MS));
+	}
+	return changedFiles;
+}
+
+void BkShaderHotReload::watchLoop()
+{
+	while (!bStopping)
+	{
+		std::vector<std::string> changedFiles = waitForChanges();
+		std::sort(changedFiles.begin(), changedFiles.end());
+		changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+
+		for (const WatchedShader& shader : shaders)
+		{
+			if (std::find(changedFiles.begin(), changedFiles.end(), shader.sourceFile) == changedFiles.end())
+			{
+				continue;
+			}
+
+			if (compile(shader))
+			{
+				std::lock_guard<std::mutex> lock(reloadedMutex);
+				reloadedSpirvPaths.push_back(shader.spirvPath);
+			}
+		}
+	}
+}
+
+bool BkShaderHotReload::compile(const WatchedShader& shader)
+{
+	// compile next to the target and rename it over the old SPIR-V, so the
+	// render thread never reads a partially written file and a failed
+	// compile keeps the last working shader
+	std::string sourcePath = (std::filesystem::path(sourceDirectory) / shader.sourceFile).string();
+	std::string temporaryPath = shader.spirvPath + ".tmp";
+	std::string command = "\"" + glslcPath + "\" \"" + sourcePath + "\" -o \"" + temporaryPath + "\"";
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes of the whole command line
+	command = "\"" + command + "\"";
+#endif
+
+	std::cout << "recompiling '" << shader.sourceFile << "'" << std::endl;
+	if (std::system(command.c_str()) != 0)
+	{
+		std::cerr << "ERROR: 'glslc' failed to compile '" << shader.sourceFile << "', keeping the previous shader" << std::endl;
+		std::error_code errorCode;
+		std::filesystem::remove(temporaryPath, errorCode);
+		return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(temporaryPath, shader.spirvPath, errorCode);
+	if (errorCode)
+	{
+		std::cerr << "ERROR: failed to replace '" << shader.spirvPath << "': " << errorCode.message() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+
+// set by CMake to the glslc found at configure time and to the shader source
+// directory, the fallbacks expect glslc on the PATH and the source tree as
+// the working directory
+#ifndef BULKAN_GLSLC_PATH
+#define BULKAN_GLSLC_PATH "glslc"
+#endif
+#ifndef BULKAN_SHADER_SOURCE_DIR
+#define BULKAN_SHADER_SOURCE_DIR "src/shaders"
+#endif
+
+// how often the watcher thread checks for changes and how long it waits for
+// an editor to finish writing a file before compiling it
+const int SHADER_WATCH_INTERVAL_MS = 100;
+const int SHADER_WATCH_SETTLE_MS = 50;
+
+// watches the GLSL sources for changes and recompiles them to SPIR-V with
+// glslc on a background thread (inotify on linux, modification times
+// elsewhere); the render thread collects the rebuilt SPIR-V files and
+// recreates its pipelines from them, a shader that fails to compile is
+// reported and the old SPIR-V is left untouched
+class BkShaderHotReload
+{
+private:
+	struct WatchedShader {
+		std::string sourceFile;
+		std::string spirvPath;
+		std::filesystem::file_time_type lastWriteTime;
+	};
+
+	std::string sourceDirectory;
+	std::string glslcPath;
+	std::vector<WatchedShader> shaders;
+
+	std::thread watchThread;
+	std::atomic<bool> bStopping{ false };
+	int inotifyFd = -1;
+
+	std::mutex reloadedMutex;
+	std::vector<std::string> reloadedSpirvPaths;
+
+	void watchLoop();
+
+	// names of the watched source files changed since the last call, blocks
+	// for up to SHADER_WATCH_INTERVAL_MS
+	std::vector<std::string> waitForChanges();
+
+	bool compile(const WatchedShader& shader);
+
+public:
+	BkShaderHotReload(const std::string& sourceDirectory = BULKAN_SHADER_SOURCE_DIR, const std::string& glslcPath = BULKAN_GLSLC_PATH);
+	~BkShaderHotReload();
+
+	BkShaderHotReload(const BkShaderHotReload&) = delete;
+	BkShaderHotReload& operator=(const BkShaderHotReload&) = delete;
+
+	// recompile 'sourceFile' (relative to the source directory) into
+	// 'spirvPath' whenever it changes; all shaders are added before start()
+	void watch(const std::string& sourceFile, const std::string& spirvPath);
+
+	void start();
+
+	// SPIR-V files rebuilt since the last call
+	std::vector<std::string> takeReloaded();
+};
@@ -0,0 +1,30 @@
+#include "BkShaderVariant.h"
+
+BkShaderVariant::BkShaderVariant(uint32_t features)
+	: features(features)
+{
+	for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++)
+	{
+		constants[i] = (features & (1u << i)) != 0 ? VK_TRUE : VK_FALSE;
+
+		// bool specialization constants are 32 bit wide
+		specializationMapEntries[i].constantID = i;
+		specializationMapEntries[i].offset = i * sizeof(VkBool32);
+		specializationMapEntries[i].size = sizeof(VkBool32);
+	}
+
+	specializationInfo.mapEntryCount = SHADER_FEATURE_COUNT;
+	specializationInfo.pMapEntries = specializationMapEntries.data();
+	specializationInfo.dataSize = sizeof(constants);
+	specializationInfo.pData = constants.data();
+}
+
+uint32_t BkShaderVariant::getFeatures() const
+{
+	return features;
+}
+
+const VkSpecializationInfo* BkShaderVariant::getSpecializationInfo() const
+{
+	return &specializationInfo;
+}
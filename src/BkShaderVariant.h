@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+
+// features the shaders compile in or out through specialization constants,
+// a variant is a combination of these bits; the constant_id of a feature in
+// the shaders is the index of its bit
+enum BkShaderFeature : uint32_t {
+	SHADER_FEATURE_TEXTURED = 1 << 0,
+	SHADER_FEATURE_VERTEX_COLOR = 1 << 1,
+};
+const uint32_t SHADER_FEATURE_COUNT = 2;
+
+// specialization info for one variant, shared by all stages of a pipeline
+// (a stage ignores constants it doesn't declare); the driver folds the
+// constants when the pipeline is created so the disabled branches cost
+// nothing at runtime
+class BkShaderVariant
+{
+private:
+	uint32_t features;
+	std::array<VkBool32, SHADER_FEATURE_COUNT> constants;
+	std::array<VkSpecializationMapEntry, SHADER_FEATURE_COUNT> specializationMapEntries;
+	VkSpecializationInfo specializationInfo;
+
+public:
+	BkShaderVariant(uint32_t features);
+
+	// the specialization info points into the variant
+	BkShaderVariant(const BkShaderVariant&) = delete;
+	BkShaderVariant& operator=(const BkShaderVariant&) = delete;
+
+	uint32_t getFeatures() const;
+
+	const VkSpecializationInfo* getSpecializationInfo() const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// fixed size lock-free queue between exactly one producer thread and one
+// consumer thread; 'CAPACITY' has to be a power of two
+template<typename T, uint32_t CAPACITY>
+class BkSpscRing
+{
+private:
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "BkSpscRing capacity has to be a power of two");
+
+	std::array<T, CAPACITY> slots;
+
+	// the next slot to read (written by the consumer) and to write (written
+	// by the producer), on separate cache lines so they don't false share
+	alignas(64) std::atomic<uint64_t> head{ 0 };
+	alignas(64) std::atomic<uint64_t> tail{ 0 };
+
+public:
+	// producer only, false if the ring is full
+	bool tryPush(const T& value)
+	{
+		uint64_t currentTail = tail.load(std::memory_order_relaxed);
+		if (currentTail - head.load(std::memory_order_acquire) == CAPACITY)
+		{
+			return false;
+		}
+		slots[currentTail & (CAPACITY - 1)] = value;
+		tail.store(currentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only, false if the ring is empty
+	bool tryPop(T& value)
+	{
+		uint64_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		value = slots[currentHead & (CAPACITY - 1)];
+		head.store(currentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool isEmpty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	bool isFull() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire) == CAPACITY;
+	}
+};
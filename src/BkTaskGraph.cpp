@@ -0,0 +1,129 @@
+#include "BkTaskGraph.h"
+#include <chrono>
+#include <stdexcept>
+
+uint32_t BkTaskGraph::addTask(const std::string& name, std::function<void()> function, const std::vector<uint32_t>& dependencies)
+{
+	uint32_t index = static_cast<uint32_t>(tasks.size());
+	for (uint32_t dependency : dependencies)
+	{
+		if (dependency >= index)
+		{
+			throw std::runtime_error("ERROR: task '" + name + "' depends on a task that was added after it!");
+		}
+		tasks[dependency].dependents.push_back(index);
+	}
+
+	Task task{};
+	task.name = name;
+	task.function = std::move(function);
+	task.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	tasks.push_back(std::move(task));
+	return index;
+}
+
+void BkTaskGraph::run(BkJobSystem* jobSystem)
+{
+	exception = nullptr;
+	for (Task& task : tasks)
+	{
+		task.remainingDependencyCount = task.dependencyCount;
+		task.durationMs = 0.0;
+	}
+
+	if (jobSystem == nullptr)
+	{
+		for (uint32_t i = 0; i < tasks.size(); i++)
+		{
+			execute(nullptr, i);
+		}
+	}
+	else
+	{
+		// collect the roots first, the first ones may already finish and
+		// start their dependents while the rest are started
+		std::vector<uint32_t> roots;
+		for (uint32_t i = 0; i < tasks.size(); i++)
+		{
+			if (tasks[i].dependencyCount == 0)
+			{
+				roots.push_back(i);
+			}
+		}
+		for (uint32_t root : roots)
+		{
+			jobSystem->run(counter, [this, jobSystem, root]() { execute(jobSystem, root); });
+		}
+		jobSystem->wait(counter);
+	}
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void BkTaskGraph::execute(BkJobSystem* jobSystem, uint32_t task)
+{
+	bool bFailed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bFailed = exception != nullptr;
+	}
+
+	if (!bFailed)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		try
+		{
+			tasks[task].function();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!exception)
+			{
+				exception = std::current_exception();
+			}
+		}
+		auto endTime = std::chrono::high_resolution_clock::now();
+		tasks[task].durationMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	}
+
+	std::vector<uint32_t> readyTasks;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (uint32_t dependent : tasks[task].dependents)
+		{
+			if (--tasks[dependent].remainingDependencyCount == 0)
+			{
+				readyTasks.push_back(dependent);
+			}
+		}
+	}
+
+	// started before this task's job finishes, so the counter doesn't reach
+	// 0 while tasks are left
+	if (jobSystem != nullptr)
+	{
+		for (uint32_t readyTask : readyTasks)
+		{
+			jobSystem->run(counter, [this, jobSystem, readyTask]() { execute(jobSystem, readyTask); });
+		}
+	}
+}
+
+double BkTaskGraph::getTaskDuration(uint32_t task) const
+{
+	return tasks[task].durationMs;
+}
+
+const std::string& BkTaskGraph::getTaskName(uint32_t task) const
+{
+	return tasks[task].name;
+}
+
+uint32_t BkTaskGraph::getTaskCount() const
+{
+	return static_cast<uint32_t>(tasks.size());
+}
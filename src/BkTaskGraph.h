@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <exception>
+#include <cstdint>
+
+#include "BkJobSystem.h"
+
+// a set of tasks where each task starts as a job as soon as the
+// tasks it depends on have finished; tasks can only depend on tasks added
+// before them, so the graph can't contain cycles
+class BkTaskGraph
+{
+private:
+	struct Task {
+		std::string name;
+		std::function<void()> function;
+		std::vector<uint32_t> dependents;
+		uint32_t dependencyCount = 0;
+		uint32_t remainingDependencyCount = 0;
+		double durationMs = 0.0;
+	};
+
+	std::vector<Task> tasks;
+
+	std::mutex mutex;
+	BkJobCounter counter;
+
+	// the first exception thrown by a task, the tasks that haven't started
+	// yet are skipped once it is set
+	std::exception_ptr exception;
+
+	void execute(BkJobSystem* jobSystem, uint32_t task);
+
+public:
+	// 'dependencies' are indices returned by earlier calls
+	uint32_t addTask(const std::string& name, std::function<void()> function, const std::vector<uint32_t>& dependencies = {});
+
+	// run every task and wait for them to finish (running tasks on the
+	// calling thread as well), rethrows the first exception a task threw;
+	// without a job system the tasks run on the calling thread in the order
+	// they were added
+	void run(BkJobSystem* jobSystem);
+
+	// milliseconds the task took in the last run
+	double getTaskDuration(uint32_t task) const;
+
+	const std::string& getTaskName(uint32_t task) const;
+
+	uint32_t getTaskCount() const;
+};
@@ -0,0 +1,664 @@
+#include "BkTextureStreamer.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include <stb_image.h>
+
+// buffer offsets of buffer to image copies have to be a multiple of the texel
+// size and of optimalBufferCopyOffsetAlignment, which is at most 16 in practice
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+// the placeholder is a small grey checkerboard
+static const uint32_t PLACEHOLDER_SIZE = 2;
+
+static const uint32_t NO_TEXTURE = ~0u;
+
+BkTextureStreamer::BkTextureStreamer(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight, VkDeviceSize vramBudget, uint32_t workerCount, VkDeviceSize stagingRingSize)
+	: device(device), physicalDevice(physicalDevice), queue(queue), framesInFlight(framesInFlight), vramBudget(vramBudget), stagingRingSize(stagingRingSize)
+{
+	// command buffers are allocated per upload batch and freed when it retires
+	VkCommandPoolCreateInfo commandPoolCreateInfo{};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateCommandPool' failed to create the texture upload command pool!");
+	}
+
+	// the staging ring stays mapped for the lifetime of the streamer
+	createBuffer(stagingRingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingRingBuffer, stagingRingBufferDeviceMemory);
+	void* stagingRingData;
+	vkMapMemory(device, stagingRingBufferDeviceMemory, 0, stagingRingSize, 0, &stagingRingData);
+	stagingRingMapped = static_cast<unsigned char*>(stagingRingData);
+
+	// upload the placeholder synchronously so there is always something to bind
+	uint32_t placeholderPixels[PLACEHOLDER_SIZE * PLACEHOLDER_SIZE] = { 0xFF808080, 0xFFC0C0C0, 0xFFC0C0C0, 0xFF808080 };
+	UploadBatch batch;
+	VkDeviceSize stagingOffset;
+	allocateStagingRing(sizeof(placeholderPixels), stagingOffset, batch.ringBytes);
+	memcpy(stagingRingMapped + stagingOffset, placeholderPixels, sizeof(placeholderPixels));
+
+	VkBufferImageCopy bufferImageCopy{};
+	bufferImageCopy.bufferOffset = stagingOffset;
+	bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	bufferImageCopy.imageSubresource.mipLevel = 0;
+	bufferImageCopy.imageSubresource.baseArrayLayer = 0;
+	bufferImageCopy.imageSubresource.layerCount = 1;
+	bufferImageCopy.imageExtent = { PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, 1 };
+
+	beginBatch(batch);
+	createTextureImage(PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, 1, placeholder);
+	recordUpload(batch.commandBuffer, stagingRingBuffer, { bufferImageCopy }, placeholder.image);
+	submitBatch(batch);
+	retireBatches(true);
+
+	threadPool = std::make_unique<BkThreadPool>(workerCount);
+}
+
+BkTextureStreamer::~BkTextureStreamer()
+{
+	// join the workers first so nothing is pushed to 'decodedImages' anymore
+	threadPool.reset();
+	retireBatches(true);
+
+	for (RetiredImage& retiredImage : retiredImages)
+	{
+		destroyTextureImage(retiredImage.image);
+	}
+	for (Texture& texture : textures)
+	{
+		destroyTextureImage(texture.resident);
+	}
+	destroyTextureImage(placeholder);
+
+	vkUnmapMemory(device, stagingRingBufferDeviceMemory);
+	vkDestroyBuffer(device, stagingRingBuffer, nullptr);
+	vkFreeMemory(device, stagingRingBufferDeviceMemory, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+uint32_t BkTextureStreamer::requestTexture(const std::string& path)
+{
+	uint32_t handle = static_cast<uint32_t>(textures.size());
+	Texture texture;
+	texture.path = path;
+	textures.push_back(texture);
+
+	// decode and build the mip chain on a worker; the pixels are handed back
+	// to the render thread which owns every vulkan object of the streamer
+	threadPool->submit([this, handle, path]() {
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels)
+		{
+			std::cerr << "ERROR: failed to load texture image '" << path << "'!" << std::endl;
+			return;
+		}
+
+		DecodedImage decodedImage;
+		decodedImage.handle = handle;
+		buildMipChain(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), decodedImage.pixels, decodedImage.mipLevels);
+		stbi_image_free(pixels);
+
+		std::lock_guard<std::mutex> lock(decodedImagesMutex);
+		decodedImages.push_back(std::move(decodedImage));
+	});
+
+	return handle;
+}
+
+void BkTextureStreamer::requestScreenSize(uint32_t handle, float screenSize)
+{
+	Texture& texture = textures[handle];
+	if (texture.lastRequestFrame == frameIndex)
+	{
+		screenSize = std::max(screenSize, texture.requestedScreenSize);
+	}
+	texture.requestedScreenSize = screenSize;
+	texture.lastRequestFrame = frameIndex;
+}
+
+bool BkTextureStreamer::isResident(uint32_t handle) const
+{
+	return textures[handle].resident.image != VK_NULL_HANDLE;
+}
+
+VkImageView BkTextureStreamer::getImageView(uint32_t handle) const
+{
+	return isResident(handle) ? textures[handle].resident.imageView : placeholder.imageView;
+}
+
+VkDeviceSize BkTextureStreamer::getResidentSize() const
+{
+	VkDeviceSize residentSize = 0;
+	for (const Texture& texture : textures)
+	{
+		if (texture.resident.image != VK_NULL_HANDLE)
+		{
+			residentSize += getMipChainSize(texture, texture.resident.firstMip);
+		}
+		if (texture.uploading.image != VK_NULL_HANDLE)
+		{
+			residentSize += getMipChainSize(texture, texture.uploading.firstMip);
+		}
+	}
+	return residentSize;
+}
+
+bool BkTextureStreamer::update()
+{
+	frameIndex++;
+	bool bViewChanged = retireBatches(false);
+
+	// an image replaced 'framesInFlight' updates ago isn't referenced by any
+	// frame that can still be executing
+	while (!retiredImages.empty() && retiredImages.front().frame + framesInFlight <= frameIndex)
+	{
+		destroyTextureImage(retiredImages.front().image);
+		retiredImages.pop_front();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(decodedImagesMutex);
+		for (DecodedImage& decodedImage : decodedImages)
+		{
+			Texture& texture = textures[decodedImage.handle];
+			texture.pixels = std::move(decodedImage.pixels);
+			texture.mipLevels = std::move(decodedImage.mipLevels);
+			texture.tailMip = static_cast<uint32_t>(texture.mipLevels.size()) - 1;
+			for (uint32_t i = 0; i < texture.mipLevels.size(); i++)
+			{
+				if (std::max(texture.mipLevels[i].width, texture.mipLevels[i].height) <= TEXTURE_MIP_TAIL_SIZE)
+				{
+					texture.tailMip = i;
+					break;
+				}
+			}
+		}
+		decodedImages.clear();
+	}
+
+	// the mip level a texture will have once its uploads are done
+	auto getPlannedMip = [](const Texture& texture) {
+		if (texture.uploading.image != VK_NULL_HANDLE)
+		{
+			return texture.uploading.firstMip;
+		}
+		return texture.resident.image != VK_NULL_HANDLE ? texture.resident.firstMip : static_cast<uint32_t>(texture.mipLevels.size());
+	};
+
+	// serve the most recently requested textures first
+	std::vector<uint32_t> handles;
+	VkDeviceSize plannedSize = 0;
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		if (!textures[i].mipLevels.empty())
+		{
+			handles.push_back(i);
+			plannedSize += getMipChainSize(textures[i], getPlannedMip(textures[i]));
+		}
+	}
+	std::stable_sort(handles.begin(), handles.end(), [this](uint32_t a, uint32_t b) {
+		return textures[a].lastRequestFrame > textures[b].lastRequestFrame;
+	});
+
+	UploadBatch batch;
+	for (uint32_t handle : handles)
+	{
+		Texture& texture = textures[handle];
+		if (texture.uploading.image != VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		// textures keep finer levels than requested until the budget needs
+		// the memory
+		uint32_t currentMip = getPlannedMip(texture);
+		uint32_t firstMip = getRequestedMip(texture);
+		if (firstMip >= currentMip)
+		{
+			continue;
+		}
+
+		// make room by dropping the least recently requested textures that
+		// were requested before this one to their mip tail; if there are none
+		// left settle for a coarser level (the mip tail always fits)
+		VkDeviceSize currentSize = getMipChainSize(texture, currentMip);
+		while (firstMip < texture.tailMip && plannedSize - currentSize + getMipChainSize(texture, firstMip) > vramBudget)
+		{
+			uint32_t victim = NO_TEXTURE;
+			for (uint32_t other : handles)
+			{
+				const Texture& otherTexture = textures[other];
+				if (other == handle || otherTexture.uploading.image != VK_NULL_HANDLE || otherTexture.resident.image == VK_NULL_HANDLE
+					|| otherTexture.resident.firstMip >= otherTexture.tailMip || otherTexture.lastRequestFrame >= texture.lastRequestFrame)
+				{
+					continue;
+				}
+				if (victim == NO_TEXTURE || otherTexture.lastRequestFrame < textures[victim].lastRequestFrame)
+				{
+					victim = other;
+				}
+			}
+
+			if (victim != NO_TEXTURE && uploadTexture(batch, victim, textures[victim].tailMip))
+			{
+				Texture& victimTexture = textures[victim];
+				plannedSize -= getMipChainSize(victimTexture, victimTexture.resident.firstMip) - getMipChainSize(victimTexture, victimTexture.tailMip);
+			}
+			else
+			{
+				firstMip++;
+			}
+		}
+		if (firstMip >= currentMip)
+		{
+			continue;
+		}
+
+		// stop once the staging ring is full, the rest is picked up by a
+		// later update
+		if (!uploadTexture(batch, handle, firstMip))
+		{
+			break;
+		}
+		plannedSize += getMipChainSize(texture, firstMip) - currentSize;
+	}
+	if (batch.commandBuffer != VK_NULL_HANDLE)
+	{
+		submitBatch(batch);
+	}
+
+	return bViewChanged;
+}
+
+void BkTextureStreamer::buildMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, std::vector<unsigned char>& mipPixels, std::vector<MipLevel>& mipLevels)
+{
+	static const std::vector<float> SRGB_TO_LINEAR = []() {
+		std::vector<float> table(256);
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return table;
+	}();
+	auto linearToSrgb = [](float c) {
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<unsigned char>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+	};
+
+	mipLevels.clear();
+	VkDeviceSize mipChainSize = 0;
+	for (uint32_t levelWidth = width, levelHeight = height; ; levelWidth = std::max(levelWidth / 2, 1u), levelHeight = std::max(levelHeight / 2, 1u))
+	{
+		mipLevels.push_back({ levelWidth, levelHeight, mipChainSize });
+		mipChainSize += static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+	}
+
+	mipPixels.resize(static_cast<size_t>(mipChainSize));
+	memcpy(mipPixels.data(), pixels, static_cast<size_t>(width) * height * 4);
+	for (size_t level = 1; level < mipLevels.size(); level++)
+	{
+		const MipLevel& src = mipLevels[level - 1];
+		const MipLevel& dst = mipLevels[level];
+		const unsigned char* srcPixels = mipPixels.data() + src.offset;
+		unsigned char* dstPixels = mipPixels.data() + dst.offset;
+		for (uint32_t y = 0; y < dst.height; y++)
+		{
+			for (uint32_t x = 0; x < dst.width; x++)
+			{
+				// average the 2x2 footprint, clamped for odd and 1 texel sides
+				uint32_t x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+				uint32_t y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+				const unsigned char* taps[4] = {
+					srcPixels + (static_cast<size_t>(y0) * src.width + x0) * 4, srcPixels + (static_cast<size_t>(y0) * src.width + x1) * 4,
+					srcPixels + (static_cast<size_t>(y1) * src.width + x0) * 4, srcPixels + (static_cast<size_t>(y1) * src.width + x1) * 4
+				};
+				unsigned char* texel = dstPixels + (static_cast<size_t>(y) * dst.width + x) * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					float sum = SRGB_TO_LINEAR[taps[0][c]] + SRGB_TO_LINEAR[taps[1][c]] + SRGB_TO_LINEAR[taps[2][c]] + SRGB_TO_LINEAR[taps[3][c]];
+					texel[c] = linearToSrgb(sum * 0.25f);
+				}
+				texel[3] = static_cast<unsigned char>((taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+			}
+		}
+	}
+}
+
+uint32_t BkTextureStreamer::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags memoryPropertyFlags)
+{
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+	for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+	{
+		if ((memoryTypeBits & (1 << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+		{
+			return i;
+		}
+	}
+	throw std::runtime_error("ERROR: failed to find suitable memory type for texture!");
+}
+
+void BkTextureStreamer::createBuffer(VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferDeviceMemory)
+{
+	VkBufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = deviceSize;
+	bufferCreateInfo.usage = bufferUsageFlags;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateBuffer' failed to create the texture staging buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, memoryPropertyFlags);
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &bufferDeviceMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to create device memory for the texture staging buffer!");
+	}
+	vkBindBufferMemory(device, buffer, bufferDeviceMemory, 0);
+}
+
+void BkTextureStreamer::createTextureImage(uint32_t width, uint32_t height, uint32_t mipLevelCount, TextureImage& textureImage)
+{
+	VkImageCreateInfo imageCreateInfo{};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.extent.width = width;
+	imageCreateInfo.extent.height = height;
+	imageCreateInfo.extent.depth = 1;
+	imageCreateInfo.mipLevels = mipLevelCount;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateImage(device, &imageCreateInfo, nullptr, &textureImage.image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateImage' failed to create texture image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, textureImage.image, &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo{};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &textureImage.imageDeviceMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateMemory' failed to allocate texture image memory!");
+	}
+	vkBindImageMemory(device, textureImage.image, textureImage.imageDeviceMemory, 0);
+
+	VkImageViewCreateInfo imageViewCreateInfo{};
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.image = textureImage.image;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+	imageViewCreateInfo.subresourceRange.levelCount = mipLevelCount;
+	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewCreateInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &textureImage.imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateImageView' failed to create texture image view!");
+	}
+}
+
+void BkTextureStreamer::destroyTextureImage(TextureImage& textureImage)
+{
+	if (textureImage.image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	vkDestroyImageView(device, textureImage.imageView, nullptr);
+	vkDestroyImage(device, textureImage.image, nullptr);
+	vkFreeMemory(device, textureImage.imageDeviceMemory, nullptr);
+	textureImage = TextureImage{};
+}
+
+bool BkTextureStreamer::allocateStagingRing(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& ringBytes)
+{
+	// the used bytes are a contiguous (wrapping) range ending at the head, so
+	// an allocation fits if it fits between the head and the oldest batch;
+	// the bytes skipped for alignment and at the wrap stay with the batch
+	VkDeviceSize alignedHead = (stagingRingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	VkDeviceSize padding = alignedHead - stagingRingHead;
+	if (alignedHead + size > stagingRingSize)
+	{
+		padding = stagingRingSize - stagingRingHead;
+		alignedHead = 0;
+	}
+	if (stagingRingUsed + padding + size > stagingRingSize)
+	{
+		return false;
+	}
+
+	offset = alignedHead;
+	stagingRingHead = alignedHead + size;
+	stagingRingUsed += padding + size;
+	ringBytes += padding + size;
+	return true;
+}
+
+void BkTextureStreamer::recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, const std::vector<VkBufferImageCopy>& bufferImageCopies, VkImage image)
+{
+	VkImageMemoryBarrier imageMemoryBarrier{};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.image = image;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+	imageMemoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = 1;
+	imageMemoryBarrier.srcAccessMask = 0;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferImageCopies.size()), bufferImageCopies.data());
+
+	// later submissions on the queue sample the image in the fragment shader
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+bool BkTextureStreamer::uploadTexture(UploadBatch& batch, uint32_t handle, uint32_t firstMip)
+{
+	Texture& texture = textures[handle];
+	const MipLevel& firstLevel = texture.mipLevels[firstMip];
+	VkDeviceSize stagingSize = getMipChainSize(texture, firstMip);
+	const unsigned char* stagingPixels = texture.pixels.data() + firstLevel.offset;
+
+	// the levels are stored consecutively, so the whole chain is one copy
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset = 0;
+	if (stagingSize > stagingRingSize)
+	{
+		VkDeviceMemory stagingBufferDeviceMemory;
+		createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferDeviceMemory);
+		void* stagingData;
+		vkMapMemory(device, stagingBufferDeviceMemory, 0, stagingSize, 0, &stagingData);
+		memcpy(stagingData, stagingPixels, static_cast<size_t>(stagingSize));
+		vkUnmapMemory(device, stagingBufferDeviceMemory);
+		batch.dedicatedBuffers.push_back(stagingBuffer);
+		batch.dedicatedBuffersDeviceMemory.push_back(stagingBufferDeviceMemory);
+	}
+	else if (allocateStagingRing(stagingSize, stagingOffset, batch.ringBytes))
+	{
+		stagingBuffer = stagingRingBuffer;
+		memcpy(stagingRingMapped + stagingOffset, stagingPixels, static_cast<size_t>(stagingSize));
+	}
+	else
+	{
+		return false;
+	}
+
+	if (batch.commandBuffer == VK_NULL_HANDLE)
+	{
+		beginBatch(batch);
+	}
+
+	// mip level 'firstMip' becomes level 0 of the new image, normalized
+	// texture coordinates are the same for every level
+	uint32_t mipLevelCount = static_cast<uint32_t>(texture.mipLevels.size()) - firstMip;
+	createTextureImage(firstLevel.width, firstLevel.height, mipLevelCount, texture.uploading);
+	texture.uploading.firstMip = firstMip;
+
+	std::vector<VkBufferImageCopy> bufferImageCopies(mipLevelCount);
+	for (uint32_t i = 0; i < mipLevelCount; i++)
+	{
+		const MipLevel& level = texture.mipLevels[firstMip + i];
+		VkBufferImageCopy& bufferImageCopy = bufferImageCopies[i];
+		bufferImageCopy.bufferOffset = stagingOffset + level.offset - firstLevel.offset;
+		bufferImageCopy.bufferRowLength = 0;
+		bufferImageCopy.bufferImageHeight = 0;
+		bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferImageCopy.imageSubresource.mipLevel = i;
+		bufferImageCopy.imageSubresource.baseArrayLayer = 0;
+		bufferImageCopy.imageSubresource.layerCount = 1;
+		bufferImageCopy.imageOffset = { 0, 0, 0 };
+		bufferImageCopy.imageExtent = { level.width, level.height, 1 };
+	}
+	recordUpload(batch.commandBuffer, stagingBuffer, bufferImageCopies, texture.uploading.image);
+	batch.handles.push_back(handle);
+	return true;
+}
+
+VkDeviceSize BkTextureStreamer::getMipChainSize(const Texture& texture, uint32_t firstMip) const
+{
+	if (firstMip >= texture.mipLevels.size())
+	{
+		return 0;
+	}
+	return texture.pixels.size() - texture.mipLevels[firstMip].offset;
+}
+
+uint32_t BkTextureStreamer::getRequestedMip(const Texture& texture) const
+{
+	// every level halves the texels per pixel; without a request only the
+	// mip tail is needed
+	if (texture.requestedScreenSize <= 0.0f)
+	{
+		return texture.tailMip;
+	}
+	float texelsPerPixel = std::max(texture.mipLevels[0].width, texture.mipLevels[0].height) / texture.requestedScreenSize;
+	if (texelsPerPixel <= 1.0f)
+	{
+		return 0;
+	}
+	return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), texture.tailMip);
+}
+
+void BkTextureStreamer::beginBatch(UploadBatch& batch)
+{
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandPool = commandPool;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &batch.commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkAllocateCommandBuffers' failed to allocate a texture upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo{};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.commandBuffer, &commandBufferBeginInfo);
+}
+
+void BkTextureStreamer::submitBatch(UploadBatch& batch)
+{
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(device, &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkCreateFence' failed to create a texture upload fence!");
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+	if (vkQueueSubmit(queue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("ERROR: 'vkQueueSubmit' failed to submit texture uploads!");
+	}
+	uploadBatches.push_back(std::move(batch));
+}
+
+bool BkTextureStreamer::retireBatches(bool bWait)
+{
+	bool bViewChanged = false;
+
+	// batches complete in submission order, so stop at the first one that
+	// is still in flight
+	while (!uploadBatches.empty())
+	{
+		UploadBatch& batch = uploadBatches.front();
+		if (bWait)
+		{
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		}
+		else if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		// swap in the uploaded images, the replaced ones may still be bound
+		for (uint32_t handle : batch.handles)
+		{
+			Texture& texture = textures[handle];
+			if (texture.resident.image != VK_NULL_HANDLE)
+			{
+				retiredImages.push_back({ texture.resident, frameIndex });
+			}
+			texture.resident = texture.uploading;
+			texture.uploading = TextureImage{};
+			bViewChanged = true;
+		}
+		stagingRingUsed -= batch.ringBytes;
+		if (stagingRingUsed == 0)
+		{
+			stagingRingHead = 0;
+		}
+		for (size_t i = 0; i < batch.dedicatedBuffers.size(); i++)
+		{
+			vkDestroyBuffer(device, batch.dedicatedBuffers[i], nullptr);
+			vkFreeMemory(device, batch.dedicatedBuffersDeviceMemory[i], nullptr);
+		}
+		vkFreeCommandBuffers(device, commandPool, 1, &batch.commandBuffer);
+		vkDestroyFence(device, batch.fence, nullptr);
+		uploadBatches.pop_front();
+	}
+	return bViewChanged;
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <memory>
+
+#include "BkThreadPool.h"
+
+// size of the persistently mapped staging ring the decoded images are copied
+// through; images that don't fit into it get a dedicated staging buffer
+const VkDeviceSize TEXTURE_STAGING_RING_SIZE = 32 * 1024 * 1024;
+
+// texel memory the resident mip levels of all textures may use; the least
+// recently requested textures drop to their mip tail to stay below it
+const VkDeviceSize TEXTURE_VRAM_BUDGET = 256 * 1024 * 1024;
+
+// mip levels whose larger side is at most this many texels form the mip tail
+// which stays resident as long as the texture exists
+const uint32_t TEXTURE_MIP_TAIL_SIZE = 64;
+
+// loads textures asynchronously; images are decoded on worker threads, copied
+// into a staging ring and uploaded with fenced transfers on the render thread,
+// a placeholder texture is returned until an image is resident; only the mip
+// levels requested for the current view are kept in video memory
+class BkTextureStreamer
+{
+private:
+	struct MipLevel {
+		uint32_t width;
+		uint32_t height;
+		VkDeviceSize offset;
+	};
+
+	// image holding the mip levels [firstMip, mipLevels.size()) of a texture
+	struct TextureImage {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory imageDeviceMemory = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		uint32_t firstMip = 0;
+	};
+
+	struct Texture {
+		std::string path;
+
+		// decoded mip chain in system memory, empty until the worker is done
+		std::vector<unsigned char> pixels;
+		std::vector<MipLevel> mipLevels;
+		uint32_t tailMip = 0;
+
+		// 'resident' is sampled, 'uploading' replaces it once its batch retires
+		TextureImage resident;
+		TextureImage uploading;
+
+		float requestedScreenSize = 0.0f;
+		uint64_t lastRequestFrame = 0;
+	};
+
+	// mip chain built by a worker that waits to be handed to its texture
+	struct DecodedImage {
+		uint32_t handle;
+		std::vector<unsigned char> pixels;
+		std::vector<MipLevel> mipLevels;
+	};
+
+	// replaced image that in-flight frames may still sample
+	struct RetiredImage {
+		TextureImage image;
+		uint64_t frame;
+	};
+
+	// one submission of uploads; the ring space and the staging buffers are
+	// released once its fence is signaled
+	struct UploadBatch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		VkDeviceSize ringBytes = 0;
+		std::vector<uint32_t> handles;
+		std::vector<VkBuffer> dedicatedBuffers;
+		std::vector<VkDeviceMemory> dedicatedBuffersDeviceMemory;
+	};
+
+	VkDevice device;
+	VkPhysicalDevice physicalDevice;
+	VkQueue queue;
+	uint32_t framesInFlight;
+	VkDeviceSize vramBudget;
+
+	VkCommandPool commandPool;
+
+	VkBuffer stagingRingBuffer;
+	VkDeviceMemory stagingRingBufferDeviceMemory;
+	unsigned char* stagingRingMapped;
+	VkDeviceSize stagingRingSize;
+	VkDeviceSize stagingRingHead = 0;
+	VkDeviceSize stagingRingUsed = 0;
+
+	TextureImage placeholder;
+	std::vector<Texture> textures;
+	std::deque<RetiredImage> retiredImages;
+	uint64_t frameIndex = 0;
+
+	// written by the workers, drained by update()
+	std::mutex decodedImagesMutex;
+	std::vector<DecodedImage> decodedImages;
+
+	std::deque<UploadBatch> uploadBatches;
+
+	std::unique_ptr<BkThreadPool> threadPool;
+
+	// box filter the decoded image down to 1x1 (in linear space for the color
+	// channels since the textures are sRGB)
+	static void buildMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, std::vector<unsigned char>& mipPixels, std::vector<MipLevel>& mipLevels);
+
+	uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags memoryPropertyFlags);
+
+	void createBuffer(VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferDeviceMemory);
+
+	void createTextureImage(uint32_t width, uint32_t height, uint32_t mipLevelCount, TextureImage& textureImage);
+
+	void destroyTextureImage(TextureImage& textureImage);
+
+	bool allocateStagingRing(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& ringBytes);
+
+	void recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, const std::vector<VkBufferImageCopy>& bufferImageCopies, VkImage image);
+
+	// stage the mip levels [firstMip, tail] of a texture into a new image;
+	// returns false if the staging ring is full
+	bool uploadTexture(UploadBatch& batch, uint32_t handle, uint32_t firstMip);
+
+	// texel bytes of the mip levels [firstMip, tail]
+	VkDeviceSize getMipChainSize(const Texture& texture, uint32_t firstMip) const;
+
+	// finest mip level the texture needs for its requested screen size
+	uint32_t getRequestedMip(const Texture& texture) const;
+
+	void beginBatch(UploadBatch& batch);
+
+	void submitBatch(UploadBatch& batch);
+
+	bool retireBatches(bool bWait);
+
+public:
+	// uploads go to 'queue' which has to be externally synchronized with the
+	// other submissions, so update() must run on the thread that submits
+	// frames, once per frame after waiting for the frame's fence
+	BkTextureStreamer(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex, uint32_t framesInFlight, VkDeviceSize vramBudget = TEXTURE_VRAM_BUDGET, uint32_t workerCount = 0, VkDeviceSize stagingRingSize = TEXTURE_STAGING_RING_SIZE);
+	~BkTextureStreamer();
+
+	// queue an image file for decoding and return its handle
+	uint32_t requestTexture(const std::string& path);
+
+	// request the detail needed to cover 'screenSize' pixels with the whole
+	// texture this frame; the largest request of a frame wins
+	void requestScreenSize(uint32_t handle, float screenSize);
+
+	bool isResident(uint32_t handle) const;
+
+	// image view of the texture, or of the placeholder while it isn't resident;
+	// the view changes whenever the resident mip levels change
+	VkImageView getImageView(uint32_t handle) const;
+
+	// texel bytes of the resident and uploading mip levels of all textures
+	VkDeviceSize getResidentSize() const;
+
+	// retire finished uploads, destroy replaced images and submit uploads for
+	// newly decoded textures and changed mip requests; returns true if a
+	// texture's image view changed
+	bool update();
+};
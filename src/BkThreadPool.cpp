@@ -0,0 +1,58 @@
+#include "BkThreadPool.h"
+#include <algorithm>
+
+BkThreadPool::BkThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&BkThreadPool::workerLoop, this);
+	}
+}
+
+BkThreadPool::~BkThreadPool()
+{
+	// let the workers finish the queued tasks before joining them
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		bStopping = true;
+	}
+	tasksCondition.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void BkThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		tasks.push(std::move(task));
+	}
+	tasksCondition.notify_one();
+}
+
+void BkThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(tasksMutex);
+			tasksCondition.wait(lock, [this] { return bStopping || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// fixed size pool of worker threads executing tasks in submission order
+class BkThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex tasksMutex;
+	std::condition_variable tasksCondition;
+	bool bStopping = false;
+
+	void workerLoop();
+
+public:
+	// a thread count of 0 uses one thread per hardware thread except the
+	// calling one
+	BkThreadPool(uint32_t threadCount = 0);
+	~BkThreadPool();
+
+	void submit(std::function<void()> task);
+};
@@ -0,0 +1,251 @@
+#include "BkTransformHierarchy.h"
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BK_TRANSFORM_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// the AVX2 functions are compiled for AVX2 and FMA without requiring them for
+// the rest of the library, they are only called once the CPU is checked
+#if defined(BK_TRANSFORM_AVX2) && (defined(__GNUC__) || defined(__clang__))
+#define BK_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define BK_TARGET_AVX2
+#endif
+
+#ifdef BK_TRANSFORM_AVX2
+static bool isAvx2Supported()
+{
+#if defined(_MSC_VER)
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 1);
+	bool bFma = (cpuInfo[2] & (1 << 12)) != 0;
+	bool bOsxsave = (cpuInfo[2] & (1 << 27)) != 0;
+
+	// the OS has to save the upper halves of the ymm registers
+	if (!bFma || !bOsxsave || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+	__cpuidex(cpuInfo, 7, 0);
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+// c = a * b for column major 4x4 matrices, two columns of c at a time: each
+// is the sum of the columns of a scaled by the matching column of b
+BK_TARGET_AVX2 static inline void multiplyMatrixAvx2(const float* a, const float* b, float* c)
+{
+	// both 128 bit lanes hold the same column of a
+	__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 0));
+	__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+	__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+	__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+	for (int column = 0; column < 4; column += 2)
+	{
+		// columns 'column' and 'column + 1' of b, each element is splat
+		// across its lane
+		__m256 b01 = _mm256_loadu_ps(b + 4 * column);
+		__m256 result = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+		result = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55), result);
+		result = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA), result);
+		result = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF), result);
+		_mm256_storeu_ps(c + 4 * column, result);
+	}
+}
+
+BK_TARGET_AVX2 static void multiplyBatchAvx2(const uint32_t* batch, uint32_t batchSize, const uint32_t* parents, const glm::mat4* localMatrices, glm::mat4* worldMatrices)
+{
+	for (uint32_t i = 0; i < batchSize; i++)
+	{
+		uint32_t node = batch[i];
+		uint32_t parent = parents[node];
+		if (parent == TRANSFORM_NO_PARENT)
+		{
+			worldMatrices[node] = localMatrices[node];
+			continue;
+		}
+
+		// prefetch the next node's matrices while this one is multiplied
+		if (i + 1 < batchSize)
+		{
+			_mm_prefetch(reinterpret_cast<const char*>(&localMatrices[batch[i + 1]]), _MM_HINT_T0);
+		}
+		multiplyMatrixAvx2(&worldMatrices[parent][0][0], &localMatrices[node][0][0], &worldMatrices[node][0][0]);
+	}
+}
+#endif
+
+static void multiplyBatch(const uint32_t* batch, uint32_t batchSize, const uint32_t* parents, const glm::mat4* localMatrices, glm::mat4* worldMatrices)
+{
+	for (uint32_t i = 0; i < batchSize; i++)
+	{
+		uint32_t node = batch[i];
+		uint32_t parent = parents[node];
+		worldMatrices[node] = parent == TRANSFORM_NO_PARENT ? localMatrices[node] : worldMatrices[parent] * localMatrices[node];
+	}
+}
+
+BkTransformHierarchy::BkTransformHierarchy(uint32_t framesInFlight, bool bAllowSimd)
+	: framesInFlight(framesInFlight), bSimd(false)
+{
+	if (framesInFlight == 0 || framesInFlight > TRANSFORM_MAX_FRAMES)
+	{
+		throw std::runtime_error("ERROR: a transform hierarchy supports 1 to " + std::to_string(TRANSFORM_MAX_FRAMES) + " frames in flight!");
+	}
+
+#ifdef BK_TRANSFORM_AVX2
+	bSimd = bAllowSimd && isAvx2Supported();
+#else
+	(void)bAllowSimd;
+#endif
+	batch.reserve(TRANSFORM_BATCH_SIZE);
+}
+
+uint32_t BkTransformHierarchy::addNode(uint32_t parent, const glm::mat4& localMatrix)
+{
+	uint32_t node = static_cast<uint32_t>(parents.size());
+	if (parent != TRANSFORM_NO_PARENT && parent >= node)
+	{
+		throw std::runtime_error("ERROR: the parent of a transform has to be added before it!");
+	}
+
+	parents.push_back(parent);
+	localMatrices.push_back(localMatrix);
+	worldMatrices.push_back(glm::mat4(1.0f));
+	localDirty.push_back(1);
+	staleFrames.push_back(0);
+	worldDirty.push_back(0);
+	firstDirtyNode = std::min(firstDirtyNode, node);
+	return node;
+}
+
+void BkTransformHierarchy::setLocalMatrix(uint32_t node, const glm::mat4& localMatrix)
+{
+	localMatrices[node] = localMatrix;
+	localDirty[node] = 1;
+	firstDirtyNode = std::min(firstDirtyNode, node);
+}
+
+void BkTransformHierarchy::setLocalTransform(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	glm::mat4 localMatrix = glm::mat4_cast(rotation);
+	localMatrix[0] *= scale.x;
+	localMatrix[1] *= scale.y;
+	localMatrix[2] *= scale.z;
+	localMatrix[3] = glm::vec4(position, 1.0f);
+	setLocalMatrix(node, localMatrix);
+}
+
+const glm::mat4& BkTransformHierarchy::getWorldMatrix(uint32_t node) const
+{
+	return worldMatrices[node];
+}
+
+uint32_t BkTransformHierarchy::getNodeCount() const
+{
+	return static_cast<uint32_t>(parents.size());
+}
+
+bool BkTransformHierarchy::isSimdEnabled() const
+{
+	return bSimd;
+}
+
+void BkTransformHierarchy::flushBatch()
+{
+	if (batch.empty())
+	{
+		return;
+	}
+
+#ifdef BK_TRANSFORM_AVX2
+	if (bSimd)
+	{
+		multiplyBatchAvx2(batch.data(), static_cast<uint32_t>(batch.size()), parents.data(), localMatrices.data(), worldMatrices.data());
+	}
+	else
+#endif
+	{
+		multiplyBatch(batch.data(), static_cast<uint32_t>(batch.size()), parents.data(), localMatrices.data(), worldMatrices.data());
+	}
+
+	uint8_t allFrames = static_cast<uint8_t>((1u << framesInFlight) - 1);
+	for (uint32_t node : batch)
+	{
+		staleFrames[node] = allFrames;
+	}
+	batch.clear();
+}
+
+uint32_t BkTransformHierarchy::update()
+{
+	uint32_t nodeCount = getNodeCount();
+	uint32_t updatedCount = 0;
+
+	// the batch's nodes are independent as long as none of them is the
+	// parent of the next one, which is flushed first otherwise
+	uint32_t batchFirstNode = TRANSFORM_NO_PARENT;
+	for (uint32_t node = firstDirtyNode; node < nodeCount; node++)
+	{
+		// the parents before the first dirty node haven't changed, their dirty
+		// flags are left over from an earlier update
+		uint32_t parent = parents[node];
+		bool bParentDirty = parent != TRANSFORM_NO_PARENT && parent >= firstDirtyNode && worldDirty[parent];
+		bool bDirty = localDirty[node] || bParentDirty;
+		worldDirty[node] = bDirty;
+		if (!bDirty)
+		{
+			continue;
+		}
+		localDirty[node] = 0;
+
+		if (bParentDirty && !batch.empty() && parent >= batchFirstNode)
+		{
+			flushBatch();
+		}
+		if (batch.empty())
+		{
+			batchFirstNode = node;
+		}
+		batch.push_back(node);
+		updatedCount++;
+
+		if (batch.size() == TRANSFORM_BATCH_SIZE)
+		{
+			flushBatch();
+		}
+	}
+	flushBatch();
+
+	firstDirtyNode = nodeCount;
+	return updatedCount;
+}
+
+uint32_t BkTransformHierarchy::writeInstances(uint32_t frame, glm::mat4* instanceMatrices)
+{
+	uint8_t frameBit = static_cast<uint8_t>(1u << frame);
+	uint32_t writtenCount = 0;
+	for (uint32_t node = 0; node < staleFrames.size(); node++)
+	{
+		if (staleFrames[node] & frameBit)
+		{
+			// a plain copy, mapped memory may be write combined and shouldn't
+			// be read back
+			std::memcpy(&instanceMatrices[node], &worldMatrices[node], sizeof(glm::mat4));
+			staleFrames[node] &= static_cast<uint8_t>(~frameBit);
+			writtenCount++;
+		}
+	}
+	return writtenCount;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+const uint32_t TRANSFORM_NO_PARENT = UINT32_MAX;
+
+// dirty nodes whose world matrices are multiplied in one go
+const uint32_t TRANSFORM_BATCH_SIZE = 64;
+
+// instance buffers the hierarchy tracks separately, one per frame in flight
+const uint32_t TRANSFORM_MAX_FRAMES = 8;
+
+// parent/child transforms stored as structure of arrays in topological order
+// (a node is always added after its parent), so one forward pass computes
+// every world matrix after its parent's; only nodes whose local matrix
+// changed and their descendants are recomputed, with AVX2 if the CPU has it
+class BkTransformHierarchy
+{
+private:
+	uint32_t framesInFlight;
+	bool bSimd;
+
+	// indexed by node, the node index is also its instance index
+	std::vector<uint32_t> parents;
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<uint8_t> localDirty;
+
+	// a bit per frame in flight whose instance buffer doesn't have the
+	// node's current world matrix yet
+	std::vector<uint8_t> staleFrames;
+
+	// nodes before it have no changed local matrix
+	uint32_t firstDirtyNode = 0;
+
+	// scratch of update()
+	std::vector<uint8_t> worldDirty;
+	std::vector<uint32_t> batch;
+
+	// compute the world matrices of the batched nodes, none of them is the
+	// parent of another
+	void flushBatch();
+
+public:
+	// 'framesInFlight' instance buffers are kept up to date by
+	// writeInstances(); the SIMD path is only used if 'bAllowSimd' is set and
+	// the CPU supports AVX2 and FMA
+	BkTransformHierarchy(uint32_t framesInFlight = 1, bool bAllowSimd = true);
+
+	BkTransformHierarchy(const BkTransformHierarchy&) = delete;
+	BkTransformHierarchy& operator=(const BkTransformHierarchy&) = delete;
+
+	// 'parent' has to be an existing node or TRANSFORM_NO_PARENT
+	uint32_t addNode(uint32_t parent = TRANSFORM_NO_PARENT, const glm::mat4& localMatrix = glm::mat4(1.0f));
+
+	void setLocalMatrix(uint32_t node, const glm::mat4& localMatrix);
+
+	void setLocalTransform(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+	// the world matrix as of the last update()
+	const glm::mat4& getWorldMatrix(uint32_t node) const;
+
+	uint32_t getNodeCount() const;
+
+	bool isSimdEnabled() const;
+
+	// recompute the world matrices of the changed nodes and their
+	// descendants, returns how many were recomputed
+	uint32_t update();
+
+	// write every world matrix that changed since the last write to this
+	// frame's buffer to 'instanceMatrices[node]', usually a persistently
+	// mapped instance buffer; returns how many were written
+	uint32_t writeInstances(uint32_t frame, glm::mat4* instanceMatrices);
+};
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "BkBench.h"
+#include "BkDeviceSelector.h"
+
+// value of '--name value' or '--name=value', empty if the option isn't given
+static std::string getOption(int argc, char* argv[], const std::string& option)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == option && i + 1 < argc)
+		{
+			return argv[i + 1];
+		}
+		if (argument.compare(0, option.size() + 1, option + "=") == 0)
+		{
+			return argument.substr(option.size() + 1);
+		}
+	}
+	return "";
+}
+
+static void printUsage()
+{
+	std::cerr << "usage: BulkanBench [options]\n"
+		<< "  --scene <name>        run only this scene (default: all)\n"
+		<< "  --frames <count>      timed frames per scene (default: " << BENCH_FRAME_COUNT << ")\n"
+		<< "  --warmup <count>      untimed frames before them (default: " << BENCH_WARMUP_FRAME_COUNT << ")\n"
+		<< "  --output <path>       write the JSON there instead of stdout\n"
+		<< "  --baseline <path>     compare against an earlier JSON, exits with 1 on a regression\n"
+		<< "  --threshold <percent> slowdown that counts as a regression (default: " << BENCH_REGRESSION_THRESHOLD * 100.0 << ")\n"
+		<< "  " << DEVICE_OVERRIDE_OPTION << " <index|name>   run on this device (or set " << DEVICE_OVERRIDE_ENV << ")\n"
+		<< "scenes:";
+	for (const BkBenchScene& scene : BENCH_SCENES)
+	{
+		std::cerr << " " << scene.name;
+	}
+	std::cerr << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return EXIT_SUCCESS;
+		}
+	}
+
+	try
+	{
+		std::string sceneName = getOption(argc, argv, "--scene");
+		std::string frames = getOption(argc, argv, "--frames");
+		std::string warmup = getOption(argc, argv, "--warmup");
+		std::string outputPath = getOption(argc, argv, "--output");
+		std::string baselinePath = getOption(argc, argv, "--baseline");
+		std::string threshold = getOption(argc, argv, "--threshold");
+		uint32_t frameCount = frames.empty() ? BENCH_FRAME_COUNT : static_cast<uint32_t>(std::stoul(frames));
+		uint32_t warmupFrameCount = warmup.empty() ? BENCH_WARMUP_FRAME_COUNT : static_cast<uint32_t>(std::stoul(warmup));
+		double regressionThreshold = threshold.empty() ? BENCH_REGRESSION_THRESHOLD : std::stod(threshold) / 100.0;
+
+		std::vector<BkBenchScene> scenes;
+		for (const BkBenchScene& scene : BENCH_SCENES)
+		{
+			if (sceneName.empty() || scene.name == sceneName)
+			{
+				scenes.push_back(scene);
+			}
+		}
+		if (scenes.empty())
+		{
+			printUsage();
+			throw std::runtime_error("ERROR: unknown scene '" + sceneName + "'!");
+		}
+
+		// progress and the renderer's output go to stderr so stdout only
+		// carries the JSON
+		std::streambuf* coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+		std::vector<BkBenchResult> results;
+		std::string deviceName;
+		try
+		{
+			BkBench bench(getDeviceOverride(argc, argv));
+			deviceName = bench.getDeviceName();
+			std::cerr << "running on '" << deviceName << "'" << std::endl;
+			for (const BkBenchScene& scene : scenes)
+			{
+				std::cerr << "  " << scene.name << " (camera at " << scene.startDistance << " to " << scene.endDistance << ")" << std::endl;
+				results.push_back(bench.run(scene, frameCount, warmupFrameCount));
+			}
+		}
+		catch (...)
+		{
+			std::cout.rdbuf(coutBuffer);
+			throw;
+		}
+		std::cout.rdbuf(coutBuffer);
+
+		if (outputPath.empty())
+		{
+			writeBenchJson(std::cout, deviceName, results);
+		}
+		else
+		{
+			std::ofstream file(outputPath);
+			if (!file.is_open())
+			{
+				throw std::runtime_error("ERROR: failed to open '" + outputPath + "'!");
+			}
+			writeBenchJson(file, deviceName, results);
+		}
+
+		if (!baselinePath.empty())
+		{
+			std::cerr << "compared to '" << baselinePath << "':" << std::endl;
+			if (!compareBenchResults(results, readBenchJson(baselinePath), regressionThreshold))
+			{
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BkBvh.h"
+#include "BkJobSystem.h"
+
+// scene instances scattered over a cube and a heightfield mesh of two
+// triangles per grid cell, both BVH_BENCH_WORLD_SIZE wide
+const uint32_t BVH_BENCH_INSTANCE_COUNT = 100000;
+const uint32_t BVH_BENCH_GRID_SIZE = 512;
+const float BVH_BENCH_WORLD_SIZE = 1000.0f;
+
+const uint32_t BVH_BENCH_FRUSTUM_COUNT = 1000;
+const uint32_t BVH_BENCH_RAY_COUNT = 100000;
+
+// the brute force references only run a fraction of the queries
+const uint32_t BVH_BENCH_BRUTE_FORCE_DIVISOR = 100;
+
+// every build is repeated, the median is reported
+const uint32_t BVH_BENCH_REPEAT_COUNT = 5;
+
+static double getMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static double getElapsedMs(std::chrono::high_resolution_clock::time_point startTime)
+{
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+static void createInstanceBounds(std::mt19937& random, std::vector<BkAabb>& bounds)
+{
+	std::uniform_real_distribution<float> position(0.0f, BVH_BENCH_WORLD_SIZE);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+	bounds.resize(BVH_BENCH_INSTANCE_COUNT);
+	for (BkAabb& aabb : bounds)
+	{
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		aabb.min = center - extent;
+		aabb.max = center + extent;
+	}
+}
+
+static void createHeightfield(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	float cellSize = BVH_BENCH_WORLD_SIZE / BVH_BENCH_GRID_SIZE;
+	for (uint32_t y = 0; y <= BVH_BENCH_GRID_SIZE; y++)
+	{
+		for (uint32_t x = 0; x <= BVH_BENCH_GRID_SIZE; x++)
+		{
+			Vertex vertex{};
+			vertex.pos = glm::vec3(x * cellSize, y * cellSize, 20.0f * std::sin(x * 0.05f) * std::cos(y * 0.07f));
+			vertices.push_back(vertex);
+		}
+	}
+	for (uint32_t y = 0; y < BVH_BENCH_GRID_SIZE; y++)
+	{
+		for (uint32_t x = 0; x < BVH_BENCH_GRID_SIZE; x++)
+		{
+			uint32_t corner = y * (BVH_BENCH_GRID_SIZE + 1) + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + BVH_BENCH_GRID_SIZE + 2, corner, corner + BVH_BENCH_GRID_SIZE + 2, corner + BVH_BENCH_GRID_SIZE + 1 });
+		}
+	}
+}
+
+// milliseconds for a serial build, a build on the job system and a refit
+static void benchBuild(const char* name, const std::vector<BkAabb>& bounds, BkJobSystem& jobSystem)
+{
+	BkBvh bvh;
+	std::vector<double> serialTimes;
+	std::vector<double> parallelTimes;
+	std::vector<double> refitTimes;
+	for (uint32_t i = 0; i < BVH_BENCH_REPEAT_COUNT; i++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		bvh.build(bounds);
+		serialTimes.push_back(getElapsedMs(startTime));
+
+		startTime = std::chrono::high_resolution_clock::now();
+		bvh.build(bounds, &jobSystem);
+		parallelTimes.push_back(getElapsedMs(startTime));
+
+		startTime = std::chrono::high_resolution_clock::now();
+		bvh.refit(bounds);
+		refitTimes.push_back(getElapsedMs(startTime));
+	}
+
+	std::cout << std::setw(12) << name
+		<< std::setw(12) << bounds.size()
+		<< std::setw(10) << bvh.getNodeCount()
+		<< std::setw(12) << getMedian(serialTimes)
+		<< std::setw(12) << getMedian(parallelTimes)
+		<< std::setw(12) << getMedian(refitTimes) << std::endl;
+}
+
+static void benchFrustumCulling(std::mt19937& random, const std::vector<BkAabb>& bounds, const BkBvh& bvh)
+{
+	std::uniform_real_distribution<float> position(0.0f, BVH_BENCH_WORLD_SIZE);
+	std::vector<BkFrustum> frustums(BVH_BENCH_FRUSTUM_COUNT);
+	for (BkFrustum& frustum : frustums)
+	{
+		glm::vec3 eye(position(random), position(random), position(random));
+		glm::vec3 target(position(random), position(random), position(random));
+		glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, BVH_BENCH_WORLD_SIZE * 0.3f);
+		frustum = extractFrustum(proj * glm::lookAt(eye, target, glm::vec3(0.0f, 0.0f, 1.0f)));
+	}
+
+	std::vector<uint32_t> visiblePrimitives;
+	size_t visibleCount = 0;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (const BkFrustum& frustum : frustums)
+	{
+		visiblePrimitives.clear();
+		bvh.cullFrustum(frustum, visiblePrimitives);
+		visibleCount += visiblePrimitives.size();
+	}
+	double bvhTime = getElapsedMs(startTime) * 1000.0 / BVH_BENCH_FRUSTUM_COUNT;
+
+	// every bounding box against every plane
+	uint32_t bruteForceCount = std::max(BVH_BENCH_FRUSTUM_COUNT / BVH_BENCH_BRUTE_FORCE_DIVISOR, 1u);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < bruteForceCount; i++)
+	{
+		visiblePrimitives.clear();
+		for (uint32_t primitive = 0; primitive < bounds.size(); primitive++)
+		{
+			bool bVisible = true;
+			for (const glm::vec4& plane : frustums[i].planes)
+			{
+				const BkAabb& aabb = bounds[primitive];
+				glm::vec3 corner(plane.x >= 0.0f ? aabb.max.x : aabb.min.x, plane.y >= 0.0f ? aabb.max.y : aabb.min.y, plane.z >= 0.0f ? aabb.max.z : aabb.min.z);
+				bVisible = bVisible && glm::dot(glm::vec3(plane.x, plane.y, plane.z), corner) + plane.w >= 0.0f;
+			}
+			if (bVisible)
+			{
+				visiblePrimitives.push_back(primitive);
+			}
+		}
+	}
+	double bruteForceTime = getElapsedMs(startTime) * 1000.0 / bruteForceCount;
+
+	std::cout << "frustum culling: " << bvhTime << " us per frustum (brute force " << bruteForceTime << " us), "
+		<< visibleCount / BVH_BENCH_FRUSTUM_COUNT << " visible on average" << std::endl;
+}
+
+static void benchRayPicking(std::mt19937& random, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const BkBvh& bvh)
+{
+	// rays from above the heightfield, tilted up to 45 degrees
+	std::uniform_real_distribution<float> position(0.0f, BVH_BENCH_WORLD_SIZE);
+	std::uniform_real_distribution<float> tilt(-1.0f, 1.0f);
+	std::vector<glm::vec3> origins(BVH_BENCH_RAY_COUNT);
+	std::vector<glm::vec3> directions(BVH_BENCH_RAY_COUNT);
+	for (uint32_t i = 0; i < BVH_BENCH_RAY_COUNT; i++)
+	{
+		origins[i] = glm::vec3(position(random), position(random), 100.0f);
+		directions[i] = glm::normalize(glm::vec3(tilt(random), tilt(random), -1.0f));
+	}
+
+	auto intersectTriangle = [&](uint32_t ray, uint32_t triangle, float& distance)
+	{
+		return intersectRayTriangle(origins[ray], directions[ray], vertices[indices[3 * triangle]].pos, vertices[indices[3 * triangle + 1]].pos, vertices[indices[3 * triangle + 2]].pos, distance);
+	};
+
+	uint32_t hitCount = 0;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < BVH_BENCH_RAY_COUNT; i++)
+	{
+		float distance = FLT_MAX;
+		uint32_t triangle = bvh.intersectRay(origins[i], directions[i], distance, [&](uint32_t primitive, float& primitiveDistance)
+		{
+			return intersectTriangle(i, primitive, primitiveDistance);
+		});
+		hitCount += triangle != BVH_NO_HIT;
+	}
+	double bvhRate = BVH_BENCH_RAY_COUNT / (getElapsedMs(startTime) / 1000.0);
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	uint32_t bruteForceCount = std::max(BVH_BENCH_RAY_COUNT / BVH_BENCH_BRUTE_FORCE_DIVISOR / BVH_BENCH_BRUTE_FORCE_DIVISOR, 1u);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < bruteForceCount; i++)
+	{
+		float distance = FLT_MAX;
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			intersectTriangle(i, triangle, distance);
+		}
+	}
+	double bruteForceRate = bruteForceCount / (getElapsedMs(startTime) / 1000.0);
+
+	std::cout << std::setprecision(0) << "ray picking: " << bvhRate << " rays/s (brute force " << bruteForceRate << " rays/s), "
+		<< hitCount * 100 / BVH_BENCH_RAY_COUNT << "% hit" << std::setprecision(3) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--help" || argument == "-h")
+		{
+			std::cerr << "usage: BulkanBvhBench\n"
+				<< "  builds BVHs over " << BVH_BENCH_INSTANCE_COUNT << " instance bounds and a " << BVH_BENCH_GRID_SIZE << "x" << BVH_BENCH_GRID_SIZE
+				<< " heightfield and measures frustum culling and ray picking against them" << std::endl;
+			return EXIT_SUCCESS;
+		}
+	}
+
+	try
+	{
+		BkJobSystem jobSystem;
+		std::mt19937 random(1);
+
+		std::vector<BkAabb> instanceBounds;
+		createInstanceBounds(random, instanceBounds);
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		createHeightfield(vertices, indices);
+		std::vector<BkAabb> triangleBounds;
+		computeTriangleBounds(vertices, indices, 0, static_cast<uint32_t>(indices.size()), triangleBounds);
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "build (ms, " << jobSystem.getWorkerCount() << " workers for the parallel build)\n"
+			<< std::setw(12) << "primitives" << std::setw(12) << "count" << std::setw(10) << "nodes"
+			<< std::setw(12) << "serial" << std::setw(12) << "parallel" << std::setw(12) << "refit" << std::endl;
+		benchBuild("instances", instanceBounds, jobSystem);
+		benchBuild("triangles", triangleBounds, jobSystem);
+		std::cout << std::endl;
+
+		BkBvh instanceBvh;
+		instanceBvh.build(instanceBounds, &jobSystem);
+		benchFrustumCulling(random, instanceBounds, instanceBvh);
+
+		BkBvh triangleBvh;
+		triangleBvh.build(triangleBounds, &jobSystem);
+		benchRayPicking(random, vertices, indices, triangleBvh);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+
+#include "BkJobSystem.h"
+
+// empty jobs spawned per spawn overhead run
+const uint32_t JOB_BENCH_SPAWN_COUNT = 100000;
+
+// elements of the scaling workload and elements per job
+const uint32_t JOB_BENCH_ELEMENT_COUNT = 1 << 20;
+const uint32_t JOB_BENCH_BATCH_SIZE = 4096;
+
+// every measurement is repeated, the median is reported
+const uint32_t JOB_BENCH_REPEAT_COUNT = 9;
+
+static double getMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static double getElapsedMs(std::chrono::high_resolution_clock::time_point startTime)
+{
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+// nanoseconds per job to spawn 'spawnCount' empty jobs from the creating
+// thread and wait for them, and the same with every job spawned by a job
+static void benchSpawnOverhead(uint32_t workerCount, uint32_t spawnCount, uint32_t repeatCount)
+{
+	BkJobSystem jobSystem(workerCount - 1);
+
+	std::vector<double> flatTimes;
+	std::vector<double> nestedTimes;
+	for (uint32_t i = 0; i < repeatCount; i++)
+	{
+		BkJobCounter counter;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t j = 0; j < spawnCount; j++)
+		{
+			jobSystem.run(counter, []() {});
+		}
+		jobSystem.wait(counter);
+		flatTimes.push_back(getElapsedMs(startTime) * 1e6 / spawnCount);
+
+		// spawned from the workers, so the jobs are pushed to and stolen from
+		// every deque instead of only the creating thread's
+		BkJobCounter nestedCounter;
+		uint32_t parentCount = std::max(spawnCount / 1000, 1u);
+		startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t j = 0; j < parentCount; j++)
+		{
+			jobSystem.run(nestedCounter, [&jobSystem, &nestedCounter]()
+			{
+				for (uint32_t k = 0; k < 1000; k++)
+				{
+					jobSystem.run(nestedCounter, []() {});
+				}
+			});
+		}
+		jobSystem.wait(nestedCounter);
+		nestedTimes.push_back(getElapsedMs(startTime) * 1e6 / (parentCount * 1001));
+	}
+
+	std::cout << std::setw(8) << workerCount
+		<< std::setw(14) << getMedian(flatTimes)
+		<< std::setw(14) << getMedian(nestedTimes) << std::endl;
+}
+
+// milliseconds for a parallelFor over a compute bound loop
+static double benchScaling(uint32_t workerCount, std::vector<float>& values, uint32_t repeatCount)
+{
+	BkJobSystem jobSystem(workerCount - 1);
+
+	std::vector<double> times;
+	for (uint32_t i = 0; i < repeatCount; i++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		jobSystem.parallelFor(static_cast<uint32_t>(values.size()), JOB_BENCH_BATCH_SIZE, [&values](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t j = begin; j < end; j++)
+			{
+				float value = static_cast<float>(j);
+				for (uint32_t k = 0; k < 32; k++)
+				{
+					value = std::sqrt(value * 1.0001f + 1.0f);
+				}
+				values[j] = value;
+			}
+		});
+		times.push_back(getElapsedMs(startTime));
+	}
+	return getMedian(times);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t maxWorkerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--help" || argument == "-h")
+		{
+			std::cerr << "usage: BulkanJobBench [--workers <count>]\n"
+				<< "  --workers <count>  largest worker count to measure (default: " << maxWorkerCount << ")" << std::endl;
+			return EXIT_SUCCESS;
+		}
+		if (argument == "--workers" && i + 1 < argc)
+		{
+			maxWorkerCount = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+		}
+	}
+
+	try
+	{
+		// 1, 2, 4, ... workers and the largest count
+		std::vector<uint32_t> workerCounts;
+		for (uint32_t workerCount = 1; workerCount < maxWorkerCount; workerCount *= 2)
+		{
+			workerCounts.push_back(workerCount);
+		}
+		workerCounts.push_back(maxWorkerCount);
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "spawn overhead (ns per job)\n"
+			<< std::setw(8) << "workers" << std::setw(14) << "flat" << std::setw(14) << "nested" << std::endl;
+		for (uint32_t workerCount : workerCounts)
+		{
+			benchSpawnOverhead(workerCount, JOB_BENCH_SPAWN_COUNT, JOB_BENCH_REPEAT_COUNT);
+		}
+
+		std::cout << "\nscaling (" << JOB_BENCH_ELEMENT_COUNT << " elements, " << JOB_BENCH_BATCH_SIZE << " per job)\n"
+			<< std::setw(8) << "workers" << std::setw(14) << "ms" << std::setw(14) << "speedup" << std::setw(14) << "efficiency" << std::endl;
+		std::vector<float> values(JOB_BENCH_ELEMENT_COUNT);
+		double singleWorkerTime = 0.0;
+		for (uint32_t workerCount : workerCounts)
+		{
+			double time = benchScaling(workerCount, values, JOB_BENCH_REPEAT_COUNT);
+			if (workerCount == 1)
+			{
+				singleWorkerTime = time;
+			}
+			double speedup = singleWorkerTime / time;
+			std::cout << std::setw(8) << workerCount
+				<< std::setw(14) << time
+				<< std::setw(14) << speedup
+				<< std::setw(13) << speedup / workerCount * 100.0 << "%" << std::endl;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
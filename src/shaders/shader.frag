@@ -1,5 +1,9 @@
 #version 450
 
+// variant features, see BkShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+
 layout(binding = 1) uniform sampler2D texSampler;
 
 layout(location = 0) in vec3 fragColor;
@@ -9,5 +13,14 @@ layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = texture(texSampler, fragTexCoord);
+    vec4 color = vec4(1.0);
+    if (TEXTURED)
+    {
+        color = texture(texSampler, fragTexCoord);
+    }
+    if (VERTEX_COLOR)
+    {
+        color.rgb *= fragColor;
+    }
+    outColor = color;
 }
\ No newline at end of file
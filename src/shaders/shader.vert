@@ -1,5 +1,9 @@
 #version 450
 
+// variant features, see BkShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
@@ -15,7 +19,8 @@ layout(location = 1) out vec2 fragTexCoord;
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
-    fragTexCoord = inTexCoord;
+    // three matrix-vector products instead of two matrix-matrix products
+    gl_Position = ubo.proj * (ubo.view * (ubo.model * vec4(inPosition, 1.0)));
+    fragColor = VERTEX_COLOR ? inColor : vec3(1.0);
+    fragTexCoord = TEXTURED ? inTexCoord : vec2(0.0);
 }
\ No newline at end of file
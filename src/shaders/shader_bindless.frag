@@ -0,0 +1,38 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// variant features, see BkShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+
+struct Material {
+    uint baseColorTexture;
+    vec4 baseColorFactor;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Materials {
+    Material materials[];
+};
+
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterialIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    Material material = materials[fragMaterialIndex];
+    vec4 color = material.baseColorFactor;
+    if (TEXTURED)
+    {
+        color *= texture(textures[nonuniformEXT(material.baseColorTexture)], fragTexCoord);
+    }
+    if (VERTEX_COLOR)
+    {
+        color.rgb *= fragColor;
+    }
+    outColor = color;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 450
+
+// variant features, see BkShaderFeature
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterialIndex;
+
+void main()
+{
+    // three matrix-vector products instead of two matrix-matrix products
+    gl_Position = ubo.proj * (ubo.view * (ubo.model * vec4(inPosition, 1.0)));
+    fragColor = VERTEX_COLOR ? inColor : vec3(1.0);
+    fragTexCoord = TEXTURED ? inTexCoord : vec2(0.0);
+
+    // draws select their material through firstInstance
+    fragMaterialIndex = gl_InstanceIndex;
+}
\ No newline at end of file
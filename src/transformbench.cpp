@@ -0,0 +1,148 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+#include "BkTransformHierarchy.h"
+
+// nodes of the whole hierarchy, split into trees of 1 + 8 + 64 nodes
+const uint32_t TRANSFORM_BENCH_NODE_COUNT = 100000;
+const uint32_t TRANSFORM_BENCH_TREE_SIZE = 73;
+const uint32_t TRANSFORM_BENCH_BRANCHING = 8;
+
+// instance buffers written round robin, as the renderer's frames in flight
+const uint32_t TRANSFORM_BENCH_FRAME_COUNT = 2;
+
+// every measurement is repeated, the median is reported
+const uint32_t TRANSFORM_BENCH_REPEAT_COUNT = 21;
+
+struct TransformBenchCase {
+	const char* name;
+
+	// local transforms changed before every update
+	std::vector<uint32_t> changedNodes;
+};
+
+static double getMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static void buildHierarchy(BkTransformHierarchy& hierarchy, uint32_t nodeCount)
+{
+	for (uint32_t node = 0; node < nodeCount; node++)
+	{
+		// heap order within a tree, so every parent comes before its children
+		uint32_t treeNode = node % TRANSFORM_BENCH_TREE_SIZE;
+		uint32_t parent = treeNode == 0 ? TRANSFORM_NO_PARENT : node - treeNode + (treeNode - 1) / TRANSFORM_BENCH_BRANCHING;
+		float offset = static_cast<float>(treeNode % TRANSFORM_BENCH_BRANCHING);
+		hierarchy.addNode(parent);
+		hierarchy.setLocalTransform(node, glm::vec3(offset, 1.0f, 0.0f), glm::angleAxis(offset * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.9f));
+	}
+}
+
+// milliseconds per update and instance buffer write
+static double benchUpdate(bool bSimd, const TransformBenchCase& benchCase, uint32_t& updatedCount, uint32_t& writtenCount)
+{
+	BkTransformHierarchy hierarchy(TRANSFORM_BENCH_FRAME_COUNT, bSimd);
+	buildHierarchy(hierarchy, TRANSFORM_BENCH_NODE_COUNT);
+
+	// stands in for the persistently mapped instance buffers
+	std::vector<std::vector<glm::mat4>> instanceBuffers(TRANSFORM_BENCH_FRAME_COUNT, std::vector<glm::mat4>(TRANSFORM_BENCH_NODE_COUNT));
+	for (uint32_t frame = 0; frame < TRANSFORM_BENCH_FRAME_COUNT; frame++)
+	{
+		hierarchy.update();
+		hierarchy.writeInstances(frame, instanceBuffers[frame].data());
+	}
+
+	std::vector<double> times;
+	for (uint32_t i = 0; i < TRANSFORM_BENCH_REPEAT_COUNT; i++)
+	{
+		float angle = static_cast<float>(i) * 0.01f;
+		for (uint32_t node : benchCase.changedNodes)
+		{
+			hierarchy.setLocalTransform(node, glm::vec3(1.0f, angle, 0.0f), glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+		}
+
+		uint32_t frame = i % TRANSFORM_BENCH_FRAME_COUNT;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		updatedCount = hierarchy.update();
+		writtenCount = hierarchy.writeInstances(frame, instanceBuffers[frame].data());
+		auto endTime = std::chrono::high_resolution_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+	}
+	return getMedian(times);
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--help" || argument == "-h")
+		{
+			std::cerr << "usage: BulkanTransformBench\n"
+				<< "  updates a hierarchy of " << TRANSFORM_BENCH_NODE_COUNT << " transforms with the scalar and the SIMD path" << std::endl;
+			return EXIT_SUCCESS;
+		}
+	}
+
+	try
+	{
+		std::vector<TransformBenchCase> benchCases(3);
+		benchCases[0].name = "all roots";
+		benchCases[1].name = "10% leaves";
+		benchCases[2].name = "one root";
+		for (uint32_t node = 0; node < TRANSFORM_BENCH_NODE_COUNT; node++)
+		{
+			uint32_t treeNode = node % TRANSFORM_BENCH_TREE_SIZE;
+			if (treeNode == 0)
+			{
+				benchCases[0].changedNodes.push_back(node);
+			}
+			else if (treeNode > TRANSFORM_BENCH_BRANCHING && node % 10 == 0)
+			{
+				benchCases[1].changedNodes.push_back(node);
+			}
+		}
+		benchCases[2].changedNodes.push_back(0);
+
+		bool bSimdSupported = BkTransformHierarchy(1, true).isSimdEnabled();
+		if (!bSimdSupported)
+		{
+			std::cout << "AVX2 isn't supported, the SIMD rows use the scalar path\n";
+		}
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << TRANSFORM_BENCH_NODE_COUNT << " transforms, " << TRANSFORM_BENCH_FRAME_COUNT << " instance buffers\n"
+			<< std::setw(12) << "case" << std::setw(8) << "path" << std::setw(10) << "updated" << std::setw(10) << "written"
+			<< std::setw(12) << "ms" << std::setw(16) << "updates/s" << std::endl;
+		for (const TransformBenchCase& benchCase : benchCases)
+		{
+			for (bool bSimd : { false, true })
+			{
+				uint32_t updatedCount = 0;
+				uint32_t writtenCount = 0;
+				double time = benchUpdate(bSimd, benchCase, updatedCount, writtenCount);
+				std::cout << std::setw(12) << benchCase.name
+					<< std::setw(8) << (bSimd ? "simd" : "scalar")
+					<< std::setw(10) << updatedCount
+					<< std::setw(10) << writtenCount
+					<< std::setw(12) << time
+					<< std::setw(16) << std::setprecision(0) << updatedCount / (time / 1000.0) << std::setprecision(3) << std::endl;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+
+#include "BkVertex.h"
+
+// exit code that makes ctest report a test as skipped (SKIP_RETURN_CODE)
+const int TEST_SKIPPED = 77;
+
+inline int& testFailureCount()
+{
+	static int failureCount = 0;
+	return failureCount;
+}
+
+// report a failed check and keep going so one run shows every failure
+#define BK_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+			testFailureCount()++; \
+		} \
+	} while (0)
+
+// exit code of a test executable
+inline int testResult()
+{
+	if (testFailureCount() > 0)
+	{
+		std::cerr << testFailureCount() << " check(s) failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// a flat 'size' x 'size' quad grid in the z = 0 plane facing +z, rows of
+// quads in index buffer order
+inline void buildGrid(uint32_t size, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (uint32_t y = 0; y <= size; y++)
+	{
+		for (uint32_t x = 0; x <= size; x++)
+		{
+			Vertex vertex{};
+			vertex.pos = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+			vertex.texCoord = glm::vec2(static_cast<float>(x) / size, static_cast<float>(y) / size);
+			vertices.push_back(vertex);
+		}
+	}
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			uint32_t corner = y * (size + 1) + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + size + 2 });
+			indices.insert(indices.end(), { corner, corner + size + 2, corner + size + 1 });
+		}
+	}
+}
+
+// shuffle the triangle order with a fixed seed so runs are reproducible
+inline void shuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed = 1)
+{
+	std::vector<uint32_t> triangles(indices.size() / 3);
+	for (uint32_t i = 0; i < triangles.size(); i++)
+	{
+		triangles[i] = i;
+	}
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+
+	std::vector<uint32_t> shuffledIndices;
+	shuffledIndices.reserve(indices.size());
+	for (uint32_t triangle : triangles)
+	{
+		shuffledIndices.insert(shuffledIndices.end(), { indices[triangle * 3 + 0], indices[triangle * 3 + 1], indices[triangle * 3 + 2] });
+	}
+	indices.swap(shuffledIndices);
+}
@@ -0,0 +1,147 @@
+#include <stdexcept>
+
+#include "BkTest.h"
+#include "BkDeviceSelector.h"
+#include "BkDescriptorAllocator.h"
+
+// sets allocated per frame, far more than the first pool holds so the chain
+// has to grow several times within the first frame
+const uint32_t SETS_PER_FRAME = 5000;
+const uint32_t FRAME_COUNT = 8;
+
+static void testDescriptorAllocator(VkDevice device)
+{
+	BkDescriptorLayoutCache layoutCache(device);
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	descriptorSetLayoutCreateInfo.pBindings = bindings.data();
+	VkDescriptorSetLayout descriptorSetLayout = layoutCache.getLayout(descriptorSetLayoutCreateInfo);
+
+	BkDescriptorAllocator descriptorAllocator(device, {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f } });
+	BK_CHECK(descriptorAllocator.getPoolCount() == 0);
+
+	uint32_t workingSetPoolCount = 0;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		descriptorAllocator.reset();
+		uint32_t poolCount = descriptorAllocator.getPoolCount();
+		for (uint32_t i = 0; i < SETS_PER_FRAME; i++)
+		{
+			BK_CHECK(descriptorAllocator.allocate(descriptorSetLayout) != VK_NULL_HANDLE);
+
+			// a full pool makes the allocator take the next one, so the
+			// pool count never shrinks while allocating
+			BK_CHECK(descriptorAllocator.getPoolCount() >= poolCount);
+			poolCount = descriptorAllocator.getPoolCount();
+		}
+
+		if (frame == 0)
+		{
+			// the first pool ran out of memory and the chain grew
+			BK_CHECK(poolCount > 1);
+			workingSetPoolCount = poolCount;
+		}
+		else
+		{
+			// the reset pools hold the working set, no pools are created
+			BK_CHECK(poolCount == workingSetPoolCount);
+		}
+	}
+	std::cout << SETS_PER_FRAME << " sets per frame in " << workingSetPoolCount << " pools" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "BULKAN TEST";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "BULKAN";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_3;
+
+	VkInstanceCreateInfo instanceCreateInfo{};
+	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceCreateInfo.pApplicationInfo = &appInfo;
+	VkInstance instance;
+	if (vkCreateInstance(&instanceCreateInfo, nullptr, &instance) != VK_SUCCESS)
+	{
+		std::cerr << "no vulkan instance, skipped" << std::endl;
+		return TEST_SKIPPED;
+	}
+
+	// without a suitable device there is nothing to test
+	VkPhysicalDevice physicalDevice;
+	try
+	{
+		physicalDevice = selectPhysicalDevice(instance, VK_NULL_HANDLE, {}, getDeviceOverride(argc, argv));
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << ", skipped" << std::endl;
+		vkDestroyInstance(instance, nullptr);
+		return TEST_SKIPPED;
+	}
+
+	// the selector guarantees a graphics queue family
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamiliesProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamiliesProperties.data());
+	uint32_t queueFamilyIndex = 0;
+	for (uint32_t i = 0; i < queueFamilyCount; i++)
+	{
+		if (queueFamiliesProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			queueFamilyIndex = i;
+			break;
+		}
+	}
+
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo deviceQueueCreateInfo{};
+	deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	deviceQueueCreateInfo.queueCount = 1;
+	deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+
+	VkDeviceCreateInfo deviceCreateInfo{};
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+	VkDevice device;
+	if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS)
+	{
+		std::cerr << "ERROR: 'vkCreateDevice' failed to create vulkan device!" << std::endl;
+		vkDestroyInstance(instance, nullptr);
+		return 1;
+	}
+
+	try
+	{
+		testDescriptorAllocator(device);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		testFailureCount()++;
+	}
+
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+	return testResult();
+}
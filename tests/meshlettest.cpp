@@ -0,0 +1,149 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/gtc/matrix_transform.hpp>
+#include <unordered_set>
+
+#include "BkTest.h"
+#include "BkMeshlet.h"
+
+// every meshlet is within the limits, the meshlets tile the index range in
+// order and every index of the range is in exactly one meshlet
+static void checkMeshlets(const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, const std::vector<BkMeshlet>& meshlets)
+{
+	BK_CHECK(!meshlets.empty());
+
+	std::vector<uint32_t> coverage(indices.size(), 0);
+	uint32_t nextIndex = firstIndex;
+	for (const BkMeshlet& meshlet : meshlets)
+	{
+		BK_CHECK(meshlet.firstIndex == nextIndex);
+		BK_CHECK(meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0);
+		BK_CHECK(meshlet.indexCount / 3 <= MESHLET_MAX_TRIANGLES);
+
+		std::unordered_set<uint32_t> meshletVertices;
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount && i < indices.size(); i++)
+		{
+			meshletVertices.insert(indices[i]);
+			coverage[i]++;
+		}
+		BK_CHECK(meshletVertices.size() <= MESHLET_MAX_VERTICES);
+		BK_CHECK(meshletVertices.size() == meshlet.vertexCount);
+		nextIndex = meshlet.firstIndex + meshlet.indexCount;
+	}
+	BK_CHECK(nextIndex == firstIndex + indexCount);
+
+	for (uint32_t i = 0; i < coverage.size(); i++)
+	{
+		bool bInRange = i >= firstIndex && i < firstIndex + indexCount;
+		BK_CHECK(coverage[i] == (bInRange ? 1u : 0u));
+	}
+}
+
+static void testMeshletLimits()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildGrid(64, vertices, indices);
+
+	// rows of quads fill meshlets up to the triangle limit
+	std::vector<BkMeshlet> meshlets;
+	buildMeshlets(vertices, indices, 0, static_cast<uint32_t>(indices.size()), meshlets);
+	checkMeshlets(indices, 0, static_cast<uint32_t>(indices.size()), meshlets);
+
+	// shuffled triangles share few vertices and hit the vertex limit, the
+	// range starts and ends inside the index buffer like a submesh
+	shuffleTriangles(indices);
+	uint32_t firstIndex = 3 * 1000;
+	uint32_t indexCount = 3 * 5000;
+	buildMeshlets(vertices, indices, firstIndex, indexCount, meshlets);
+	checkMeshlets(indices, firstIndex, indexCount, meshlets);
+}
+
+static void testFrustum()
+{
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+	BkFrustum frustum = extractFrustum(proj * view);
+
+	// accept
+	BK_CHECK(isSphereInFrustum(frustum, glm::vec3(0.0f), 1.0f));
+	BK_CHECK(isSphereInFrustum(frustum, glm::vec3(0.0f, 0.0f, -90.0f), 1.0f));
+
+	// the center is outside the right plane but the sphere reaches into it
+	BK_CHECK(isSphereInFrustum(frustum, glm::vec3(3.5f, 0.0f, 0.0f), 1.0f));
+
+	// reject
+	BK_CHECK(!isSphereInFrustum(frustum, glm::vec3(0.0f, 0.0f, 10.0f), 1.0f));
+	BK_CHECK(!isSphereInFrustum(frustum, glm::vec3(50.0f, 0.0f, 0.0f), 1.0f));
+	BK_CHECK(!isSphereInFrustum(frustum, glm::vec3(0.0f, -50.0f, 0.0f), 1.0f));
+	BK_CHECK(!isSphereInFrustum(frustum, glm::vec3(0.0f, 0.0f, -200.0f), 1.0f));
+}
+
+static void testCone()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildGrid(4, vertices, indices);
+
+	std::vector<BkMeshlet> meshlets;
+	buildMeshlets(vertices, indices, 0, static_cast<uint32_t>(indices.size()), meshlets);
+	BK_CHECK(meshlets.size() == 1);
+
+	// the grid faces +z
+	BK_CHECK(!isMeshletBackfacing(meshlets[0], glm::vec3(2.0f, 2.0f, 5.0f)));
+	BK_CHECK(!isMeshletBackfacing(meshlets[0], glm::vec3(-10.0f, 2.0f, 1.0f)));
+	BK_CHECK(isMeshletBackfacing(meshlets[0], glm::vec3(2.0f, 2.0f, -5.0f)));
+	BK_CHECK(isMeshletBackfacing(meshlets[0], glm::vec3(10.0f, -10.0f, -1.0f)));
+
+	// the frustum and the cone test together decide the draws
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+	glm::mat4 frontView = glm::lookAt(glm::vec3(2.0f, 2.0f, 5.0f), glm::vec3(2.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 backView = glm::lookAt(glm::vec3(2.0f, 2.0f, -5.0f), glm::vec3(2.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 awayView = glm::lookAt(glm::vec3(2.0f, 2.0f, 5.0f), glm::vec3(2.0f, 2.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	VkDrawIndexedIndirectCommand drawCommand{};
+	BK_CHECK(cullMeshlets(meshlets, extractFrustum(proj * frontView), glm::vec3(2.0f, 2.0f, 5.0f), &drawCommand, 7) == 1);
+	BK_CHECK(drawCommand.firstIndex == meshlets[0].firstIndex);
+	BK_CHECK(drawCommand.indexCount == meshlets[0].indexCount);
+	BK_CHECK(drawCommand.instanceCount == 1);
+	BK_CHECK(drawCommand.firstInstance == 7);
+	BK_CHECK(cullMeshlets(meshlets, extractFrustum(proj * backView), glm::vec3(2.0f, 2.0f, -5.0f), &drawCommand) == 0);
+	BK_CHECK(cullMeshlets(meshlets, extractFrustum(proj * awayView), glm::vec3(2.0f, 2.0f, 5.0f), &drawCommand) == 0);
+}
+
+static void testConcaveCone()
+{
+	// a V shaped valley along the x axis: the faces meet at the bottom edge
+	// (z = 0) and face up and inwards, normals (0, 1, 1) and (0, -1, 1)
+	std::vector<Vertex> vertices(4);
+	vertices[0].pos = glm::vec3(0.0f, 0.0f, 0.0f);
+	vertices[1].pos = glm::vec3(1.0f, 0.0f, 0.0f);
+	vertices[2].pos = glm::vec3(0.0f, -1.0f, 1.0f);
+	vertices[3].pos = glm::vec3(0.0f, 1.0f, 1.0f);
+	std::vector<uint32_t> indices = { 0, 2, 1, 0, 1, 3 };
+
+	std::vector<BkMeshlet> meshlets;
+	buildMeshlets(vertices, indices, 0, static_cast<uint32_t>(indices.size()), meshlets);
+	BK_CHECK(meshlets.size() == 1);
+	BK_CHECK(meshlets[0].coneCutoff < 1.0f);
+
+	// the apex has to be behind both face planes, below the bottom edge
+	BK_CHECK(meshlets[0].coneApex.z <= 0.0f);
+
+	// inside the valley, in front of both faces but below the bounding
+	// sphere center
+	BK_CHECK(!isMeshletBackfacing(meshlets[0], glm::vec3(0.5f, 0.2f, 0.1f)));
+	BK_CHECK(!isMeshletBackfacing(meshlets[0], glm::vec3(0.5f, 0.0f, 5.0f)));
+
+	// below the valley both faces point away
+	BK_CHECK(isMeshletBackfacing(meshlets[0], glm::vec3(0.5f, 0.0f, -5.0f)));
+}
+
+int main()
+{
+	testMeshletLimits();
+	testFrustum();
+	testCone();
+	testConcaveCone();
+	return testResult();
+}
@@ -0,0 +1,105 @@
+#include <array>
+
+#include "BkTest.h"
+#include "BkMeshOptimizer.h"
+
+using Triangle = std::array<uint32_t, 3>;
+
+// the triangles as a sorted list, each rotated to start at its smallest
+// index so reordering the triangles or rotating their vertices compares
+// equal but flipping the winding doesn't
+static std::vector<Triangle> getTriangles(const std::vector<uint32_t>& indices)
+{
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Triangle triangle = { indices[i + 0], indices[i + 1], indices[i + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static void buildShuffledGrid(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	buildGrid(64, vertices, indices);
+	shuffleTriangles(indices);
+}
+
+static void testVertexCache()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildShuffledGrid(vertices, indices);
+	std::vector<Triangle> triangles = getTriangles(indices);
+	BkVertexCacheStats shuffledStats = analyzeVertexCache(indices, vertices.size());
+
+	optimizeVertexCache(indices, vertices.size());
+	BK_CHECK(getTriangles(indices) == triangles);
+
+	// a regular grid can get close to 0.5 misses per triangle
+	BkVertexCacheStats optimizedStats = analyzeVertexCache(indices, vertices.size());
+	std::cout << "ACMR shuffled " << shuffledStats.acmr << ", optimized " << optimizedStats.acmr << std::endl;
+	BK_CHECK(optimizedStats.acmr < shuffledStats.acmr);
+	BK_CHECK(optimizedStats.acmr < 1.0f);
+	BK_CHECK(optimizedStats.vertexTransforms < shuffledStats.vertexTransforms);
+}
+
+static void testOverdraw()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildShuffledGrid(vertices, indices);
+	optimizeVertexCache(indices, vertices.size());
+	std::vector<Triangle> triangles = getTriangles(indices);
+
+	optimizeOverdraw(indices, vertices);
+	BK_CHECK(getTriangles(indices) == triangles);
+}
+
+static void testVertexFetch()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildShuffledGrid(vertices, indices);
+
+	// remember every vertex's original index to undo the remap, the last
+	// vertex is not referenced and has to be dropped
+	vertices.push_back(Vertex{});
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		vertices[i].color = glm::vec3(static_cast<float>(i), 0.0f, 0.0f);
+	}
+	size_t referencedVertexCount = vertices.size() - 1;
+	std::vector<Triangle> triangles = getTriangles(indices);
+
+	optimizeVertexFetch(vertices, indices);
+	BK_CHECK(vertices.size() == referencedVertexCount);
+
+	// vertices are in the order of their first use
+	uint32_t nextVertex = 0;
+	for (uint32_t index : indices)
+	{
+		BK_CHECK(index <= nextVertex);
+		if (index == nextVertex)
+		{
+			nextVertex++;
+		}
+	}
+
+	std::vector<uint32_t> originalIndices;
+	for (uint32_t index : indices)
+	{
+		originalIndices.push_back(index < vertices.size() ? static_cast<uint32_t>(vertices[index].color.x) : ~0u);
+	}
+	BK_CHECK(getTriangles(originalIndices) == triangles);
+}
+
+int main()
+{
+	testVertexCache();
+	testOverdraw();
+	testVertexFetch();
+	return testResult();
+}